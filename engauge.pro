@@ -22,18 +22,23 @@
 #    Sample command lines:
 #        qmake CONFIG+=pdf
 #        qmake "CONFIG+=debug pdf"
-# 5) Set environment variable HELPDIR to override the default directory for the help files. On the command line, use
+# 5) Add 'fftwf' to the qmake command line so point matching uses single precision fftw with all cores. Requires
+#        1) previous installation of the single precision fftw development package, including libfftw3f_threads
+#    Sample command lines:
+#        qmake CONFIG+=fftwf
+#        qmake "CONFIG+=debug fftwf"
+# 6) Set environment variable HELPDIR to override the default directory for the help files. On the command line, use
 #    qmake "DEFINES+=HELPDIR=<directory>". The <directory> is absolute or relative to the application executable directory
-# 6) Gratuitous warning about import_qpa_plugin in Fedora is due to 'CONFIG=qt' but that option takes care of 
+# 7) Gratuitous warning about import_qpa_plugin in Fedora is due to 'CONFIG=qt' but that option takes care of 
 #    include/library files in an automated and platform-independent manner, so it will not be removed
-# 7) 'network' module of Qt is not included for Windows version since installation file gets blocked by Avast antivirus.
+# 8) 'network' module of Qt is not included for Windows version since installation file gets blocked by Avast antivirus.
 #    Likewise, it is not included for OSX since it is interpretted as a threat. 
 #    The network module can download files, which is what malware does to install bad things
-# 8) In OSX, QtHelp requires QtNetwork which is rejected by the operating system, so QtHelp is disabled
+# 9) In OSX, QtHelp requires QtNetwork which is rejected by the operating system, so QtHelp is disabled
 #
 # More comments are in the INSTALL file, and below
 
-QT += core gui printsupport widgets xml
+QT += concurrent core gui printsupport widgets xml
 
 !mac {
 QT += help
@@ -126,8 +131,9 @@ HEADERS  += \
     src/Cmd/CmdUndoForTest.h \
     src/Color/ColorConstants.h \
     src/Color/ColorFilter.h \
-    src/Color/ColorFilterEntry.h \
     src/Color/ColorFilterHistogram.h \
+    src/Color/ColorFilterLevels.h \
+    src/Color/ColorFilterLookupTable.h \
     src/Color/ColorFilterMode.h \
     src/Color/ColorFilterSettings.h \
     src/Color/ColorFilterSettingsStrategyAbstractBase.h \
@@ -136,12 +142,14 @@ HEADERS  += \
     src/Color/ColorFilterSettingsStrategyIntensity.h \
     src/Color/ColorFilterSettingsStrategySaturation.h \
     src/Color/ColorFilterSettingsStrategyValue.h \
+    src/Color/ColorFilterSimd.h \
     src/Color/ColorFilterStrategyAbstractBase.h \
     src/Color/ColorFilterStrategyForeground.h \
     src/Color/ColorFilterStrategyHue.h \
     src/Color/ColorFilterStrategyIntensity.h \
     src/Color/ColorFilterStrategySaturation.h \
     src/Color/ColorFilterStrategyValue.h \
+    src/Color/ColorFilterStripe.h \
     src/Color/ColorPalette.h \
     src/Coord/CoordScale.h \
     src/Coord/CoordsType.h \
@@ -155,6 +163,7 @@ HEADERS  += \
     src/Coord/CoordUnitsPolarTheta.h \
     src/Coord/CoordUnitsTime.h \
     src/Correlation/Correlation.h \
+    src/Correlation/FftPlanCache.h \
     src/Cursor/CursorFactory.h \
     src/Cursor/CursorSize.h \
     src/Curve/Curve.h \
@@ -255,6 +264,7 @@ HEADERS  += \
     src/FileCmd/FileCmdOpen.h \
     src/FileCmd/FileCmdScript.h \
     src/FileCmd/FileCmdSerialize.h \
+    src/Filter/BitPlane.h \
     src/Filter/FilterImage.h \
     src/Fitting/FittingCurve.h \
     src/Fitting/FittingCurveCoefficients.h \
@@ -333,6 +343,8 @@ HEADERS  += \
     src/Point/PointIdentifiers.h \
     src/Point/PointMatchAlgorithm.h \
     src/Point/PointMatchPixel.h \
+    src/Point/PointMatchSession.h \
+    src/Point/PointMatchThread.h \
     src/Point/PointMatchTriplet.h \
     src/Point/Points.h \
     src/Point/PointShape.h \
@@ -342,6 +354,7 @@ HEADERS  += \
     src/Segment/Segment.h \
     src/Segment/SegmentFactory.h \
     src/Segment/SegmentLine.h \
+    src/Segment/SegmentRun.h \
     src/Settings/Settings.h \
     src/Settings/SettingsForGraph.h \
     src/Spline/Spline.h \
@@ -456,6 +469,8 @@ SOURCES += \
     src/Cmd/CmdUndoForTest.cpp \
     src/Color/ColorFilter.cpp \
     src/Color/ColorFilterHistogram.cpp \
+    src/Color/ColorFilterLevels.cpp \
+    src/Color/ColorFilterLookupTable.cpp \
     src/Color/ColorFilterMode.cpp \
     src/Color/ColorFilterSettings.cpp \
     src/Color/ColorFilterSettingsStrategyAbstractBase.cpp \
@@ -464,12 +479,14 @@ SOURCES += \
     src/Color/ColorFilterSettingsStrategyIntensity.cpp \
     src/Color/ColorFilterSettingsStrategySaturation.cpp \
     src/Color/ColorFilterSettingsStrategyValue.cpp \
+    src/Color/ColorFilterSimd.cpp \
     src/Color/ColorFilterStrategyAbstractBase.cpp \
     src/Color/ColorFilterStrategyForeground.cpp \
     src/Color/ColorFilterStrategyHue.cpp \
     src/Color/ColorFilterStrategyIntensity.cpp \
     src/Color/ColorFilterStrategySaturation.cpp \
     src/Color/ColorFilterStrategyValue.cpp \
+    src/Color/ColorFilterStripe.cpp \
     src/Color/ColorPalette.cpp \
     src/Coord/CoordScale.cpp \
     src/Coord/CoordsType.cpp \
@@ -482,6 +499,7 @@ SOURCES += \
     src/Coord/CoordUnitsPolarTheta.cpp \
     src/Coord/CoordUnitsTime.cpp \
     src/Correlation/Correlation.cpp \
+    src/Correlation/FftPlanCache.cpp \
     src/Cursor/CursorFactory.cpp \
     src/Cursor/CursorSize.cpp \
     src/Curve/Curve.cpp \
@@ -576,6 +594,7 @@ SOURCES += \
     src/FileCmd/FileCmdOpen.cpp \
     src/FileCmd/FileCmdScript.cpp \
     src/FileCmd/FileCmdSerialize.cpp \
+    src/Filter/BitPlane.cpp \
     src/Filter/FilterImage.cpp \
     src/Fitting/FittingCurve.cpp \    
     src/Fitting/FittingModel.cpp \
@@ -646,6 +665,8 @@ SOURCES += \
     src/Point/PointIdentifiers.cpp \
     src/Point/PointMatchAlgorithm.cpp \
     src/Point/PointMatchPixel.cpp \
+    src/Point/PointMatchSession.cpp \
+    src/Point/PointMatchThread.cpp \
     src/Point/PointMatchTriplet.cpp \
     src/Point/PointShape.cpp \
     src/Point/PointStyle.cpp \
@@ -879,6 +900,19 @@ pdf {
     message("PDF support:      no")
 }
 
+fftwf {
+    message("FFTWF support:    yes")
+    DEFINES += "ENGAUGE_FFTWF"
+    win32-msvc* {
+      LIBS += $$(FFTW_HOME)/lib/libfftw3f-3.lib
+    } else {
+      LIBS += -lfftw3f_threads -lfftw3f
+    }
+
+} else {
+    message("FFTWF support:    no")
+}
+
 # People interested in translating a language can contact the developers for help. 
 # 
 # Translation file names are 'engauge_XX_YY' or 'engauge_XX' where:
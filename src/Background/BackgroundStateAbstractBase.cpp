@@ -41,11 +41,6 @@ const BackgroundStateContext &BackgroundStateAbstractBase::context() const
   return m_context;
 }
 
-QImage BackgroundStateAbstractBase::image () const
-{
-  return m_image;
-}
-
 QGraphicsPixmapItem &BackgroundStateAbstractBase::imageItem () const
 {
   return *m_imageItem;
@@ -77,6 +72,4 @@ void BackgroundStateAbstractBase::setProcessedPixmap (const QPixmap &pixmap)
 
   // Reset scene rectangle or else small image after large image will be off-center
   m_scene.setSceneRect (m_imageItem->boundingRect ());
-
-  m_image = pixmap.toImage();
 }
@@ -8,7 +8,6 @@
 #define BACKGROUND_STATE_ABSTRACT_BASE_H
 
 #include <QGraphicsPixmapItem>
-#include <QImage>
 
 /// Set of possible states of background image.
 enum BackgroundState {
@@ -50,9 +49,6 @@ class BackgroundStateAbstractBase
   /// Zoom so background fills the window
   virtual void fitInView (GraphicsView &view) = 0;
 
-  /// Image for the current state
-  QImage image () const;
-
   /// Graphics image item for the current state
   QGraphicsPixmapItem &imageItem () const;
 
@@ -101,8 +97,6 @@ class BackgroundStateAbstractBase
   // Each state has its own image, although only one is shown at a time. This is null if an image has not been defined yet,
   // so we can eliminate a dependency on the ordering of the state transitions and the update of the image by setPixmap
   QGraphicsPixmapItem *m_imageItem;
-
-  QImage m_image; // Original image. This is stored in addition to m_imageItem since m_imageItem cannot be used when invisible
 };
 
 #endif // BACKGROUND_STATE_ABSTRACT_BASE_H
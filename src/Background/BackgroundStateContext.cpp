@@ -35,6 +35,12 @@ BackgroundStateContext::BackgroundStateContext(MainWindow &mainWindow) :
   completeRequestedStateTransitionIfExists();
 }
 
+BitPlane BackgroundStateContext::bitsForCurveState () const
+{
+  const BackgroundStateCurve *stateCurve = (const BackgroundStateCurve *) m_states [BACKGROUND_STATE_CURVE];
+  return stateCurve->bitsFiltered ();
+}
+
 void BackgroundStateContext::close()
 {
   LOG4CPP_INFO_S ((*mainCat)) << "BackgroundStateContext::close";
@@ -85,11 +91,6 @@ void BackgroundStateContext::fitInView (GraphicsView &view)
 
 }
 
-QImage BackgroundStateContext::imageForCurveState () const
-{
-  return m_states [BACKGROUND_STATE_CURVE]->image();
-}
-
 void BackgroundStateContext::requestStateTransition (BackgroundState backgroundState)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "BackgroundStateContext::requestStateTransition";
@@ -9,6 +9,7 @@
 
 #include "BackgroundImage.h"
 #include "BackgroundStateAbstractBase.h"
+#include "BitPlane.h"
 #include <QVector>
 
 class DocumentModelColorFilter;
@@ -35,15 +36,15 @@ class BackgroundStateContext
   /// Single constructor
   BackgroundStateContext(MainWindow &mainWindow);
 
+  /// Filtered image for the Curve state, even if the current state is different
+  BitPlane bitsForCurveState () const;
+
   /// Open Document is being closed so remove the background
   void close();
 
   /// Zoom so background fills the window
   void fitInView (GraphicsView &view);
 
-  /// Image for the Curve state, even if the current state is different
-  QImage imageForCurveState () const;
-
   /// Initiate state transition to be performed later, when BackgroundState is off the stack
   void requestStateTransition (BackgroundState backgroundState);
 
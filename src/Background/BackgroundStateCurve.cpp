@@ -29,6 +29,11 @@ void BackgroundStateCurve::begin()
   setImageVisible (true);
 }
 
+BitPlane BackgroundStateCurve::bitsFiltered () const
+{
+  return m_bitsFiltered;
+}
+
 void BackgroundStateCurve::end()
 {
   LOG4CPP_INFO_S ((*mainCat)) << "BackgroundStateCurve::end";
@@ -53,19 +58,22 @@ void BackgroundStateCurve::processImageFromSavedInputs (const Transformation &tr
   // Use the settings if the selected curve is known
   if (!curveSelected.isEmpty()) {
 
-    // Generate filtered image
+    // Generate filtered image. Its pixmap for display is cached along with it, so switching curves is cheap
     FilterImage filterImage;
-    QPixmap pixmapFiltered = filterImage.filter (m_pixmapOriginal.toImage(),
-                                                 transformation,
-                                                 curveSelected,
-                                                 modelColorFilter,
-                                                 modelGridRemoval);
+    QPixmap pixmapFiltered;
+    m_bitsFiltered = filterImage.filter (m_pixmapOriginal,
+                                         transformation,
+                                         curveSelected,
+                                         modelColorFilter,
+                                         modelGridRemoval,
+                                         pixmapFiltered);
 
     setProcessedPixmap (pixmapFiltered);
 
   } else {
 
     // Set the image in case BackgroundStateContext::fitInView is called, so the bounding rect is available
+    m_bitsFiltered = BitPlane (m_pixmapOriginal.toImage ());
     setProcessedPixmap (m_pixmapOriginal);
 
   }
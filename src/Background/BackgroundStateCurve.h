@@ -8,6 +8,7 @@
 #define BACKGROUND_STATE_CURVE_H
 
 #include "BackgroundStateAbstractBase.h"
+#include "BitPlane.h"
 
 /// Background image state for showing filter image from current curve
 class BackgroundStateCurve : public BackgroundStateAbstractBase
@@ -18,6 +19,10 @@ class BackgroundStateCurve : public BackgroundStateAbstractBase
                        GraphicsScene &scene);
 
   virtual void begin();
+
+  /// Filtered image for the current curve. This is the original image when no curve is selected
+  BitPlane bitsFiltered () const;
+
   virtual void end();
   virtual void fitInView (GraphicsView &view);
   virtual void setCurveSelected (const Transformation &transformation,
@@ -45,6 +50,9 @@ class BackgroundStateCurve : public BackgroundStateAbstractBase
 
   // Data saved for use by processImageFromSavedInputs
   QPixmap m_pixmapOriginal;
+
+  // Filtered image that is displayed, kept as a bit plane for the algorithms that consume it
+  BitPlane m_bitsFiltered;
 };
 
 #endif // BACKGROUND_STATE_CURVE_H
@@ -11,11 +11,32 @@
 #include "ColorFilterStrategyIntensity.h"
 #include "ColorFilterStrategySaturation.h"
 #include "ColorFilterStrategyValue.h"
+#include "ColorFilterStripe.h"
 #include "EngaugeAssert.h"
 #include "mmsubs.h"
+#include <QCache>
+#include <QColor>
 #include <QDebug>
 #include <qmath.h>
 #include <QImage>
+#include <QMutexLocker>
+#include <QPixmap>
+#include <QtConcurrentMap>
+#include <QVector>
+
+// Recently used lookup tables, shared by all ColorFilter instances in all threads. Most recently used table is first
+static QList<ColorFilterLookupTablePtr> lookupTableCache;
+static QMutex lookupTableCacheMutex;
+const int LOOKUP_TABLE_CACHE_SIZE = 4;
+
+// Recently computed margin colors, keyed by QImage::cacheKey and QPixmap::cacheKey. Those two key sequences are
+// independent so they are kept apart
+static QCache<qint64, QRgb> marginColorImageCache;
+static QCache<qint64, QRgb> marginColorPixmapCache;
+static QMutex marginColorCacheMutex;
+
+// Margin colors are compared using the high four bits of each channel (see colorCompare), giving 4096 distinct colors
+const int MARGIN_COLOR_BIN_COUNT = 4096;
 
 ColorFilter::ColorFilter()
 {
@@ -49,73 +70,179 @@ void ColorFilter::filterImage (const QImage &imageOriginal,
   ENGAUGE_ASSERT (imageOriginal.height() == imageFiltered.height());
   ENGAUGE_ASSERT (imageFiltered.format () == QImage::Format_RGB32);
 
-  for (int x = 0; x < imageOriginal.width(); x++) {
-    for (int y = 0; y < imageOriginal.height (); y++) {
+  if (!m_strategies.contains (colorFilterMode)) {
+    ENGAUGE_ASSERT (false);
+    return;
+  }
+
+  // Strategy is resolved once here rather than once per pixel
+  const ColorFilterStrategyAbstractBase *strategy = m_strategies [colorFilterMode];
+
+  // Scan lines are read directly, so the original image must have 32 bit pixels
+  QImage imageOriginal32 = ColorFilterStripe::imageWith32BitPixels (imageOriginal);
+
+  // Each distinct color is run through the strategy only once, and the result is kept for later calls with the same mode
+  // and background, whatever their thresholds
+  ColorFilterLookupTablePtr table = lookupTable (colorFilterMode,
+                                                 rgbBackground);
+
+  // Horizontal stripes are processed in parallel on the thread pool. Pixel data is accessed through raw pointers, which
+  // are obtained here so no thread triggers a detach
+  QList<QPair<int, int> > rows = ColorFilterStripe::stripeRows (0,
+                                                                imageOriginal32.height ());
+  const uchar *bitsOriginal = imageOriginal32.constBits ();
+  uchar *bitsFiltered = imageFiltered.bits ();
+
+  QList<ColorFilterStripe> stripes;
+  for (int stripe = 0; stripe < rows.count (); stripe++) {
+    stripes << ColorFilterStripe (strategy,
+                                  table.data (),
+                                  bitsOriginal,
+                                  imageOriginal32.bytesPerLine (),
+                                  bitsFiltered,
+                                  imageFiltered.bytesPerLine (),
+                                  imageOriginal32.width (),
+                                  rows [stripe].first,
+                                  rows [stripe].second,
+                                  rgbBackground,
+                                  low,
+                                  high);
+  }
 
-      QColor pixel = imageOriginal.pixel (x, y);
-      bool isOn = false;
-      if (pixel.rgb() != rgbBackground) {
+  {
+    // Lock is held only until the codes of this image have been saved, which are then never changed
+    QMutexLocker locker (&table->mutex ());
 
-        isOn = pixelUnfilteredIsOn (colorFilterMode,
-                                    pixel,
-                                    rgbBackground,
-                                    low,
-                                    high);
-      }
+    QtConcurrent::blockingMap (stripes, &ColorFilterStripe::computeUnknownColors);
 
-      imageFiltered.setPixel (x, y, (isOn ?
-                                     QColor (Qt::black).rgb () :
-                                     QColor (Qt::white).rgb ()));
+    QList<ColorFilterStripe>::const_iterator itr;
+    for (itr = stripes.begin (); itr != stripes.end (); itr++) {
+      itr->saveUnknownColors (*table);
     }
   }
+
+  QtConcurrent::blockingMap (stripes, &ColorFilterStripe::writeFiltered);
 }
 
-QRgb ColorFilter::marginColor(const QImage *image) const
+ColorFilterLookupTablePtr ColorFilter::lookupTable (ColorFilterMode colorFilterMode,
+                                                   QRgb rgbBackground) const
 {
-  // Add unique colors to colors list
-  ColorList colorCounts;
-  for (int x = 0; x < image->width (); x++) {
-    mergePixelIntoColorCounts (image->pixel (x, 0), colorCounts);
-    mergePixelIntoColorCounts (image->pixel (x, image->height () - 1), colorCounts);
+  QMutexLocker locker (&lookupTableCacheMutex);
+
+  for (int i = 0; i < lookupTableCache.count (); i++) {
+    ColorFilterLookupTablePtr table = lookupTableCache [i];
+    if (table->matches (colorFilterMode,
+                        rgbBackground)) {
+
+      // Move to front since this is now the most recently used
+      lookupTableCache.move (i, 0);
+      return table;
+    }
   }
-  for (int y = 0; y < image->height (); y++) {
-    mergePixelIntoColorCounts (image->pixel (0, y), colorCounts);
-    mergePixelIntoColorCounts (image->pixel (image->width () - 1, y), colorCounts);
+
+  ColorFilterLookupTablePtr table (new ColorFilterLookupTable (colorFilterMode,
+                                                               rgbBackground));
+  lookupTableCache.prepend (table);
+  while (lookupTableCache.count () > LOOKUP_TABLE_CACHE_SIZE) {
+    lookupTableCache.removeLast (); // Table is deleted once no other thread is still using it
   }
 
-  // Margin color is the most frequent color
-  ColorFilterEntry entryMax;
-  entryMax.count = 0;
-  for (ColorList::const_iterator itr = colorCounts.begin (); itr != colorCounts.end (); itr++) {
-    if ((*itr).count > entryMax.count) {
-      entryMax = *itr;
-    }
+  return table;
+}
+
+QRgb ColorFilter::marginColor(const QImage *image) const
+{
+  QMutexLocker locker (&marginColorCacheMutex);
+
+  const QRgb *cached = marginColorImageCache.object (image->cacheKey ());
+  if (cached != 0) {
+    return *cached;
   }
 
-  return entryMax.color.rgb();
+  QRgb rgb = marginColorUncached (*image);
+  marginColorImageCache.insert (image->cacheKey (),
+                                new QRgb (rgb));
+
+  return rgb;
 }
 
-void ColorFilter::mergePixelIntoColorCounts (QRgb pixel,
-                                             ColorList &colorCounts) const
+QRgb ColorFilter::marginColor(const QPixmap &pixmap) const
 {
-  ColorFilterEntry entry;
-  entry.color = pixel;
-  entry.count = 0;
-
-  // Look for previous entry
-  bool found = false;
-  for (ColorList::iterator itr = colorCounts.begin (); itr != colorCounts.end (); itr++) {
-    if (colorCompare (entry.color.rgb(),
-                      (*itr).color.rgb())) {
-      found = true;
-      ++(*itr).count;
-      break;
+  QMutexLocker locker (&marginColorCacheMutex);
+
+  const QRgb *cached = marginColorPixmapCache.object (pixmap.cacheKey ());
+  if (cached != 0) {
+    return *cached;
+  }
+
+  QRgb rgb = marginColorUncached (pixmap.toImage ());
+  marginColorPixmapCache.insert (pixmap.cacheKey (),
+                                 new QRgb (rgb));
+
+  return rgb;
+}
+
+QRgb ColorFilter::marginColorUncached (const QImage &image) const
+{
+  int width = image.width ();
+  int height = image.height ();
+  if ((width == 0) || (height == 0)) {
+    return QColor ().rgb ();
+  }
+
+  // Border pixels are binned by the high four bits of each channel, which is equivalent to colorCompare. Each bin
+  // remembers the first pixel that landed in it, with order giving the position of that pixel in the sequence
+  // top/bottom pairs for each x, then left/right pairs for each y. Visiting the borders one scan line at a time
+  // therefore still selects the same pixel, on ties, as visiting them in that sequence
+  QVector<int> counts (MARGIN_COLOR_BIN_COUNT, 0);
+  QVector<int> orders (MARGIN_COLOR_BIN_COUNT, 0);
+  QVector<QRgb> colors (MARGIN_COLOR_BIN_COUNT, 0);
+
+  // Scan lines of 32 bit images are read directly, and other formats fall back to QImage::pixel
+  bool is32Bit = (image.format () == QImage::Format_RGB32) ||
+                 (image.format () == QImage::Format_ARGB32);
+
+  const int NUM_BORDERS = 4;
+  for (int border = 0; border < NUM_BORDERS; border++) {
+
+    bool isRow = (border < 2);
+    int count = (isRow ? width : height);
+    int orderOffset = (isRow ? border : 2 * width + border - 2);
+
+    for (int i = 0; i < count; i++) {
+
+      int x = (isRow ? i : (border == 2 ? 0 : width - 1));
+      int y = (isRow ? (border == 0 ? 0 : height - 1) : i);
+
+      QRgb pixel = (is32Bit ?
+                    ((const QRgb *) image.constScanLine (y)) [x] :
+                    image.pixel (x, y));
+      int bin = ((pixel >> 12) & 0xf00) | ((pixel >> 8) & 0xf0) | ((pixel >> 4) & 0xf);
+      int order = orderOffset + 2 * i;
+
+      if (counts [bin] == 0 || order < orders [bin]) {
+        orders [bin] = order;
+        colors [bin] = QColor (pixel).rgb (); // Alpha is dropped, as with QColor
+      }
+      ++counts [bin];
     }
   }
 
-  if (!found) {
-    colorCounts.append (entry);
+  // Margin color is the most frequent color. As before, a color that appears only once does not qualify, and ties go
+  // to the color that is first in the visiting sequence
+  int binMax = -1;
+  for (int bin = 0; bin < MARGIN_COLOR_BIN_COUNT; bin++) {
+    if ((counts [bin] > 1) &&
+        ((binMax < 0) ||
+         (counts [bin] > counts [binMax]) ||
+         ((counts [bin] == counts [binMax]) && (orders [bin] < orders [binMax])))) {
+      binMax = bin;
+    }
   }
+
+  return (binMax < 0 ?
+          QColor ().rgb () :
+          colors [binMax]);
 }
 
 bool ColorFilter::pixelFilteredIsOn (const QImage &image,
@@ -129,43 +256,47 @@ bool ColorFilter::pixelFilteredIsOn (const QImage &image,
       (x < image.width()) &&
       (y < image.height())) {
 
-    // Pixel is on if it is closer to black than white in gray scale. This test must be performed
-    // on little endian and big endian systems, with or without alpha bits (which are typically high bits);
-    const int BLACK_WHITE_THRESHOLD = 255 / 2; // Put threshold in middle of range
-    int gray = qGray (pixelRGB (image, x, y));
-    rtn = (gray < BLACK_WHITE_THRESHOLD);
+    rtn = rgbFilteredIsOn (pixelRGB (image, x, y));
 
   }
 
   return rtn;
 }
 
+void ColorFilter::pixelsRgbToZeroToOneOrMinusOne (ColorFilterMode colorFilterMode,
+                                                  const QRgb pixels [],
+                                                  int count,
+                                                  QRgb rgbBackground,
+                                                  double s []) const
+{
+  if (m_strategies.contains (colorFilterMode)) {
+
+    const ColorFilterStrategyAbstractBase *strategy = m_strategies [colorFilterMode];
+    strategy->pixelsRgbToZeroToOne (pixels,
+                                    count,
+                                    rgbBackground,
+                                    s);
+
+  } else {
+
+    ENGAUGE_ASSERT (false);
+
+  }
+}
+
 bool ColorFilter::pixelUnfilteredIsOn (ColorFilterMode colorFilterMode,
                                        const QColor &pixel,
                                        QRgb rgbBackground,
                                        double low0To1,
                                        double high0To1) const
 {
-  bool rtn = false;
-
   double s = pixelToZeroToOneOrMinusOne (colorFilterMode,
                                          pixel,
                                          rgbBackground);
-  if (s >= 0.0) {
-    if (low0To1 <= high0To1) {
 
-      // Single valid range
-      rtn = (low0To1 <= s) && (s <= high0To1);
-
-    } else {
-
-      // Two ranges
-      rtn = (s <= high0To1) || (low0To1 <= s);
-
-    }
-  }
-
-  return rtn;
+  return zeroToOneIsOn (s,
+                        low0To1,
+                        high0To1);
 }
 
 double ColorFilter::pixelToZeroToOneOrMinusOne (ColorFilterMode colorFilterMode,
@@ -187,6 +318,38 @@ double ColorFilter::pixelToZeroToOneOrMinusOne (ColorFilterMode colorFilterMode,
   }
 }
 
+bool ColorFilter::rgbFilteredIsOn (QRgb rgb)
+{
+  // Pixel is on if it is closer to black than white in gray scale. This test must be performed
+  // on little endian and big endian systems, with or without alpha bits (which are typically high bits);
+  const int BLACK_WHITE_THRESHOLD = 255 / 2; // Put threshold in middle of range
+  int gray = qGray (rgb);
+  return (gray < BLACK_WHITE_THRESHOLD);
+}
+
+bool ColorFilter::zeroToOneIsOn (double s,
+                                 double low0To1,
+                                 double high0To1)
+{
+  bool rtn = false;
+
+  if (s >= 0.0) {
+    if (low0To1 <= high0To1) {
+
+      // Single valid range
+      rtn = (low0To1 <= s) && (s <= high0To1);
+
+    } else {
+
+      // Two ranges
+      rtn = (s <= high0To1) || (low0To1 <= s);
+
+    }
+  }
+
+  return rtn;
+}
+
 int ColorFilter::zeroToOneToValue (ColorFilterMode colorFilterMode,
                                    double s) const
 {
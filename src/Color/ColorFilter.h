@@ -7,14 +7,16 @@
 #ifndef COLOR_FILTER_H
 #define COLOR_FILTER_H
 
-#include "ColorFilterEntry.h"
+#include "ColorFilterLookupTable.h"
 #include "ColorFilterMode.h"
+#include <QColor>
 #include <QList>
 #include <QMap>
 #include <QRgb>
 
 class ColorFilterStrategyAbstractBase;
 class QImage;
+class QPixmap;
 
 /// Class for filtering image to remove unimportant information.
 class ColorFilter
@@ -35,11 +37,22 @@ public:
                     double high,
                     QRgb rgbBackground);
 
+  /// Return the shared lookup table for the specified parameters, creating an empty one if it is not already cached. Only
+  /// a few of the most recently used tables are kept, since each one takes 16 megabytes. Tables do not depend on the
+  /// thresholds, so changing them never creates a new table
+  ColorFilterLookupTablePtr lookupTable (ColorFilterMode colorFilterMode,
+                                         QRgb rgbBackground) const;
+
   /// Identify the margin color of the image, which is defined as the most common color in the four margins. For speed,
   /// only pixels in the four borders are examined, with the results from those borders safely representing the most
-  /// common color of the entire margin areas.
+  /// common color of the entire margin areas. The result is remembered for the image, so later calls with the same
+  /// image (or a shallow copy of it) return immediately.
   QRgb marginColor(const QImage *image) const;
 
+  /// Same as the QImage version, except the result is remembered for the pixmap, so the pixmap is only converted to an
+  /// image the first time. Callers working from the document pixmap should prefer this version
+  QRgb marginColor(const QPixmap &pixmap) const;
+
   /// Return true if specified filtered pixel is on
   bool pixelFilteredIsOn (const QImage &image,
                           int x,
@@ -51,6 +64,13 @@ public:
                                      const QColor &pixel,
                                      QRgb rgbBackground) const;
 
+  /// Apply pixelToZeroToOneOrMinusOne to an array of raw QRgb pixels, using vectorized code when the cpu supports it
+  void pixelsRgbToZeroToOneOrMinusOne (ColorFilterMode colorFilterMode,
+                                       const QRgb pixels [],
+                                       int count,
+                                       QRgb rgbBackground,
+                                       double s []) const;
+
   /// Return true if specified unfiltered pixel is on
   bool pixelUnfilteredIsOn (ColorFilterMode colorFilterMode,
                             const QColor &pixel,
@@ -58,6 +78,14 @@ public:
                             double low0To1,
                             double high0To1) const;
 
+  /// Return true if the specified filtered pixel value is on. Filtered pixels are on when closer to black than white
+  static bool rgbFilteredIsOn (QRgb rgb);
+
+  /// Apply low and high thresholds to a normalized pixel value from pixelToZeroToOneOrMinusOne
+  static bool zeroToOneIsOn (double s,
+                             double low0To1,
+                             double high0To1);
+
   /// Inverse of pixelToZeroToOneOrMinusOne
   int zeroToOneToValue (ColorFilterMode colorFilterMode,
                         double s) const;
@@ -66,10 +94,8 @@ private:
 
   void createStrategies ();
 
-  typedef QList<ColorFilterEntry> ColorList;
-
-  void mergePixelIntoColorCounts (QRgb pixel,
-                                  ColorList &colorCounts) const;
+  // Margin color computation behind the caching in marginColor
+  QRgb marginColorUncached (const QImage &image) const;
 
   // Strategies for mode-specific computations
   QMap<ColorFilterMode, ColorFilterStrategyAbstractBase*> m_strategies;
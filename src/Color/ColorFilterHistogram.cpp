@@ -6,8 +6,22 @@
 
 #include "ColorFilter.h"
 #include "ColorFilterHistogram.h"
+#include "ColorFilterStripe.h"
 #include "EngaugeAssert.h"
+#include <QCache>
+#include <QFuture>
+#include <QHash>
 #include <QImage>
+#include <QList>
+#include <QMutexLocker>
+#include <QPixmap>
+#include <QtConcurrentRun>
+#include <QVector>
+
+// Recently computed bin counts of all modes, keyed by QPixmap::cacheKey. Each entry is small, so the default capacity
+// of one hundred entries is plenty
+static QCache<qint64, QVector<int> > histogramCache;
+static QMutex histogramCacheMutex;
 
 ColorFilterHistogram::ColorFilterHistogram()
 {
@@ -18,12 +32,18 @@ int ColorFilterHistogram::binFromPixel (const ColorFilter &filter,
                                         const QColor &pixel,
                                         const QRgb &rgbBackground) const
 {
-  // Instead of mapping from s=0 through 1 to bin=0 through HISTOGRAM_BINS-1, we
-  // map it to bin=1 through HISTOGRAM_BINS-2 so first and last bin are zero. The
-  // result is a peak at the start or end is complete and easier to read
   double s = filter.pixelToZeroToOneOrMinusOne (colorFilterMode,
                                                 pixel,
                                                 rgbBackground);
+
+  return binFromZeroToOne (s);
+}
+
+int ColorFilterHistogram::binFromZeroToOne (double s) const
+{
+  // Instead of mapping from s=0 through 1 to bin=0 through HISTOGRAM_BINS-1, we
+  // map it to bin=1 through HISTOGRAM_BINS-2 so first and last bin are zero. The
+  // result is a peak at the start or end is complete and easier to read
   ENGAUGE_ASSERT (s <= 1.0);
 
   int bin = -1;
@@ -37,42 +57,139 @@ int ColorFilterHistogram::binFromPixel (const ColorFilter &filter,
   return bin;
 }
 
-void ColorFilterHistogram::generate (const ColorFilter &filter,
-                                     double histogramBins [],
-                                     ColorFilterMode colorFilterMode,
-                                     const QImage &image,
-                                     int &maxBinCount) const
+QVector<int> ColorFilterHistogram::countsForImage (const ColorFilter &filter,
+                                                   const QImage &image,
+                                                   QRgb rgbBackground) const
 {
-  // Initialize histogram bins
-  int bin;
-  for (bin = 0; bin < HISTOGRAM_BINS (); bin++) {
-    histogramBins [bin] = 0;
+  // Scan lines are read directly, so image must have 32 bit pixels
+  QImage image32 = ColorFilterStripe::imageWith32BitPixels (image);
+
+  QList<QPair<int, int> > rows = ColorFilterStripe::stripeRows (0,
+                                                                image32.height ());
+
+  QList<QFuture<QVector<int> > > futures;
+  for (int stripe = 0; stripe < rows.count (); stripe++) {
+    futures << QtConcurrent::run (this,
+                                  &ColorFilterHistogram::countsForRows,
+                                  &filter,
+                                  (const QImage *) &image32,
+                                  rows [stripe].first,
+                                  rows [stripe].second,
+                                  rgbBackground);
   }
 
-  QRgb rgbBackground = filter.marginColor(&image);
+  // Counts are integers so the sum does not depend on the order of the stripes
+  QVector<int> counts (NUM_COLOR_FILTER_MODES * HISTOGRAM_BINS (), 0);
+  for (int stripe = 0; stripe < futures.count (); stripe++) {
+    QVector<int> countsStripe = futures [stripe].result ();
+    for (int i = 0; i < counts.count (); i++) {
+      counts [i] += countsStripe [i];
+    }
+  }
 
-  // Populate histogram bins
-  maxBinCount = 0;
-  for (int x = 0; x < image.width(); x++) {
-    for (int y = 0; y < image.height(); y++) {
-
-      QColor pixel (image.pixel (x, y));
-      int bin = binFromPixel (filter,
-                              colorFilterMode,
-                              pixel,
-                              rgbBackground);
+  return counts;
+}
+
+QVector<int> ColorFilterHistogram::countsForRows (const ColorFilter *filter,
+                                                  const QImage *image32,
+                                                  int yStart,
+                                                  int yStop,
+                                                  QRgb rgbBackground) const
+{
+  // Pixels are counted by color first. Runs of identical pixels, like the background, need only one hash lookup
+  QHash<QRgb, int> colorCounts;
+  int width = image32->width ();
+  for (int y = yStart; y < yStop; y++) {
+
+    const QRgb *line = (const QRgb *) image32->constScanLine (y);
+
+    int x = 0;
+    while (x < width) {
+
+      QRgb pixel = line [x] | ColorFilterStripe::ALPHA_OPAQUE ();
+      int xStart = x;
+      while ((x < width) && ((line [x] | ColorFilterStripe::ALPHA_OPAQUE ()) == pixel)) {
+        ++x;
+      }
+
+      colorCounts [pixel] += x - xStart;
+    }
+  }
+
+  // Each distinct color is run through the (vectorized) filter once per mode
+  QVector<QRgb> pixels;
+  QVector<int> pixelCounts;
+  pixels.reserve (colorCounts.count ());
+  pixelCounts.reserve (colorCounts.count ());
+  QHash<QRgb, int>::const_iterator itr;
+  for (itr = colorCounts.begin (); itr != colorCounts.end (); itr++) {
+    pixels.append (itr.key ());
+    pixelCounts.append (itr.value ());
+  }
+
+  QVector<int> counts (NUM_COLOR_FILTER_MODES * HISTOGRAM_BINS (), 0);
+  QVector<double> values (pixels.count ());
+  for (int mode = 0; mode < NUM_COLOR_FILTER_MODES; mode++) {
+
+    filter->pixelsRgbToZeroToOneOrMinusOne ((ColorFilterMode) mode,
+                                            pixels.constData (),
+                                            pixels.count (),
+                                            rgbBackground,
+                                            values.data ());
+
+    int *countsMode = counts.data () + mode * HISTOGRAM_BINS ();
+    for (int i = 0; i < pixels.count (); i++) {
+
+      int bin = binFromZeroToOne (values [i]);
       if (bin >= 0) {
 
         ENGAUGE_ASSERT ((FIRST_NON_EMPTY_BIN_AT_START () <= bin) &&
                         (LAST_NON_EMPTY_BIN_AT_END () >= bin));
-        ++(histogramBins [bin]);
-
-        if (histogramBins [bin] > maxBinCount) {
-          maxBinCount = histogramBins [bin];
-        }
+        countsMode [bin] += pixelCounts [i];
       }
     }
   }
+
+  return counts;
+}
+
+void ColorFilterHistogram::generate (const ColorFilter &filter,
+                                     double histogramBins [],
+                                     ColorFilterMode colorFilterMode,
+                                     const QPixmap &pixmap,
+                                     int &maxBinCount) const
+{
+  ENGAUGE_ASSERT (colorFilterMode < NUM_COLOR_FILTER_MODES);
+
+  QVector<int> counts;
+  {
+    QMutexLocker locker (&histogramCacheMutex);
+    QVector<int> *countsCached = histogramCache.object (pixmap.cacheKey ());
+    if (countsCached != 0) {
+      counts = *countsCached;
+    }
+  }
+
+  if (counts.isEmpty ()) {
+
+    // Computed without holding the mutex, since this takes a while. Two threads computing the same histogram at once
+    // would just do the work twice
+    QRgb rgbBackground = filter.marginColor (pixmap);
+    counts = countsForImage (filter,
+                             pixmap.toImage (),
+                             rgbBackground);
+
+    QMutexLocker locker (&histogramCacheMutex);
+    histogramCache.insert (pixmap.cacheKey (),
+                           new QVector<int> (counts));
+  }
+
+  const int *countsMode = counts.constData () + colorFilterMode * HISTOGRAM_BINS ();
+  maxBinCount = 0;
+  for (int bin = 0; bin < HISTOGRAM_BINS (); bin++) {
+    histogramBins [bin] = countsMode [bin];
+    maxBinCount = qMax (maxBinCount, countsMode [bin]);
+  }
 }
 
 int ColorFilterHistogram::valueFromBin (const ColorFilter &filter,
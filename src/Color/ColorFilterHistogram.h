@@ -7,11 +7,14 @@
 #ifndef COLOR_FILTER_HISTOGRAM_H
 #define COLOR_FILTER_HISTOGRAM_H
 
+#include "ColorFilterMode.h"
 #include <QRgb>
+#include <QVector>
 
 class ColorFilter;
 class QColor;
 class QImage;
+class QPixmap;
 
 /// Class that generates a histogram according to the current filter.
 class ColorFilterHistogram
@@ -29,10 +32,13 @@ public:
   /// Generate the histogram. The resolution is coarse since
   /// -# finer resolution is not needed
   /// -# this smooths out the curve
+  ///
+  /// The histograms of all modes are computed together in one pass through the image, and remembered for the pixmap,
+  /// so switching between modes for the same pixmap costs nothing after the first call
   void generate (const ColorFilter &filter,
                  double histogramBins [],
                  ColorFilterMode colorFilterMode,
-                 const QImage &image,
+                 const QPixmap &pixmap,
                  int &maxBinCount) const;
 
   /// Number of histogram bins
@@ -45,6 +51,22 @@ public:
 
 private:
 
+  // Compute histogram bin number from output of ColorFilter::pixelToZeroToOneOrMinusOne
+  int binFromZeroToOne (double s) const;
+
+  // Bin counts of all modes for rows yStart through yStop-1 of a 32 bit image. Bins of mode m start at index
+  // m * HISTOGRAM_BINS. Only the distinct colors in the rows are run through the filter
+  QVector<int> countsForRows (const ColorFilter *filter,
+                              const QImage *image32,
+                              int yStart,
+                              int yStop,
+                              QRgb rgbBackground) const;
+
+  // Bin counts of all modes for the entire image, computed in parallel horizontal stripes
+  QVector<int> countsForImage (const ColorFilter &filter,
+                               const QImage &image,
+                               QRgb rgbBackground) const;
+
   static int FIRST_NON_EMPTY_BIN_AT_START () { return 1; }
   static int LAST_NON_EMPTY_BIN_AT_END () { return ColorFilterHistogram::HISTOGRAM_BINS () - 2; }
 };
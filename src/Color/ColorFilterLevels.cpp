@@ -0,0 +1,206 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#include "ColorFilter.h"
+#include "ColorFilterLevels.h"
+#include "ColorFilterLookupTable.h"
+#include "ColorFilterStripe.h"
+#include "EngaugeAssert.h"
+#include <QFuture>
+#include <QList>
+#include <QPair>
+#include <QtConcurrentRun>
+
+ColorFilterLevels::ColorFilterLevels() :
+  m_colorFilterMode (NUM_COLOR_FILTER_MODES),
+  m_rgbBackground (0),
+  m_rowsComputed (0)
+{
+}
+
+ColorFilterLevels::ColorFilterLevels(const QImage &imageOriginal,
+                                     ColorFilterMode colorFilterMode,
+                                     QRgb rgbBackground,
+                                     bool computeAllRows) :
+  m_imageOriginal (ColorFilterStripe::imageWith32BitPixels (imageOriginal)),
+  m_colorFilterMode (colorFilterMode),
+  m_rgbBackground (rgbBackground),
+  m_levels (imageOriginal.width () * imageOriginal.height ()),
+  m_rowsComputed (0)
+{
+  if (computeAllRows) {
+    computeRows (m_imageOriginal.height ());
+  }
+}
+
+ColorFilterMode ColorFilterLevels::colorFilterMode () const
+{
+  return m_colorFilterMode;
+}
+
+void ColorFilterLevels::computeLevels (const ColorFilter *filter,
+                                       uchar *levels,
+                                       int yStart,
+                                       int yStop) const
+{
+  int width = m_imageOriginal.width ();
+  QVector<QRgb> pixels (width);
+  QVector<double> values (width);
+
+  for (int y = yStart; y < yStop; y++) {
+
+    const QRgb *line = (const QRgb *) m_imageOriginal.constScanLine (y);
+    for (int x = 0; x < width; x++) {
+      pixels [x] = line [x] | ColorFilterStripe::ALPHA_OPAQUE ();
+    }
+
+    // Each row goes through the (vectorized) strategy at once
+    filter->pixelsRgbToZeroToOneOrMinusOne (m_colorFilterMode,
+                                            pixels.constData (),
+                                            width,
+                                            m_rgbBackground,
+                                            values.data ());
+
+    uchar *levelsLine = levels + y * width;
+    for (int x = 0; x < width; x++) {
+      if (pixels [x] == m_rgbBackground) {
+        levelsLine [x] = ColorFilterLookupTable::CODE_NONE ();
+      } else {
+        levelsLine [x] = ColorFilterLookupTable::codeFromZeroToOne (values [x]);
+      }
+    }
+  }
+}
+
+void ColorFilterLevels::computeRows (int rowCount)
+{
+  int yStopAll = qMin (m_imageOriginal.height (), m_rowsComputed + rowCount);
+
+  ColorFilter filter;
+  QList<QPair<int, int> > rows = ColorFilterStripe::stripeRows (m_rowsComputed,
+                                                                yStopAll);
+  uchar *levels = m_levels.data ();
+
+  QList<QFuture<void> > futures;
+  for (int stripe = 0; stripe < rows.count (); stripe++) {
+    futures << QtConcurrent::run (this,
+                                  &ColorFilterLevels::computeLevels,
+                                  (const ColorFilter *) &filter,
+                                  levels,
+                                  rows [stripe].first,
+                                  rows [stripe].second);
+  }
+  for (int stripe = 0; stripe < futures.count (); stripe++) {
+    futures [stripe].waitForFinished ();
+  }
+
+  m_rowsComputed = yStopAll;
+}
+
+bool ColorFilterLevels::isComplete () const
+{
+  return m_rowsComputed == m_imageOriginal.height ();
+}
+
+void ColorFilterLevels::threshold (double low,
+                                   double high,
+                                   BitPlane &bitsFiltered) const
+{
+  ENGAUGE_ASSERT (m_imageOriginal.width () == bitsFiltered.width ());
+  ENGAUGE_ASSERT (m_imageOriginal.height () == bitsFiltered.height ());
+  ENGAUGE_ASSERT (isComplete ());
+
+  // Levels use the same codes as the shared lookup tables of ColorFilter::filterImage
+  QVector<uchar> results = ColorFilterLookupTable::thresholdResults (low,
+                                                                     high);
+
+  ColorFilter filter;
+  QList<QPair<int, int> > rows = ColorFilterStripe::stripeRows (0,
+                                                                m_imageOriginal.height ());
+  quint64 *wordsFiltered = bitsFiltered.scanLine (0); // Obtained here so no thread triggers a detach
+  int wordsPerLine = bitsFiltered.wordsPerLine ();
+
+  QList<QFuture<void> > futures;
+  for (int stripe = 0; stripe < rows.count (); stripe++) {
+
+    // QtConcurrent::run takes at most five arguments, so the output rows are located here
+    futures << QtConcurrent::run (this,
+                                  &ColorFilterLevels::thresholdRows,
+                                  (const ColorFilter *) &filter,
+                                  results.constData (),
+                                  QPair<double, double> (low, high),
+                                  wordsFiltered + rows [stripe].first * wordsPerLine,
+                                  rows [stripe]);
+  }
+  for (int stripe = 0; stripe < futures.count (); stripe++) {
+    futures [stripe].waitForFinished ();
+  }
+}
+
+void ColorFilterLevels::thresholdRows (const ColorFilter *filter,
+                                       const uchar *results,
+                                       QPair<double, double> lowHigh,
+                                       quint64 *wordsFiltered,
+                                       QPair<int, int> rows) const
+{
+  const int BITS_PER_WORD = 64;
+
+  int width = m_imageOriginal.width ();
+  int wordsPerLine = (width + BITS_PER_WORD - 1) / BITS_PER_WORD; // Same as BitPlane
+  QVector<int> exactColumns;
+  QVector<QRgb> exactPixels;
+  QVector<double> exactValues;
+
+  for (int y = rows.first; y < rows.second; y++) {
+
+    const uchar *levelsLine = m_levels.constData () + y * width;
+    quint64 *wordsLine = wordsFiltered + (y - rows.first) * wordsPerLine;
+
+    exactColumns.clear ();
+    for (int word = 0; word < wordsPerLine; word++) {
+
+      // Each word is assembled in a register, with its pixels in the least significant bits first
+      int xStart = word * BITS_PER_WORD;
+      int xStop = qMin (width, xStart + BITS_PER_WORD);
+      quint64 bits = 0;
+      for (int x = xStart; x < xStop; x++) {
+        uchar result = results [levelsLine [x]];
+        if (result == COLOR_FILTER_THRESHOLD_ON) {
+          bits |= (quint64) 1 << (x - xStart);
+        } else if (result == COLOR_FILTER_THRESHOLD_EXACT) {
+          exactColumns.append (x);
+        }
+      }
+      wordsLine [word] = bits;
+    }
+
+    if (exactColumns.count () > 0) {
+
+      // Pixels sharing a level with a threshold are converted again at full precision
+      const QRgb *lineOriginal = (const QRgb *) m_imageOriginal.constScanLine (y);
+      exactPixels.resize (exactColumns.count ());
+      exactValues.resize (exactColumns.count ());
+      for (int i = 0; i < exactColumns.count (); i++) {
+        exactPixels [i] = lineOriginal [exactColumns [i]] | ColorFilterStripe::ALPHA_OPAQUE ();
+      }
+
+      filter->pixelsRgbToZeroToOneOrMinusOne (m_colorFilterMode,
+                                              exactPixels.constData (),
+                                              exactPixels.count (),
+                                              m_rgbBackground,
+                                              exactValues.data ());
+
+      for (int i = 0; i < exactColumns.count (); i++) {
+        if (ColorFilter::zeroToOneIsOn (exactValues [i],
+                                        lowHigh.first,
+                                        lowHigh.second)) {
+          int x = exactColumns [i];
+          wordsLine [x / BITS_PER_WORD] |= (quint64) 1 << (x % BITS_PER_WORD);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,80 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef COLOR_FILTER_LEVELS_H
+#define COLOR_FILTER_LEVELS_H
+
+#include "BitPlane.h"
+#include "ColorFilterMode.h"
+#include <QImage>
+#include <QPair>
+#include <QRgb>
+#include <QVector>
+
+class ColorFilter;
+
+/// Image converted, for one color filter mode, into an 8 bit plane of quantized pixelToZeroToOneOrMinusOne values. The
+/// expensive per pixel conversion is done once by the constructor, after which each new pair of low and high thresholds
+/// only needs the cheap pass in threshold. This suits the color filter dialog, where the thresholds change continuously
+/// while the user drags the dividers.
+///
+/// Quantization never changes the result. Pixels whose level is strictly between the levels of the thresholds are
+/// decided by their level alone, and only pixels that share a level with a threshold are converted again at full
+/// precision. So threshold gives exactly the same pixels as ColorFilter::filterImage
+class ColorFilterLevels
+{
+public:
+  /// Default constructor gives empty levels, with no mode
+  ColorFilterLevels();
+
+  /// Constructor for the levels of every pixel in the image for the specified mode. If computeAllRows is false then
+  /// the levels are computed afterwards, a few rows at a time, by computeRows so the work can be interrupted
+  ColorFilterLevels(const QImage &imageOriginal,
+                    ColorFilterMode colorFilterMode,
+                    QRgb rgbBackground,
+                    bool computeAllRows = true);
+
+  /// Mode used for the levels, or NUM_COLOR_FILTER_MODES if the levels are empty
+  ColorFilterMode colorFilterMode () const;
+
+  /// Compute the levels of the next rowCount rows that have not been computed yet
+  void computeRows (int rowCount);
+
+  /// True once the levels of all rows have been computed
+  bool isComplete () const;
+
+  /// Apply the thresholds to the levels, turning on the bits of the on pixels. The bit plane must have the same size as
+  /// the original image. It is 32 times smaller than a filtered 32 bit image, which suits sending it to the gui thread.
+  /// All rows must have been computed
+  void threshold (double low,
+                  double high,
+                  BitPlane &bitsFiltered) const;
+
+private:
+
+  // Compute levels for rows yStart through yStop-1
+  void computeLevels (const ColorFilter *filter,
+                      uchar *levels,
+                      int yStart,
+                      int yStop) const;
+
+  // Apply the thresholds to the rows from rows.first to rows.second-1, using the per level results from
+  // ColorFilterLookupTable::thresholdResults. The words start at the first of those rows
+  void thresholdRows (const ColorFilter *filter,
+                      const uchar *results,
+                      QPair<double, double> lowHigh,
+                      quint64 *wordsFiltered,
+                      QPair<int, int> rows) const;
+
+  QImage m_imageOriginal; // Always 32 bits per pixel, for reading scan lines and for converting threshold pixels again
+  ColorFilterMode m_colorFilterMode;
+  QRgb m_rgbBackground;
+
+  QVector<uchar> m_levels; // One ColorFilterLookupTable code per pixel, in row major order
+  int m_rowsComputed; // Rows before this one have been computed
+};
+
+#endif // COLOR_FILTER_LEVELS_H
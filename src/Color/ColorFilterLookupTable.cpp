@@ -0,0 +1,71 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#include "ColorFilterLookupTable.h"
+#include <qmath.h>
+
+const int NUM_RGB_COLORS = 256 * 256 * 256;
+
+// Quantized values from zero to one are stored as the codes from CODE_LEVEL_MIN through CODE_LEVEL_MAX
+const int CODE_LEVEL_MIN = ColorFilterLookupTable::CODE_NONE () + 1;
+const int CODE_LEVEL_MAX = ColorFilterLookupTable::NUM_CODES () - 1;
+
+ColorFilterLookupTable::ColorFilterLookupTable(ColorFilterMode colorFilterMode,
+                                               QRgb rgbBackground) :
+  m_colorFilterMode (colorFilterMode),
+  m_rgbBackground (rgbBackground),
+  m_codes (NUM_RGB_COLORS, (unsigned char) UNKNOWN ())
+{
+}
+
+int ColorFilterLookupTable::codeFromZeroToOne (double s)
+{
+  if (s < 0.0) {
+    return CODE_NONE ();
+  }
+
+  // Truncation preserves order, so a level below the level of a threshold belongs to a value below the threshold
+  int levelMax = CODE_LEVEL_MAX - CODE_LEVEL_MIN;
+  return CODE_LEVEL_MIN + qMin (levelMax, (int) (s * (levelMax + 1)));
+}
+
+bool ColorFilterLookupTable::matches (ColorFilterMode colorFilterMode,
+                                      QRgb rgbBackground) const
+{
+  return (colorFilterMode == m_colorFilterMode) &&
+         (rgbBackground == m_rgbBackground);
+}
+
+QMutex &ColorFilterLookupTable::mutex ()
+{
+  return m_mutex;
+}
+
+QVector<uchar> ColorFilterLookupTable::thresholdResults (double low,
+                                                         double high)
+{
+  // Values in the same level as a threshold cannot be decided from the level. Zero and higher values are always at or
+  // above a low threshold of zero, so that common case needs no exact conversions for the lowest level
+  int codeLow = ((low <= 0.0) ? CODE_NONE () : codeFromZeroToOne (low));
+  int codeHigh = codeFromZeroToOne (qMax (0.0, high));
+
+  QVector<uchar> results (NUM_CODES (), COLOR_FILTER_THRESHOLD_OFF);
+  for (int code = CODE_LEVEL_MIN; code <= CODE_LEVEL_MAX; code++) {
+    if ((code == codeLow) || (code == codeHigh)) {
+      results [code] = COLOR_FILTER_THRESHOLD_EXACT;
+    } else if (low <= high) {
+      if ((codeLow < code) && (code < codeHigh)) {
+        results [code] = COLOR_FILTER_THRESHOLD_ON;
+      }
+    } else {
+      if ((code < codeHigh) || (codeLow < code)) {
+        results [code] = COLOR_FILTER_THRESHOLD_ON;
+      }
+    }
+  }
+
+  return results;
+}
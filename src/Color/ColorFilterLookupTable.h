@@ -0,0 +1,84 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef COLOR_FILTER_LOOKUP_TABLE_H
+#define COLOR_FILTER_LOOKUP_TABLE_H
+
+#include "ColorFilterMode.h"
+#include <QMutex>
+#include <QRgb>
+#include <QSharedPointer>
+#include <QVector>
+
+/// Result of the low and high thresholds for all pixels with one code, from ColorFilterLookupTable::thresholdResults
+enum ColorFilterThresholdResult {
+  COLOR_FILTER_THRESHOLD_OFF,
+  COLOR_FILTER_THRESHOLD_ON,
+  COLOR_FILTER_THRESHOLD_EXACT // Code shares its level with a threshold, so the pixel must be converted again
+};
+
+/// Lookup table from 24 bit RGB value to a small integer result of the color filter computations, so each distinct color
+/// in an image goes through the (relatively expensive) ColorFilterStrategyAbstractBase computation only once. Entries
+/// are filled in lazily, as colors are encountered.
+///
+/// The codes hold quantized pixelToZeroToOneOrMinusOne values rather than on/off results, so one table serves every pair
+/// of low and high thresholds, and dragging the dividers in the color filter dialog does not create new tables.
+/// Quantization never changes the result, since thresholdResults marks the levels that are shared with a threshold and
+/// those pixels are converted again at full precision. Tables are shared through ColorFilter::lookupTable. The mutex
+/// must be held while unknown codes are found and saved, but a code never changes once saved so codes that are known
+/// to be saved can be read without it
+class ColorFilterLookupTable
+{
+public:
+  /// Single constructor
+  ColorFilterLookupTable(ColorFilterMode colorFilterMode,
+                         QRgb rgbBackground);
+
+  /// Code for pixels that are never on, which are background pixels and pixels that cannot be converted
+  static int CODE_NONE () { return UNKNOWN () + 1; }
+
+  /// Stored code for the pixel, or UNKNOWN if that color has not been encountered yet. Alpha bits are ignored
+  inline int code (QRgb pixel) const { return m_codes [pixel & RGB_MASK]; }
+
+  /// Code for a pixelToZeroToOneOrMinusOne value. Values from zero to one are quantized into levels, and negative
+  /// values give CODE_NONE
+  static int codeFromZeroToOne (double s);
+
+  /// Return true if this table was built for the specified parameters
+  bool matches (ColorFilterMode colorFilterMode,
+                QRgb rgbBackground) const;
+
+  /// Mutex that must be locked while finding and saving unknown codes
+  QMutex &mutex ();
+
+  /// Save the code for the pixel. Alpha bits are ignored
+  inline void setCode (QRgb pixel, int code) { m_codes [pixel & RGB_MASK] = (unsigned char) code; }
+
+  /// Result of the low and high thresholds for each of the NUM_CODES codes. See ColorFilter::zeroToOneIsOn
+  static QVector<uchar> thresholdResults (double low,
+                                          double high);
+
+  /// Code for color not encountered yet. Stored codes are greater than this
+  static int UNKNOWN () { return 0; }
+
+  /// Number of distinct codes
+  static int NUM_CODES () { return 256; }
+
+private:
+  ColorFilterLookupTable();
+
+  static const QRgb RGB_MASK = 0x00ffffff;
+
+  ColorFilterMode m_colorFilterMode;
+  QRgb m_rgbBackground;
+
+  QVector<unsigned char> m_codes; // One entry per 24 bit color
+  QMutex m_mutex;
+};
+
+typedef QSharedPointer<ColorFilterLookupTable> ColorFilterLookupTablePtr;
+
+#endif // COLOR_FILTER_LOOKUP_TABLE_H
@@ -0,0 +1,470 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#include "ColorFilterSimd.h"
+#include <qmath.h>
+
+// Vectorized code is only built for x86 and x86_64 processors with at least SSE2. Everywhere else, every method
+// processes zero pixels so the scalar strategy code does all the work
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define COLOR_FILTER_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef COLOR_FILTER_SIMD_X86
+
+// Gcc and clang only generate AVX2 instructions for functions that are explicitly marked, so the rest of the
+// application still runs on cpus without AVX2. Msvc allows AVX2 intrinsics anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_FUNCTION __attribute__ ((target ("avx2")))
+#else
+#define AVX2_FUNCTION
+#endif
+
+// Constants matching those in the scalar strategies
+const double RGB_8_TO_16_BITS = 0x101; // QColor stores each component as 16 bits
+const double USHRT_MAX_DOUBLE = 65535.0;
+const double HUE_SCALE = 36000.0; // QColor stores hue in hundredths of a degree
+const int PIXELS_PER_SSE2 = 2;
+const int PIXELS_PER_AVX2 = 8; // Two vectors of four doubles
+
+// SSE2 helpers. Rounding is done like qRound, which is int(x+0.5) for the non-negative values used here
+
+static inline void loadSse2 (const QRgb *pixels,
+                             __m128d &r,
+                             __m128d &g,
+                             __m128d &b)
+{
+  const __m128i MASK = _mm_set1_epi32 (0xff);
+  __m128i p = _mm_loadl_epi64 ((const __m128i *) pixels);
+  r = _mm_cvtepi32_pd (_mm_and_si128 (_mm_srli_epi32 (p, 16), MASK));
+  g = _mm_cvtepi32_pd (_mm_and_si128 (_mm_srli_epi32 (p, 8), MASK));
+  b = _mm_cvtepi32_pd (_mm_and_si128 (p, MASK));
+}
+
+static inline __m128d roundSse2 (__m128d x)
+{
+  return _mm_cvtepi32_pd (_mm_cvttpd_epi32 (_mm_add_pd (x, _mm_set1_pd (0.5))));
+}
+
+static inline __m128d selectSse2 (__m128d mask,
+                                  __m128d ifTrue,
+                                  __m128d ifFalse)
+{
+  return _mm_or_pd (_mm_and_pd (mask, ifTrue),
+                    _mm_andnot_pd (mask, ifFalse));
+}
+
+// AVX2 helpers. Integer unpacking of eight pixels uses AVX2, and the floating point math uses four doubles at a time
+
+AVX2_FUNCTION static inline void loadAvx2 (const QRgb *pixels,
+                                           __m256d r [2],
+                                           __m256d g [2],
+                                           __m256d b [2])
+{
+  const __m256i MASK = _mm256_set1_epi32 (0xff);
+  __m256i p = _mm256_loadu_si256 ((const __m256i *) pixels);
+  __m256i ri = _mm256_and_si256 (_mm256_srli_epi32 (p, 16), MASK);
+  __m256i gi = _mm256_and_si256 (_mm256_srli_epi32 (p, 8), MASK);
+  __m256i bi = _mm256_and_si256 (p, MASK);
+  r [0] = _mm256_cvtepi32_pd (_mm256_castsi256_si128 (ri));
+  r [1] = _mm256_cvtepi32_pd (_mm256_extracti128_si256 (ri, 1));
+  g [0] = _mm256_cvtepi32_pd (_mm256_castsi256_si128 (gi));
+  g [1] = _mm256_cvtepi32_pd (_mm256_extracti128_si256 (gi, 1));
+  b [0] = _mm256_cvtepi32_pd (_mm256_castsi256_si128 (bi));
+  b [1] = _mm256_cvtepi32_pd (_mm256_extracti128_si256 (bi, 1));
+}
+
+AVX2_FUNCTION static inline __m256d roundAvx2 (__m256d x)
+{
+  return _mm256_cvtepi32_pd (_mm256_cvttpd_epi32 (_mm256_add_pd (x, _mm256_set1_pd (0.5))));
+}
+
+// Per vector computations, following the scalar strategies operation by operation
+
+static inline __m128d distanceSse2 (__m128d r,
+                                    __m128d g,
+                                    __m128d b,
+                                    __m128d rOrigin,
+                                    __m128d gOrigin,
+                                    __m128d bOrigin,
+                                    __m128d distanceMax)
+{
+  __m128d dr = _mm_sub_pd (r, rOrigin);
+  __m128d dg = _mm_sub_pd (g, gOrigin);
+  __m128d db = _mm_sub_pd (b, bOrigin);
+  __m128d sum = _mm_add_pd (_mm_add_pd (_mm_mul_pd (dr, dr),
+                                        _mm_mul_pd (dg, dg)),
+                            _mm_mul_pd (db, db));
+  return _mm_div_pd (_mm_sqrt_pd (sum), distanceMax);
+}
+
+AVX2_FUNCTION static inline __m256d distanceAvx2 (__m256d r,
+                                                  __m256d g,
+                                                  __m256d b,
+                                                  __m256d rOrigin,
+                                                  __m256d gOrigin,
+                                                  __m256d bOrigin,
+                                                  __m256d distanceMax)
+{
+  __m256d dr = _mm256_sub_pd (r, rOrigin);
+  __m256d dg = _mm256_sub_pd (g, gOrigin);
+  __m256d db = _mm256_sub_pd (b, bOrigin);
+  __m256d sum = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (dr, dr),
+                                              _mm256_mul_pd (dg, dg)),
+                               _mm256_mul_pd (db, db));
+  return _mm256_div_pd (_mm256_sqrt_pd (sum), distanceMax);
+}
+
+static inline __m128d hueSse2 (__m128d r8,
+                               __m128d g8,
+                               __m128d b8)
+{
+  const __m128d SCALE_8_TO_16 = _mm_set1_pd (RGB_8_TO_16_BITS);
+  const __m128d USHRT = _mm_set1_pd (USHRT_MAX_DOUBLE);
+  __m128d r = _mm_div_pd (_mm_mul_pd (r8, SCALE_8_TO_16), USHRT);
+  __m128d g = _mm_div_pd (_mm_mul_pd (g8, SCALE_8_TO_16), USHRT);
+  __m128d b = _mm_div_pd (_mm_mul_pd (b8, SCALE_8_TO_16), USHRT);
+  __m128d max = _mm_max_pd (_mm_max_pd (r, g), b);
+  __m128d min = _mm_min_pd (_mm_min_pd (r, g), b);
+  __m128d delta = _mm_sub_pd (max, min);
+
+  // All three branches of the scalar code are computed, and then the right one is selected. Achromatic pixels
+  // divide by zero here but are overwritten at the end
+  __m128d hueR = _mm_div_pd (_mm_sub_pd (g, b), delta);
+  __m128d hueG = _mm_add_pd (_mm_set1_pd (2.0), _mm_div_pd (_mm_sub_pd (b, r), delta));
+  __m128d hueB = _mm_add_pd (_mm_set1_pd (4.0), _mm_div_pd (_mm_sub_pd (r, g), delta));
+  __m128d hue = selectSse2 (_mm_cmpeq_pd (r, max),
+                            hueR,
+                            selectSse2 (_mm_cmpeq_pd (g, max),
+                                        hueG,
+                                        hueB));
+  hue = _mm_mul_pd (hue, _mm_set1_pd (60.0));
+  hue = _mm_add_pd (hue, _mm_and_pd (_mm_cmplt_pd (hue, _mm_setzero_pd ()),
+                                     _mm_set1_pd (360.0)));
+
+  __m128d s = _mm_div_pd (roundSse2 (_mm_mul_pd (hue, _mm_set1_pd (100.0))),
+                          _mm_set1_pd (HUE_SCALE));
+  return selectSse2 (_mm_cmpeq_pd (delta, _mm_setzero_pd ()),
+                     _mm_set1_pd (-1.0),
+                     s);
+}
+
+AVX2_FUNCTION static inline __m256d hueAvx2 (__m256d r8,
+                                             __m256d g8,
+                                             __m256d b8)
+{
+  const __m256d SCALE_8_TO_16 = _mm256_set1_pd (RGB_8_TO_16_BITS);
+  const __m256d USHRT = _mm256_set1_pd (USHRT_MAX_DOUBLE);
+  __m256d r = _mm256_div_pd (_mm256_mul_pd (r8, SCALE_8_TO_16), USHRT);
+  __m256d g = _mm256_div_pd (_mm256_mul_pd (g8, SCALE_8_TO_16), USHRT);
+  __m256d b = _mm256_div_pd (_mm256_mul_pd (b8, SCALE_8_TO_16), USHRT);
+  __m256d max = _mm256_max_pd (_mm256_max_pd (r, g), b);
+  __m256d min = _mm256_min_pd (_mm256_min_pd (r, g), b);
+  __m256d delta = _mm256_sub_pd (max, min);
+
+  __m256d hueR = _mm256_div_pd (_mm256_sub_pd (g, b), delta);
+  __m256d hueG = _mm256_add_pd (_mm256_set1_pd (2.0), _mm256_div_pd (_mm256_sub_pd (b, r), delta));
+  __m256d hueB = _mm256_add_pd (_mm256_set1_pd (4.0), _mm256_div_pd (_mm256_sub_pd (r, g), delta));
+  __m256d hue = _mm256_blendv_pd (_mm256_blendv_pd (hueB,
+                                                    hueG,
+                                                    _mm256_cmp_pd (g, max, _CMP_EQ_OQ)),
+                                  hueR,
+                                  _mm256_cmp_pd (r, max, _CMP_EQ_OQ));
+  hue = _mm256_mul_pd (hue, _mm256_set1_pd (60.0));
+  hue = _mm256_add_pd (hue, _mm256_and_pd (_mm256_cmp_pd (hue, _mm256_setzero_pd (), _CMP_LT_OQ),
+                                           _mm256_set1_pd (360.0)));
+
+  __m256d s = _mm256_div_pd (roundAvx2 (_mm256_mul_pd (hue, _mm256_set1_pd (100.0))),
+                             _mm256_set1_pd (HUE_SCALE));
+  return _mm256_blendv_pd (s,
+                           _mm256_set1_pd (-1.0),
+                           _mm256_cmp_pd (delta, _mm256_setzero_pd (), _CMP_EQ_OQ));
+}
+
+static inline __m128d saturationSse2 (__m128d r8,
+                                      __m128d g8,
+                                      __m128d b8)
+{
+  const __m128d SCALE_8_TO_16 = _mm_set1_pd (RGB_8_TO_16_BITS);
+  const __m128d USHRT = _mm_set1_pd (USHRT_MAX_DOUBLE);
+  __m128d r = _mm_div_pd (_mm_mul_pd (r8, SCALE_8_TO_16), USHRT);
+  __m128d g = _mm_div_pd (_mm_mul_pd (g8, SCALE_8_TO_16), USHRT);
+  __m128d b = _mm_div_pd (_mm_mul_pd (b8, SCALE_8_TO_16), USHRT);
+  __m128d max = _mm_max_pd (_mm_max_pd (r, g), b);
+  __m128d min = _mm_min_pd (_mm_min_pd (r, g), b);
+  __m128d delta = _mm_sub_pd (max, min);
+
+  __m128d saturation = roundSse2 (_mm_mul_pd (_mm_div_pd (delta, max), USHRT));
+  saturation = _mm_andnot_pd (_mm_cmpeq_pd (delta, _mm_setzero_pd ()),
+                              saturation); // Achromatic pixels, including black which divides by zero, are zero
+
+  return _mm_div_pd (saturation, USHRT);
+}
+
+AVX2_FUNCTION static inline __m256d saturationAvx2 (__m256d r8,
+                                                    __m256d g8,
+                                                    __m256d b8)
+{
+  const __m256d SCALE_8_TO_16 = _mm256_set1_pd (RGB_8_TO_16_BITS);
+  const __m256d USHRT = _mm256_set1_pd (USHRT_MAX_DOUBLE);
+  __m256d r = _mm256_div_pd (_mm256_mul_pd (r8, SCALE_8_TO_16), USHRT);
+  __m256d g = _mm256_div_pd (_mm256_mul_pd (g8, SCALE_8_TO_16), USHRT);
+  __m256d b = _mm256_div_pd (_mm256_mul_pd (b8, SCALE_8_TO_16), USHRT);
+  __m256d max = _mm256_max_pd (_mm256_max_pd (r, g), b);
+  __m256d min = _mm256_min_pd (_mm256_min_pd (r, g), b);
+  __m256d delta = _mm256_sub_pd (max, min);
+
+  __m256d saturation = roundAvx2 (_mm256_mul_pd (_mm256_div_pd (delta, max), USHRT));
+  saturation = _mm256_andnot_pd (_mm256_cmp_pd (delta, _mm256_setzero_pd (), _CMP_EQ_OQ),
+                                 saturation);
+
+  return _mm256_div_pd (saturation, USHRT);
+}
+
+static inline __m128d valueSse2 (__m128d r8,
+                                 __m128d g8,
+                                 __m128d b8)
+{
+  const __m128d USHRT = _mm_set1_pd (USHRT_MAX_DOUBLE);
+  __m128d max = _mm_max_pd (_mm_max_pd (r8, g8), b8);
+  __m128d max16 = _mm_div_pd (_mm_mul_pd (max, _mm_set1_pd (RGB_8_TO_16_BITS)), USHRT);
+
+  return _mm_div_pd (roundSse2 (_mm_mul_pd (max16, USHRT)), USHRT);
+}
+
+AVX2_FUNCTION static inline __m256d valueAvx2 (__m256d r8,
+                                               __m256d g8,
+                                               __m256d b8)
+{
+  const __m256d USHRT = _mm256_set1_pd (USHRT_MAX_DOUBLE);
+  __m256d max = _mm256_max_pd (_mm256_max_pd (r8, g8), b8);
+  __m256d max16 = _mm256_div_pd (_mm256_mul_pd (max, _mm256_set1_pd (RGB_8_TO_16_BITS)), USHRT);
+
+  return _mm256_div_pd (roundAvx2 (_mm256_mul_pd (max16, USHRT)), USHRT);
+}
+
+// Loops over complete vectors. Each returns the number of pixels processed
+
+static double distanceMaxScalar ()
+{
+  return qSqrt (255.0 * 255.0 + 255.0 * 255.0 + 255.0 * 255.0);
+}
+
+static int distanceLoopSse2 (const QRgb *pixels,
+                             int count,
+                             QRgb rgbOrigin,
+                             double s [])
+{
+  const __m128d R_ORIGIN = _mm_set1_pd (qRed (rgbOrigin));
+  const __m128d G_ORIGIN = _mm_set1_pd (qGreen (rgbOrigin));
+  const __m128d B_ORIGIN = _mm_set1_pd (qBlue (rgbOrigin));
+  const __m128d DISTANCE_MAX = _mm_set1_pd (distanceMaxScalar ());
+
+  int i = 0;
+  for (; i + PIXELS_PER_SSE2 <= count; i += PIXELS_PER_SSE2) {
+    __m128d r, g, b;
+    loadSse2 (pixels + i, r, g, b);
+    _mm_storeu_pd (s + i, distanceSse2 (r, g, b, R_ORIGIN, G_ORIGIN, B_ORIGIN, DISTANCE_MAX));
+  }
+
+  return i;
+}
+
+AVX2_FUNCTION static int distanceLoopAvx2 (const QRgb *pixels,
+                                           int count,
+                                           QRgb rgbOrigin,
+                                           double s [])
+{
+  const __m256d R_ORIGIN = _mm256_set1_pd (qRed (rgbOrigin));
+  const __m256d G_ORIGIN = _mm256_set1_pd (qGreen (rgbOrigin));
+  const __m256d B_ORIGIN = _mm256_set1_pd (qBlue (rgbOrigin));
+  const __m256d DISTANCE_MAX = _mm256_set1_pd (distanceMaxScalar ());
+
+  int i = 0;
+  for (; i + PIXELS_PER_AVX2 <= count; i += PIXELS_PER_AVX2) {
+    __m256d r [2], g [2], b [2];
+    loadAvx2 (pixels + i, r, g, b);
+    _mm256_storeu_pd (s + i    , distanceAvx2 (r [0], g [0], b [0], R_ORIGIN, G_ORIGIN, B_ORIGIN, DISTANCE_MAX));
+    _mm256_storeu_pd (s + i + 4, distanceAvx2 (r [1], g [1], b [1], R_ORIGIN, G_ORIGIN, B_ORIGIN, DISTANCE_MAX));
+  }
+
+  _mm256_zeroupper ();
+
+  return i;
+}
+
+// Hue, saturation and value loops only differ in the per vector computation
+#define COLOR_FILTER_SIMD_LOOPS(NAME) \
+static int NAME##LoopSse2 (const QRgb *pixels, \
+                           int count, \
+                           double s []) \
+{ \
+  int i = 0; \
+  for (; i + PIXELS_PER_SSE2 <= count; i += PIXELS_PER_SSE2) { \
+    __m128d r, g, b; \
+    loadSse2 (pixels + i, r, g, b); \
+    _mm_storeu_pd (s + i, NAME##Sse2 (r, g, b)); \
+  } \
+  return i; \
+} \
+AVX2_FUNCTION static int NAME##LoopAvx2 (const QRgb *pixels, \
+                                         int count, \
+                                         double s []) \
+{ \
+  int i = 0; \
+  for (; i + PIXELS_PER_AVX2 <= count; i += PIXELS_PER_AVX2) { \
+    __m256d r [2], g [2], b [2]; \
+    loadAvx2 (pixels + i, r, g, b); \
+    _mm256_storeu_pd (s + i    , NAME##Avx2 (r [0], g [0], b [0])); \
+    _mm256_storeu_pd (s + i + 4, NAME##Avx2 (r [1], g [1], b [1])); \
+  } \
+  _mm256_zeroupper (); \
+  return i; \
+}
+
+COLOR_FILTER_SIMD_LOOPS(hue)
+COLOR_FILTER_SIMD_LOOPS(saturation)
+COLOR_FILTER_SIMD_LOOPS(value)
+
+static ColorFilterSimd::InstructionSet detectInstructionSet ()
+{
+#if defined(_MSC_VER)
+  // AVX2 needs cpu support (cpuid leaf 7) plus operating system support for saving the ymm registers (xgetbv)
+  int info [4];
+  __cpuid (info, 0);
+  int idMax = info [0];
+  if (idMax >= 7) {
+    __cpuid (info, 1);
+    bool osxsave = (info [2] & (1 << 27)) != 0;
+    bool avx = (info [2] & (1 << 28)) != 0;
+    if (osxsave && avx && ((_xgetbv (0) & 0x6) == 0x6)) {
+      __cpuidex (info, 7, 0);
+      if ((info [1] & (1 << 5)) != 0) {
+        return ColorFilterSimd::INSTRUCTION_SET_AVX2;
+      }
+    }
+  }
+  return ColorFilterSimd::INSTRUCTION_SET_SSE2;
+#else
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    return ColorFilterSimd::INSTRUCTION_SET_AVX2;
+  }
+  return ColorFilterSimd::INSTRUCTION_SET_SSE2;
+#endif
+}
+
+#endif // COLOR_FILTER_SIMD_X86
+
+ColorFilterSimd::ColorFilterSimd() :
+  m_instructionSet (instructionSetSupported ())
+{
+}
+
+ColorFilterSimd::ColorFilterSimd(InstructionSet instructionSet) :
+  m_instructionSet (instructionSet)
+{
+}
+
+int ColorFilterSimd::distance (const QRgb *pixels,
+                               int count,
+                               QRgb rgbOrigin,
+                               double s []) const
+{
+#ifdef COLOR_FILTER_SIMD_X86
+  switch (m_instructionSet) {
+    case INSTRUCTION_SET_AVX2:
+      return distanceLoopAvx2 (pixels, count, rgbOrigin, s);
+
+    case INSTRUCTION_SET_SSE2:
+      return distanceLoopSse2 (pixels, count, rgbOrigin, s);
+
+    default:
+      break;
+  }
+#endif
+
+  return 0;
+}
+
+int ColorFilterSimd::hue (const QRgb *pixels,
+                          int count,
+                          double s []) const
+{
+#ifdef COLOR_FILTER_SIMD_X86
+  switch (m_instructionSet) {
+    case INSTRUCTION_SET_AVX2:
+      return hueLoopAvx2 (pixels, count, s);
+
+    case INSTRUCTION_SET_SSE2:
+      return hueLoopSse2 (pixels, count, s);
+
+    default:
+      break;
+  }
+#endif
+
+  return 0;
+}
+
+ColorFilterSimd::InstructionSet ColorFilterSimd::instructionSet () const
+{
+  return m_instructionSet;
+}
+
+ColorFilterSimd::InstructionSet ColorFilterSimd::instructionSetSupported ()
+{
+#ifdef COLOR_FILTER_SIMD_X86
+  static InstructionSet instructionSet = detectInstructionSet ();
+  return instructionSet;
+#else
+  return INSTRUCTION_SET_NONE;
+#endif
+}
+
+int ColorFilterSimd::saturation (const QRgb *pixels,
+                                 int count,
+                                 double s []) const
+{
+#ifdef COLOR_FILTER_SIMD_X86
+  switch (m_instructionSet) {
+    case INSTRUCTION_SET_AVX2:
+      return saturationLoopAvx2 (pixels, count, s);
+
+    case INSTRUCTION_SET_SSE2:
+      return saturationLoopSse2 (pixels, count, s);
+
+    default:
+      break;
+  }
+#endif
+
+  return 0;
+}
+
+int ColorFilterSimd::value (const QRgb *pixels,
+                            int count,
+                            double s []) const
+{
+#ifdef COLOR_FILTER_SIMD_X86
+  switch (m_instructionSet) {
+    case INSTRUCTION_SET_AVX2:
+      return valueLoopAvx2 (pixels, count, s);
+
+    case INSTRUCTION_SET_SSE2:
+      return valueLoopSse2 (pixels, count, s);
+
+    default:
+      break;
+  }
+#endif
+
+  return 0;
+}
@@ -0,0 +1,67 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef COLOR_FILTER_SIMD_H
+#define COLOR_FILTER_SIMD_H
+
+#include <QRgb>
+
+/// Vectorized versions of the ColorFilterStrategyAbstractBase::pixelRgbToZeroToOne computations, using SSE2 (two pixels
+/// per instruction) or AVX2 (four pixels per instruction) according to what the cpu supports at runtime. Double precision
+/// is used throughout, with the same sequence of operations as the scalar strategies, so results are bit for bit identical.
+///
+/// Each method processes the leading pixels that fill complete vectors and returns how many were processed. The remaining
+/// pixels, and all pixels when no instruction set is available, must be processed by the scalar strategy code
+class ColorFilterSimd
+{
+public:
+  /// Instruction sets in increasing order of capability
+  enum InstructionSet {
+    INSTRUCTION_SET_NONE,
+    INSTRUCTION_SET_SSE2,
+    INSTRUCTION_SET_AVX2
+  };
+
+  /// Default constructor uses the most capable instruction set supported by the cpu
+  ColorFilterSimd();
+
+  /// Constructor for a specific instruction set, which must be supported by the cpu. Used for testing
+  ColorFilterSimd(InstructionSet instructionSet);
+
+  /// Normalized distance from rgbOrigin to each pixel, as in the foreground (origin is background color) and
+  /// intensity (origin is black) strategies
+  int distance (const QRgb *pixels,
+                int count,
+                QRgb rgbOrigin,
+                double s []) const;
+
+  /// Normalized hue of each pixel, or -1 for achromatic pixels, as in the hue strategy
+  int hue (const QRgb *pixels,
+           int count,
+           double s []) const;
+
+  /// Instruction set used by this object
+  InstructionSet instructionSet () const;
+
+  /// Most capable instruction set supported by the cpu. This is detected once and then remembered
+  static InstructionSet instructionSetSupported ();
+
+  /// Normalized saturation of each pixel, as in the saturation strategy
+  int saturation (const QRgb *pixels,
+                  int count,
+                  double s []) const;
+
+  /// Normalized value of each pixel, as in the value strategy
+  int value (const QRgb *pixels,
+             int count,
+             double s []) const;
+
+private:
+
+  InstructionSet m_instructionSet;
+};
+
+#endif // COLOR_FILTER_SIMD_H
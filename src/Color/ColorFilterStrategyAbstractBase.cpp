@@ -5,6 +5,7 @@
  ******************************************************************************************************/
 
 #include "ColorFilterStrategyAbstractBase.h"
+#include <QColor>
 
 ColorFilterStrategyAbstractBase::ColorFilterStrategyAbstractBase ()
 {
@@ -13,3 +14,21 @@ ColorFilterStrategyAbstractBase::ColorFilterStrategyAbstractBase ()
 ColorFilterStrategyAbstractBase::~ColorFilterStrategyAbstractBase ()
 {
 }
+
+double ColorFilterStrategyAbstractBase::pixelToZeroToOne (const QColor &pixel,
+                                                          QRgb rgbBackground) const
+{
+  return pixelRgbToZeroToOne (pixel.rgb (),
+                              rgbBackground);
+}
+
+void ColorFilterStrategyAbstractBase::pixelsRgbToZeroToOne (const QRgb pixels [],
+                                                            int count,
+                                                            QRgb rgbBackground,
+                                                            double s []) const
+{
+  for (int i = 0; i < count; i++) {
+    s [i] = pixelRgbToZeroToOne (pixels [i],
+                                 rgbBackground);
+  }
+}
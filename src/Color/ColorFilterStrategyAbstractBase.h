@@ -24,9 +24,21 @@ class ColorFilterStrategyAbstractBase
 
   virtual ~ColorFilterStrategyAbstractBase();
 
-  /// Return a normalized value of 0 to 1 given input pixel
-  virtual double pixelToZeroToOne  (const QColor &pixel,
-                                    QRgb rgbBackground) const = 0;
+  /// Return a normalized value of 0 to 1 given input pixel. This is a convenience wrapper around pixelRgbToZeroToOne
+  double pixelToZeroToOne  (const QColor &pixel,
+                            QRgb rgbBackground) const;
+
+  /// Return a normalized value of 0 to 1 given input pixel as a raw QRgb value. This is the fast path used when
+  /// processing entire images, since no QColor has to be constructed per pixel
+  virtual double pixelRgbToZeroToOne (QRgb pixel,
+                                      QRgb rgbBackground) const = 0;
+
+  /// Apply pixelRgbToZeroToOne to an array of pixels. Subclasses override this with vectorized code, which must give
+  /// exactly the same results
+  virtual void pixelsRgbToZeroToOne (const QRgb pixels [],
+                                     int count,
+                                     QRgb rgbBackground,
+                                     double s []) const;
 
   /// Return the low value normalized to 0 to 1
   virtual int zeroToOneToValue (double s) const = 0;
@@ -5,6 +5,7 @@
  ******************************************************************************************************/
 
 #include "ColorConstants.h"
+#include "ColorFilterSimd.h"
 #include "ColorFilterStrategyForeground.h"
 #include <QColor>
 #include <qmath.h>
@@ -17,15 +18,31 @@ ColorFilterStrategyForeground::~ColorFilterStrategyForeground ()
 {
 }
 
-double ColorFilterStrategyForeground::pixelToZeroToOne (const QColor &pixel,
-                                                        QRgb rgbBackground) const
+double ColorFilterStrategyForeground::pixelRgbToZeroToOne (QRgb pixel,
+                                                           QRgb rgbBackground) const
 {
-  double distance = qSqrt (pow ((double) pixel.red()   - qRed   (rgbBackground), 2) +
-                           pow ((double) pixel.green() - qGreen (rgbBackground), 2) +
-                           pow ((double) pixel.blue()  - qBlue  (rgbBackground), 2));
+  double distance = qSqrt (pow ((double) qRed   (pixel) - qRed   (rgbBackground), 2) +
+                           pow ((double) qGreen (pixel) - qGreen (rgbBackground), 2) +
+                           pow ((double) qBlue  (pixel) - qBlue  (rgbBackground), 2));
   return distance / qSqrt (255.0 * 255.0 + 255.0 * 255.0 + 255.0 * 255.0);
 }
 
+void ColorFilterStrategyForeground::pixelsRgbToZeroToOne (const QRgb pixels [],
+                                                          int count,
+                                                          QRgb rgbBackground,
+                                                          double s []) const
+{
+  // Foreground is the distance from the background color
+  ColorFilterSimd simd;
+  int processed = simd.distance (pixels, count, rgbBackground, s);
+
+  // Leftover pixels that do not fill a complete vector
+  for (int i = processed; i < count; i++) {
+    s [i] = pixelRgbToZeroToOne (pixels [i],
+                                 rgbBackground);
+  }
+}
+
 int ColorFilterStrategyForeground::zeroToOneToValue (double s) const
 {
   return FOREGROUND_MIN + s * (FOREGROUND_MAX - FOREGROUND_MIN);
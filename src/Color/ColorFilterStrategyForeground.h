@@ -18,8 +18,12 @@ class ColorFilterStrategyForeground : public ColorFilterStrategyAbstractBase
 
   virtual ~ColorFilterStrategyForeground();
 
-  virtual double pixelToZeroToOne  (const QColor &pixel,
-                                    QRgb rgbBackground) const;
+  virtual double pixelRgbToZeroToOne (QRgb pixel,
+                                      QRgb rgbBackground) const;
+  virtual void pixelsRgbToZeroToOne (const QRgb pixels [],
+                                     int count,
+                                     QRgb rgbBackground,
+                                     double s []) const;
   virtual int zeroToOneToValue (double s) const;
 
 };
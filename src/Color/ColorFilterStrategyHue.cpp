@@ -5,7 +5,9 @@
  ******************************************************************************************************/
 
 #include "ColorConstants.h"
+#include "ColorFilterSimd.h"
 #include "ColorFilterStrategyHue.h"
+#include <climits>
 #include <QColor>
 #include <qmath.h>
 
@@ -17,17 +19,58 @@ ColorFilterStrategyHue::~ColorFilterStrategyHue ()
 {
 }
 
-double ColorFilterStrategyHue::pixelToZeroToOne (const QColor &pixel,
-                                                 QRgb /* rgbBackground */) const
+double ColorFilterStrategyHue::pixelRgbToZeroToOne (QRgb pixel,
+                                                    QRgb /* rgbBackground */) const
 {
-  double s = pixel.hueF();
-  if (s < 0) {
+  // This mirrors QColor::toHsv followed by QColor::hueF, step for step, so the results are identical to those
+  // from QColor without constructing a QColor for every pixel. QColor stores each component as 16 bits
+  const double r = (qRed   (pixel) * 0x101) / (double) USHRT_MAX;
+  const double g = (qGreen (pixel) * 0x101) / (double) USHRT_MAX;
+  const double b = (qBlue  (pixel) * 0x101) / (double) USHRT_MAX;
+  const double max = qMax (qMax (r, g), b);
+  const double min = qMin (qMin (r, g), b);
+  const double delta = max - min;
+
+  double s = -1;
+  if (!qFuzzyIsNull (delta)) {
+
+    double hue = 0;
+    if (qFuzzyCompare (r, max)) {
+      hue = ((g - b) / delta);
+    } else if (qFuzzyCompare (g, max)) {
+      hue = (2.0 + (b - r) / delta);
+    } else {
+      hue = (4.0 + (r - g) / delta);
+    }
+    hue *= 60.0;
+    if (hue < 0.0) {
+      hue += 360.0;
+    }
+
+    s = qRound (hue * 100) / 36000.0;
+
+  } else {
     // Color is achromatic (r=g=b) so it has no hue
   }
-  
+
   return s;
 }
 
+void ColorFilterStrategyHue::pixelsRgbToZeroToOne (const QRgb pixels [],
+                                                   int count,
+                                                   QRgb rgbBackground,
+                                                   double s []) const
+{
+  ColorFilterSimd simd;
+  int processed = simd.hue (pixels, count, s);
+
+  // Leftover pixels that do not fill a complete vector
+  for (int i = processed; i < count; i++) {
+    s [i] = pixelRgbToZeroToOne (pixels [i],
+                                 rgbBackground);
+  }
+}
+
 int ColorFilterStrategyHue::zeroToOneToValue (double s) const
 {
   return HUE_MIN + s * (HUE_MAX - HUE_MIN);
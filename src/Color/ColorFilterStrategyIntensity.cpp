@@ -5,6 +5,7 @@
  ******************************************************************************************************/
 
 #include "ColorConstants.h"
+#include "ColorFilterSimd.h"
 #include "ColorFilterStrategyIntensity.h"
 #include <QColor>
 #include <qmath.h>
@@ -17,15 +18,31 @@ ColorFilterStrategyIntensity::~ColorFilterStrategyIntensity ()
 {
 }
 
-double ColorFilterStrategyIntensity::pixelToZeroToOne (const QColor &pixel,
-                                                       QRgb /* rgbBackground */) const
+double ColorFilterStrategyIntensity::pixelRgbToZeroToOne (QRgb pixel,
+                                                          QRgb /* rgbBackground */) const
 {
-  double distance = qSqrt (pow ((double) pixel.red(), 2) +
-                           pow ((double) pixel.green(), 2) +
-                           pow ((double) pixel.blue(), 2));
+  double distance = qSqrt (pow ((double) qRed (pixel), 2) +
+                           pow ((double) qGreen (pixel), 2) +
+                           pow ((double) qBlue (pixel), 2));
   return distance / qSqrt (255.0 * 255.0 + 255.0 * 255.0 + 255.0 * 255.0);
 }
 
+void ColorFilterStrategyIntensity::pixelsRgbToZeroToOne (const QRgb pixels [],
+                                                         int count,
+                                                         QRgb rgbBackground,
+                                                         double s []) const
+{
+  // Intensity is the distance from black
+  ColorFilterSimd simd;
+  int processed = simd.distance (pixels, count, qRgb (0, 0, 0), s);
+
+  // Leftover pixels that do not fill a complete vector
+  for (int i = processed; i < count; i++) {
+    s [i] = pixelRgbToZeroToOne (pixels [i],
+                                 rgbBackground);
+  }
+}
+
 int ColorFilterStrategyIntensity::zeroToOneToValue (double s) const
 {
   return INTENSITY_MIN + s * (INTENSITY_MAX - INTENSITY_MIN);
@@ -5,7 +5,9 @@
  ******************************************************************************************************/
 
 #include "ColorConstants.h"
+#include "ColorFilterSimd.h"
 #include "ColorFilterStrategySaturation.h"
+#include <climits>
 #include <QColor>
 #include <qmath.h>
 
@@ -17,10 +19,38 @@ ColorFilterStrategySaturation::~ColorFilterStrategySaturation ()
 {
 }
 
-double ColorFilterStrategySaturation::pixelToZeroToOne (const QColor &pixel,
-                                                        QRgb /* rgbBackground */) const
+double ColorFilterStrategySaturation::pixelRgbToZeroToOne (QRgb pixel,
+                                                           QRgb /* rgbBackground */) const
 {
-  return pixel.saturationF();
+  // This mirrors QColor::toHsv followed by QColor::saturationF, so the results are identical to those from QColor
+  const double r = (qRed   (pixel) * 0x101) / (double) USHRT_MAX;
+  const double g = (qGreen (pixel) * 0x101) / (double) USHRT_MAX;
+  const double b = (qBlue  (pixel) * 0x101) / (double) USHRT_MAX;
+  const double max = qMax (qMax (r, g), b);
+  const double min = qMin (qMin (r, g), b);
+  const double delta = max - min;
+
+  int saturation = 0; // Achromatic case
+  if (!qFuzzyIsNull (delta)) {
+    saturation = qRound ((delta / max) * USHRT_MAX);
+  }
+
+  return saturation / (double) USHRT_MAX;
+}
+
+void ColorFilterStrategySaturation::pixelsRgbToZeroToOne (const QRgb pixels [],
+                                                          int count,
+                                                          QRgb rgbBackground,
+                                                          double s []) const
+{
+  ColorFilterSimd simd;
+  int processed = simd.saturation (pixels, count, s);
+
+  // Leftover pixels that do not fill a complete vector
+  for (int i = processed; i < count; i++) {
+    s [i] = pixelRgbToZeroToOne (pixels [i],
+                                 rgbBackground);
+  }
 }
 
 int ColorFilterStrategySaturation::zeroToOneToValue (double s) const
@@ -5,7 +5,9 @@
  ******************************************************************************************************/
 
 #include "ColorConstants.h"
+#include "ColorFilterSimd.h"
 #include "ColorFilterStrategyValue.h"
+#include <climits>
 #include <QColor>
 #include <qmath.h>
 
@@ -17,10 +19,29 @@ ColorFilterStrategyValue::~ColorFilterStrategyValue ()
 {
 }
 
-double ColorFilterStrategyValue::pixelToZeroToOne (const QColor &pixel,
-                                                   QRgb /* rgbBackground */) const
+double ColorFilterStrategyValue::pixelRgbToZeroToOne (QRgb pixel,
+                                                      QRgb /* rgbBackground */) const
 {
-  return pixel.valueF();
+  // This mirrors QColor::toHsv followed by QColor::valueF, so the results are identical to those from QColor
+  const int max = qMax (qMax (qRed (pixel), qGreen (pixel)), qBlue (pixel));
+  const int value = qRound (((max * 0x101) / (double) USHRT_MAX) * USHRT_MAX);
+
+  return value / (double) USHRT_MAX;
+}
+
+void ColorFilterStrategyValue::pixelsRgbToZeroToOne (const QRgb pixels [],
+                                                     int count,
+                                                     QRgb rgbBackground,
+                                                     double s []) const
+{
+  ColorFilterSimd simd;
+  int processed = simd.value (pixels, count, s);
+
+  // Leftover pixels that do not fill a complete vector
+  for (int i = processed; i < count; i++) {
+    s [i] = pixelRgbToZeroToOne (pixels [i],
+                                 rgbBackground);
+  }
 }
 
 int ColorFilterStrategyValue::zeroToOneToValue (double s) const
@@ -0,0 +1,176 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#include "ColorFilter.h"
+#include "ColorFilterLookupTable.h"
+#include "ColorFilterStrategyAbstractBase.h"
+#include "ColorFilterStripe.h"
+#include <QBitArray>
+#include <QColor>
+#include <QThreadPool>
+
+const QRgb RGB_MASK = 0x00ffffff;
+const int NUM_RGB_COLORS = 256 * 256 * 256;
+
+// Stripes smaller than this are not worth the threading overhead
+const int MIN_ROWS_PER_STRIPE = 64;
+
+ColorFilterStripe::ColorFilterStripe(const ColorFilterStrategyAbstractBase *strategy,
+                                     const ColorFilterLookupTable *table,
+                                     const uchar *bitsOriginal,
+                                     int bytesPerLineOriginal,
+                                     uchar *bitsFiltered,
+                                     int bytesPerLineFiltered,
+                                     int width,
+                                     int yStart,
+                                     int yStop,
+                                     QRgb rgbBackground,
+                                     double low,
+                                     double high) :
+  m_strategy (strategy),
+  m_table (table),
+  m_bitsOriginal (bitsOriginal),
+  m_bytesPerLineOriginal (bytesPerLineOriginal),
+  m_bitsFiltered (bitsFiltered),
+  m_bytesPerLineFiltered (bytesPerLineFiltered),
+  m_width (width),
+  m_yStart (yStart),
+  m_yStop (yStop),
+  m_rgbBackground (rgbBackground),
+  m_low (low),
+  m_high (high)
+{
+}
+
+void ColorFilterStripe::computeUnknownColors ()
+{
+  m_unknownPixels.clear ();
+
+  // Since the shared lookup table cannot be modified here, colors that were already queued are tracked separately
+  QBitArray queued;
+
+  for (int y = m_yStart; y < m_yStop; y++) {
+
+    const QRgb *line = (const QRgb *) (m_bitsOriginal + y * m_bytesPerLineOriginal);
+
+    for (int x = 0; x < m_width; x++) {
+
+      QRgb pixel = line [x] | ALPHA_OPAQUE ();
+      if ((pixel != m_rgbBackground) &&
+          (m_table->code (pixel) == ColorFilterLookupTable::UNKNOWN ())) {
+
+        if (queued.isEmpty ()) {
+          queued.resize (NUM_RGB_COLORS); // Allocated only if needed, since most stripes have no unknown colors after the first image
+        }
+
+        if (!queued.testBit (pixel & RGB_MASK)) {
+          queued.setBit (pixel & RGB_MASK);
+          m_unknownPixels.append (pixel);
+        }
+      }
+    }
+  }
+
+  // Unknown colors are run through the (vectorized) strategy together
+  QVector<double> values (m_unknownPixels.count ());
+  m_strategy->pixelsRgbToZeroToOne (m_unknownPixels.constData (),
+                                    m_unknownPixels.count (),
+                                    m_rgbBackground,
+                                    values.data ());
+
+  m_unknownCodes.resize (m_unknownPixels.count ());
+  for (int i = 0; i < m_unknownPixels.count (); i++) {
+    m_unknownCodes [i] = ColorFilterLookupTable::codeFromZeroToOne (values [i]);
+  }
+}
+
+QImage ColorFilterStripe::imageWith32BitPixels (const QImage &image)
+{
+  if ((image.format () != QImage::Format_RGB32) &&
+      (image.format () != QImage::Format_ARGB32) &&
+      (image.format () != QImage::Format_ARGB32_Premultiplied)) {
+    return image.convertToFormat (QImage::Format_ARGB32);
+  }
+
+  return image;
+}
+
+void ColorFilterStripe::saveUnknownColors (ColorFilterLookupTable &table) const
+{
+  for (int i = 0; i < m_unknownPixels.count (); i++) {
+    table.setCode (m_unknownPixels [i],
+                   m_unknownCodes [i]);
+  }
+}
+
+QList<QPair<int, int> > ColorFilterStripe::stripeRows (int yStart,
+                                                       int yStop)
+{
+  // Stripes follow the row major memory layout of QImage
+  int height = yStop - yStart;
+  int stripeCount = qMax (1, qMin (QThreadPool::globalInstance ()->maxThreadCount (),
+                                   height / MIN_ROWS_PER_STRIPE));
+
+  QList<QPair<int, int> > rows;
+  for (int stripe = 0; stripe < stripeCount; stripe++) {
+    rows << QPair<int, int> (yStart + (height * stripe) / stripeCount,
+                             yStart + (height * (stripe + 1)) / stripeCount);
+  }
+
+  return rows;
+}
+
+void ColorFilterStripe::writeFiltered ()
+{
+  const QRgb rgbBlack = QColor (Qt::black).rgb ();
+  const QRgb rgbWhite = QColor (Qt::white).rgb ();
+
+  QVector<uchar> results = ColorFilterLookupTable::thresholdResults (m_low,
+                                                                     m_high);
+  QVector<int> exactColumns;
+  QVector<QRgb> exactPixels;
+  QVector<double> exactValues;
+
+  for (int y = m_yStart; y < m_yStop; y++) {
+
+    const QRgb *lineOriginal = (const QRgb *) (m_bitsOriginal + y * m_bytesPerLineOriginal);
+    QRgb *lineFiltered = (QRgb *) (m_bitsFiltered + y * m_bytesPerLineFiltered);
+
+    exactPixels.clear ();
+    exactColumns.clear ();
+    for (int x = 0; x < m_width; x++) {
+
+      QRgb pixel = lineOriginal [x] | ALPHA_OPAQUE ();
+      uchar result = ((pixel == m_rgbBackground) ?
+                      (uchar) COLOR_FILTER_THRESHOLD_OFF :
+                      results [m_table->code (pixel)]);
+
+      lineFiltered [x] = ((result == COLOR_FILTER_THRESHOLD_ON) ? rgbBlack : rgbWhite);
+      if (result == COLOR_FILTER_THRESHOLD_EXACT) {
+        exactPixels.append (pixel);
+        exactColumns.append (x);
+      }
+    }
+
+    if (exactPixels.count () > 0) {
+
+      // Pixels sharing a level with a threshold are converted again at full precision
+      exactValues.resize (exactPixels.count ());
+      m_strategy->pixelsRgbToZeroToOne (exactPixels.constData (),
+                                        exactPixels.count (),
+                                        m_rgbBackground,
+                                        exactValues.data ());
+
+      for (int i = 0; i < exactPixels.count (); i++) {
+        if (ColorFilter::zeroToOneIsOn (exactValues [i],
+                                        m_low,
+                                        m_high)) {
+          lineFiltered [exactColumns [i]] = rgbBlack;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,88 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef COLOR_FILTER_STRIPE_H
+#define COLOR_FILTER_STRIPE_H
+
+#include <QImage>
+#include <QList>
+#include <QPair>
+#include <QRgb>
+#include <QVector>
+
+class ColorFilterLookupTable;
+class ColorFilterStrategyAbstractBase;
+
+/// Horizontal stripe of an image being filtered by ColorFilter::filterImage. Stripes are processed in parallel in three
+/// steps, with the lookup table only being modified in the middle step (by one thread) so the output is deterministic:
+/// -# computeUnknownColors runs the colors that are missing from the lookup table through the strategy
+/// -# saveUnknownColors (serially) merges those results into the lookup table
+/// -# writeFiltered converts the stripe's pixels using the lookup table, converting again only the pixels whose level is
+/// shared with a threshold
+class ColorFilterStripe
+{
+public:
+  /// Single constructor. Pixel data must be 32 bits per pixel, and must not be detached while the stripe is in use
+  ColorFilterStripe(const ColorFilterStrategyAbstractBase *strategy,
+                    const ColorFilterLookupTable *table,
+                    const uchar *bitsOriginal,
+                    int bytesPerLineOriginal,
+                    uchar *bitsFiltered,
+                    int bytesPerLineFiltered,
+                    int width,
+                    int yStart,
+                    int yStop,
+                    QRgb rgbBackground,
+                    double low,
+                    double high);
+
+  /// Alpha bits that are ORed into every pixel before it is used, since QColor, which was used originally, ignores the
+  /// alpha channel
+  static QRgb ALPHA_OPAQUE () { return 0xff000000; }
+
+  /// Find colors in this stripe that are missing from the lookup table, and compute their codes. The lookup table is
+  /// only read, so this can run in parallel with other stripes
+  void computeUnknownColors ();
+
+  /// Image with 32 bits per pixel, so scan lines can be read directly. Other formats (indexed, 16 bit) are converted
+  /// once, which gives the same values as QImage::pixel. 32 bit images, including premultiplied ones whose pixels
+  /// QImage::pixel returns unchanged, are returned without a copy
+  static QImage imageWith32BitPixels (const QImage &image);
+
+  /// Save the codes computed by computeUnknownColors into the lookup table. Must be called for one stripe at a time
+  void saveUnknownColors (ColorFilterLookupTable &table) const;
+
+  /// Split rows yStart through yStop-1 into horizontal stripes for processing in parallel on the global thread pool.
+  /// Each entry holds the first row of a stripe and one past its last row. There is always at least one stripe
+  static QList<QPair<int, int> > stripeRows (int yStart,
+                                             int yStop);
+
+  /// Write the filtered stripe, which requires that every color in the stripe be in the lookup table. The lookup table
+  /// is only read, and only for colors that are already saved, so this needs no lock
+  void writeFiltered ();
+
+private:
+  ColorFilterStripe();
+
+  const ColorFilterStrategyAbstractBase *m_strategy;
+  const ColorFilterLookupTable *m_table;
+  const uchar *m_bitsOriginal;
+  int m_bytesPerLineOriginal;
+  uchar *m_bitsFiltered;
+  int m_bytesPerLineFiltered;
+  int m_width;
+  int m_yStart;
+  int m_yStop; // One past last row
+  QRgb m_rgbBackground;
+  double m_low;
+  double m_high;
+
+  // Output of computeUnknownColors
+  QVector<QRgb> m_unknownPixels;
+  QVector<int> m_unknownCodes;
+};
+
+#endif // COLOR_FILTER_STRIPE_H
@@ -10,7 +10,8 @@
 #include "fftw3.h"
 
 /// Fast cross correlation between two functions. We do not use complex.h along with fftw3.h since then the
-/// complex numbers will be native, which would then require platform-dependent code
+/// complex numbers will be native, which would then require platform-dependent code. The functions are real, so real
+/// to complex transforms are used, which take half the work and memory of complex transforms
 class Correlation
 {
 public:
@@ -27,6 +28,14 @@ public:
                            double &corrMax,
                            double correlations []) const;
 
+  /// Same as correlateWithShift, with function1 replaced by the function from the last call to loadSpectrum. Only
+  /// function2 is normalized and transformed, so this is faster when one function is correlated with many others
+  void correlateWithSpectrum (int N,
+                              const double function2 [],
+                              int &binStartMax,
+                              double &corrMax,
+                              double correlations []) const;
+
   /// Return the correlation of the two functions, without any shift. The functions
   /// are normalized internally.
   void correlateWithoutShift (int N,
@@ -34,21 +43,46 @@ public:
                               const double function2 [],
                               double &corrMax) const;
 
+  /// Normalize and transform function1 of correlateWithShift, and save its spectrum for correlateWithSpectrum
+  void loadSpectrum (int N,
+                     const double function1 []);
+
 private:
   Correlation();
 
+  // Correlate the two spectra, and search the result for the best shift
+  void correlateSpectra (int N,
+                         const fftw_complex *spectrum1,
+                         const fftw_complex *spectrum2,
+                         int &binStartMax,
+                         double &corrMax,
+                         double correlations []) const;
+
+  // Normalize the function into the padded signal array and transform it into the spectrum array. The function goes
+  // at the end of the signal for function1, and at the start for function2
+  void transformFunction (int N,
+                          const double function [],
+                          bool isFunction1,
+                          double *signal,
+                          fftw_complex *spectrum) const;
+
   int m_N;
 
-  fftw_complex *m_signalA;
-  fftw_complex *m_signalB;
-  fftw_complex *m_outShifted;
+  // Padded functions have length 2N-1, and their spectra have length (2N-1)/2+1=N
+  double *m_signalA;
+  double *m_signalB;
+  double *m_outShifted;
   fftw_complex *m_outA;
   fftw_complex *m_outB;
   fftw_complex *m_out;
 
-  fftw_plan m_planA;
-  fftw_plan m_planB;
-  fftw_plan m_planX;
+  // Spectrum from loadSpectrum, which is kept separate from m_outA so correlateWithShift does not overwrite it
+  fftw_complex *m_spectrum;
+  bool m_spectrumIsLoaded;
+
+  // Shared plans from FftPlanCache, which are not owned by this object
+  fftw_plan m_planForward;
+  fftw_plan m_planBackward;
 };
 
 #endif // CORRELATION_H
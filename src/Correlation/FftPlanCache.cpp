@@ -0,0 +1,398 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#include "EngaugeAssert.h"
+#include "FftPlanCache.h"
+#include "Logger.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSettings>
+#include <QThread>
+#include "Settings.h"
+
+const QString WISDOM_FILENAME ("fftw.wisdom");
+const QString WISDOM_FILENAME_FLOAT ("fftwf.wisdom"); // Single precision wisdom is kept separately by fftw
+
+enum FftPlanType {
+  FFT_PLAN_DFT_C2R_1D,
+  FFT_PLAN_DFT_C2R_2D,
+  FFT_PLAN_DFT_R2C_1D,
+  FFT_PLAN_DFT_R2C_2D
+};
+
+typedef QPair<int, QPair<int, int> > FftPlanKey; // FftPlanType, then the dimensions
+
+// Transforms with at least this many elements are not measured unless there is wisdom for them, since measuring needs
+// full size scratch arrays and can take many seconds. They are planned with FFTW_ESTIMATE instead
+const int MEASURE_SIZE_MAX = 1024 * 1024;
+
+// Measuring any one plan stops after this long, and the best plan found so far is used
+const double MEASURE_SECONDS_MAX = 2.0;
+
+// Size of the placeholder arrays used when planning does not touch the arrays, in elements. Those arrays only supply
+// the alignment, which is the same for every fftw_malloc array
+const int PLACEHOLDER_SIZE = 2;
+
+// Plans are never destroyed, except for a duplicate made by a second thread planning the same key, since they are
+// shared by every fft user until the application exits. The cache mutex is only held while looking in the maps, so a
+// slow plan for one size does not hold up users of other sizes. The fftw planner is not thread safe, so the planner
+// mutex serializes all planning and wisdom operations
+static QMap<FftPlanKey, fftw_plan> planCache;
+static QMutex planCacheMutex;
+static QMutex plannerMutex;
+static QString wisdomFilename; // Empty until loadWisdom is called
+
+#ifdef ENGAUGE_FFTWF
+static QMap<FftPlanKey, fftwf_plan> planCacheFloat;
+static QString wisdomFilenameFloat; // Empty until loadWisdom is called
+static bool threadsAreInitializedFloat = false;
+#endif
+
+// Number of elements in the real array of a transform
+static int elementCount (const FftPlanKey &key)
+{
+  return key.second.first * key.second.second;
+}
+
+// Plan the transform for the key on the specified arrays, with the specified fftw flags. The caller must have locked
+// plannerMutex
+static fftw_plan planWithFlags (const FftPlanKey &key,
+                                double *real,
+                                fftw_complex *spectrum,
+                                unsigned flags)
+{
+  int dim0 = key.second.first;
+  int dim1 = key.second.second;
+
+  switch (key.first) {
+  case FFT_PLAN_DFT_C2R_1D:
+    return fftw_plan_dft_c2r_1d (dim0,
+                                 spectrum,
+                                 real,
+                                 flags);
+
+  case FFT_PLAN_DFT_C2R_2D:
+    return fftw_plan_dft_c2r_2d (dim0,
+                                 dim1,
+                                 spectrum,
+                                 real,
+                                 flags);
+
+  case FFT_PLAN_DFT_R2C_1D:
+    return fftw_plan_dft_r2c_1d (dim0,
+                                 real,
+                                 spectrum,
+                                 flags);
+
+  default:
+    return fftw_plan_dft_r2c_2d (dim0,
+                                 dim1,
+                                 real,
+                                 spectrum,
+                                 flags);
+  }
+}
+
+// Create the plan for the key. Saved wisdom is used if there is any. Otherwise small transforms are measured, for at
+// most MEASURE_SECONDS_MAX, and large transforms are estimated. The caller must not have locked planCacheMutex
+static fftw_plan createPlan (const FftPlanKey &key)
+{
+  QMutexLocker locker (&plannerMutex);
+
+  LOG4CPP_INFO_S ((*mainCat)) << "FftPlanCache::createPlan"
+                              << " type=" << key.first
+                              << " dimensions=" << key.second.first << "x" << key.second.second;
+
+  // Planning with FFTW_WISDOM_ONLY or FFTW_ESTIMATE leaves the arrays untouched, so placeholders are enough
+  double *realPlaceholder = (double *) fftw_malloc (sizeof (double) * PLACEHOLDER_SIZE);
+  fftw_complex *spectrumPlaceholder = (fftw_complex *) fftw_malloc (sizeof (fftw_complex) * PLACEHOLDER_SIZE);
+
+  fftw_plan plan = planWithFlags (key,
+                                  realPlaceholder,
+                                  spectrumPlaceholder,
+                                  FFTW_MEASURE | FFTW_WISDOM_ONLY);
+
+  if ((plan == 0) && (elementCount (key) >= MEASURE_SIZE_MAX)) {
+
+    plan = planWithFlags (key,
+                          realPlaceholder,
+                          spectrumPlaceholder,
+                          FFTW_ESTIMATE);
+
+  } else if (plan == 0) {
+
+    // Scratch arrays, since measuring overwrites them
+    int dim0 = key.second.first;
+    int dim1 = key.second.second;
+    double *real = (double *) fftw_malloc (sizeof (double) * dim0 * dim1);
+    fftw_complex *spectrum = (fftw_complex *) fftw_malloc (sizeof (fftw_complex) * dim0 * (dim1 / 2 + 1));
+
+    fftw_set_timelimit (MEASURE_SECONDS_MAX);
+    plan = planWithFlags (key,
+                          real,
+                          spectrum,
+                          FFTW_MEASURE);
+
+    fftw_free (real);
+    fftw_free (spectrum);
+
+    // Save the new measurements right away, since there is no reliable hook at exit
+    if (!wisdomFilename.isEmpty ()) {
+      if (!fftw_export_wisdom_to_filename (QFile::encodeName (wisdomFilename).constData ())) {
+        LOG4CPP_WARN_S ((*mainCat)) << "FftPlanCache::createPlan could not save wisdom to "
+                                    << wisdomFilename.toLatin1 ().data ();
+      }
+    }
+  }
+
+  fftw_free (realPlaceholder);
+  fftw_free (spectrumPlaceholder);
+
+  ENGAUGE_CHECK_PTR (plan);
+
+  return plan;
+}
+
+#ifdef ENGAUGE_FFTWF
+// Single precision version of planWithFlags, for the two dimensional types only. The caller must have locked
+// plannerMutex
+static fftwf_plan planWithFlagsFloat (const FftPlanKey &key,
+                                      float *real,
+                                      fftwf_complex *spectrum,
+                                      unsigned flags)
+{
+  int dim0 = key.second.first;
+  int dim1 = key.second.second;
+
+  if (key.first == FFT_PLAN_DFT_C2R_2D) {
+    return fftwf_plan_dft_c2r_2d (dim0,
+                                  dim1,
+                                  spectrum,
+                                  real,
+                                  flags);
+  } else {
+    return fftwf_plan_dft_r2c_2d (dim0,
+                                  dim1,
+                                  real,
+                                  spectrum,
+                                  flags);
+  }
+}
+
+// Initialize single precision thread support once. Fftw requires this before any other single precision call, so
+// it comes before the wisdom import in loadWisdom and before the first plan. Without it, the plans just run in the
+// calling thread. The caller must have locked plannerMutex
+static void initThreadsFloat ()
+{
+  if (!threadsAreInitializedFloat) {
+    threadsAreInitializedFloat = true;
+    if (fftwf_init_threads ()) {
+      fftwf_plan_with_nthreads (qMax (1, QThread::idealThreadCount ()));
+    } else {
+      LOG4CPP_WARN_S ((*mainCat)) << "FftPlanCache::initThreadsFloat could not initialize fftw threads";
+    }
+  }
+}
+
+// Single precision version of createPlan, for the two dimensional types only
+static fftwf_plan createPlanFloat (const FftPlanKey &key)
+{
+  QMutexLocker locker (&plannerMutex);
+
+  LOG4CPP_INFO_S ((*mainCat)) << "FftPlanCache::createPlanFloat"
+                              << " type=" << key.first
+                              << " dimensions=" << key.second.first << "x" << key.second.second;
+
+  initThreadsFloat ();
+
+  float *realPlaceholder = (float *) fftwf_malloc (sizeof (float) * PLACEHOLDER_SIZE);
+  fftwf_complex *spectrumPlaceholder = (fftwf_complex *) fftwf_malloc (sizeof (fftwf_complex) * PLACEHOLDER_SIZE);
+
+  fftwf_plan plan = planWithFlagsFloat (key,
+                                        realPlaceholder,
+                                        spectrumPlaceholder,
+                                        FFTW_MEASURE | FFTW_WISDOM_ONLY);
+
+  if ((plan == 0) && (elementCount (key) >= MEASURE_SIZE_MAX)) {
+
+    plan = planWithFlagsFloat (key,
+                               realPlaceholder,
+                               spectrumPlaceholder,
+                               FFTW_ESTIMATE);
+
+  } else if (plan == 0) {
+
+    int dim0 = key.second.first;
+    int dim1 = key.second.second;
+    float *real = (float *) fftwf_malloc (sizeof (float) * dim0 * dim1);
+    fftwf_complex *spectrum = (fftwf_complex *) fftwf_malloc (sizeof (fftwf_complex) * dim0 * (dim1 / 2 + 1));
+
+    fftwf_set_timelimit (MEASURE_SECONDS_MAX);
+    plan = planWithFlagsFloat (key,
+                               real,
+                               spectrum,
+                               FFTW_MEASURE);
+
+    fftwf_free (real);
+    fftwf_free (spectrum);
+
+    if (!wisdomFilenameFloat.isEmpty ()) {
+      if (!fftwf_export_wisdom_to_filename (QFile::encodeName (wisdomFilenameFloat).constData ())) {
+        LOG4CPP_WARN_S ((*mainCat)) << "FftPlanCache::createPlanFloat could not save wisdom to "
+                                    << wisdomFilenameFloat.toLatin1 ().data ();
+      }
+    }
+  }
+
+  fftwf_free (realPlaceholder);
+  fftwf_free (spectrumPlaceholder);
+
+  ENGAUGE_CHECK_PTR (plan);
+
+  return plan;
+}
+#endif
+
+// Return the cached plan for the key, creating it first if necessary
+static fftw_plan cachedPlan (const FftPlanKey &key)
+{
+  {
+    QMutexLocker locker (&planCacheMutex);
+    if (planCache.contains (key)) {
+      return planCache [key];
+    }
+  }
+
+  fftw_plan plan = createPlan (key);
+
+  QMutexLocker locker (&planCacheMutex);
+  if (planCache.contains (key)) {
+
+    // Another thread planned the same key meanwhile, and its plan may already be in use
+    QMutexLocker lockerPlanner (&plannerMutex);
+    fftw_destroy_plan (plan);
+
+  } else {
+
+    planCache [key] = plan;
+
+  }
+
+  return planCache [key];
+}
+
+#ifdef ENGAUGE_FFTWF
+// Single precision version of cachedPlan
+static fftwf_plan cachedPlanFloat (const FftPlanKey &key)
+{
+  {
+    QMutexLocker locker (&planCacheMutex);
+    if (planCacheFloat.contains (key)) {
+      return planCacheFloat [key];
+    }
+  }
+
+  fftwf_plan plan = createPlanFloat (key);
+
+  QMutexLocker locker (&planCacheMutex);
+  if (planCacheFloat.contains (key)) {
+
+    QMutexLocker lockerPlanner (&plannerMutex);
+    fftwf_destroy_plan (plan);
+
+  } else {
+
+    planCacheFloat [key] = plan;
+
+  }
+
+  return planCacheFloat [key];
+}
+#endif
+
+void FftPlanCache::loadWisdom ()
+{
+  // Wisdom goes in the same directory as the settings file. The ini format gives a real directory on every platform
+  QSettings settings (QSettings::IniFormat,
+                      QSettings::UserScope,
+                      SETTINGS_ENGAUGE,
+                      SETTINGS_DIGITIZER);
+  QDir dir = QFileInfo (settings.fileName ()).absoluteDir ();
+  dir.mkpath (".");
+
+  QMutexLocker locker (&plannerMutex);
+
+  wisdomFilename = dir.absoluteFilePath (WISDOM_FILENAME);
+
+  LOG4CPP_INFO_S ((*mainCat)) << "FftPlanCache::loadWisdom"
+                              << " file=" << wisdomFilename.toLatin1 ().data ();
+
+  // Wisdom from a different fftw version is rejected, in which case the plans are just measured again
+  if (QFile::exists (wisdomFilename)) {
+    if (!fftw_import_wisdom_from_filename (QFile::encodeName (wisdomFilename).constData ())) {
+      LOG4CPP_WARN_S ((*mainCat)) << "FftPlanCache::loadWisdom could not load wisdom";
+    }
+  }
+
+#ifdef ENGAUGE_FFTWF
+  initThreadsFloat ();
+
+  wisdomFilenameFloat = dir.absoluteFilePath (WISDOM_FILENAME_FLOAT);
+
+  if (QFile::exists (wisdomFilenameFloat)) {
+    if (!fftwf_import_wisdom_from_filename (QFile::encodeName (wisdomFilenameFloat).constData ())) {
+      LOG4CPP_WARN_S ((*mainCat)) << "FftPlanCache::loadWisdom could not load single precision wisdom";
+    }
+  }
+#endif
+}
+
+fftw_plan FftPlanCache::planDftC2r1d (int n)
+{
+  return cachedPlan (FftPlanKey (FFT_PLAN_DFT_C2R_1D,
+                                 QPair<int, int> (n, 1)));
+}
+
+fftw_plan FftPlanCache::planDftC2r2d (int width,
+                                      int height)
+{
+  return cachedPlan (FftPlanKey (FFT_PLAN_DFT_C2R_2D,
+                                 QPair<int, int> (width, height)));
+}
+
+#ifdef ENGAUGE_FFTWF
+fftwf_plan FftPlanCache::planDftfC2r2d (int width,
+                                        int height)
+{
+  return cachedPlanFloat (FftPlanKey (FFT_PLAN_DFT_C2R_2D,
+                                      QPair<int, int> (width, height)));
+}
+
+fftwf_plan FftPlanCache::planDftfR2c2d (int width,
+                                        int height)
+{
+  return cachedPlanFloat (FftPlanKey (FFT_PLAN_DFT_R2C_2D,
+                                      QPair<int, int> (width, height)));
+}
+#endif
+
+fftw_plan FftPlanCache::planDftR2c1d (int n)
+{
+  return cachedPlan (FftPlanKey (FFT_PLAN_DFT_R2C_1D,
+                                 QPair<int, int> (n, 1)));
+}
+
+fftw_plan FftPlanCache::planDftR2c2d (int width,
+                                      int height)
+{
+  return cachedPlan (FftPlanKey (FFT_PLAN_DFT_R2C_2D,
+                                 QPair<int, int> (width, height)));
+}
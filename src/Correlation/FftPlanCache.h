@@ -0,0 +1,68 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef FFT_PLAN_CACHE_H
+#define FFT_PLAN_CACHE_H
+
+#include "fftw3.h"
+
+/// Shared fftw plans for every fft user, keyed by transform type and size. Plans are created once and then kept until
+/// the application exits, so repeated transforms of the same size skip planning entirely.
+///
+/// A plan comes from saved wisdom if there is any for its size. Otherwise small transforms are measured with
+/// FFTW_MEASURE, for at most a couple of seconds, and large transforms like those of a whole scanned image are planned
+/// with FFTW_ESTIMATE. Measuring those would take many seconds, and double the memory for the scratch arrays, on the
+/// thread that asked for the plan. Since measuring overwrites the arrays, the plans are created on scratch arrays.
+/// Callers execute them on their own arrays with the fftw_execute_dft_r2c and fftw_execute_dft_c2r functions, which
+/// requires those arrays to be allocated by fftw_malloc (for the same alignment) and the transforms to be out of
+/// place. Those execute functions are thread safe, and the planning here is serialized (without blocking lookups of
+/// plans that already exist), so plans can be shared across threads.
+///
+/// The measurements behind the plans are saved as fftw wisdom in the settings directory, and loaded at startup by
+/// loadWisdom, so the expensive measurements are only made the first time each size is seen.
+///
+/// When built with CONFIG+=fftwf (which defines ENGAUGE_FFTWF), single precision plans are also available. Those use
+/// fftwf_plan_with_nthreads so each transform is spread over all cores, and have their own wisdom file
+class FftPlanCache
+{
+public:
+  /// Load the wisdom saved by earlier sessions. After this is called, the wisdom is saved again whenever a new plan is
+  /// created. Without this call (like in the unit tests) the plans are still cached but no wisdom file is touched
+  static void loadWisdom ();
+
+  /// Plan for a one dimensional complex to real transform, of a (n / 2 + 1) complex array into an n real array. The
+  /// input array is destroyed
+  static fftw_plan planDftC2r1d (int n);
+
+  /// Plan for a two dimensional complex to real transform, of a width by (height / 2 + 1) complex array into a width
+  /// by height real array. The input array is destroyed
+  static fftw_plan planDftC2r2d (int width,
+                                 int height);
+
+#ifdef ENGAUGE_FFTWF
+  /// Single precision version of planDftC2r2d
+  static fftwf_plan planDftfC2r2d (int width,
+                                   int height);
+
+  /// Single precision version of planDftR2c2d
+  static fftwf_plan planDftfR2c2d (int width,
+                                   int height);
+#endif
+
+  /// Plan for a one dimensional real to complex transform, of an n real array into a (n / 2 + 1) complex array
+  static fftw_plan planDftR2c1d (int n);
+
+  /// Plan for a two dimensional real to complex transform, of a width by height real array into a width by
+  /// (height / 2 + 1) complex array
+  static fftw_plan planDftR2c2d (int width,
+                                 int height);
+
+private:
+  FftPlanCache();
+
+};
+
+#endif // FFT_PLAN_CACHE_H
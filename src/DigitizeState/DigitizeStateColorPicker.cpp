@@ -67,7 +67,7 @@ bool DigitizeStateColorPicker::computeFilterFromPixel (CmdMediator *cmdMediator,
   // Filter for background color now, and then later, once filter mode is set, processing of image
   ColorFilter filter;
   QImage image = cmdMediator->document().pixmap().toImage();
-  QRgb rgbBackground = filter.marginColor(&image);
+  QRgb rgbBackground = filter.marginColor(cmdMediator->document().pixmap());
 
   // Adjust screen position so truncation gives round-up behavior
   QPointF posScreenPlusHalf = posScreen - QPointF (0.5, 0.5);
@@ -107,7 +107,7 @@ bool DigitizeStateColorPicker::computeFilterFromPixel (CmdMediator *cmdMediator,
     filterHistogram.generate (filter,
                               histogramBins,
                               modelColorFilterAfter.colorFilterMode (curveName),
-                              image,
+                              cmdMediator->document().pixmap(),
                               maxBinCount);
 
     // Bin for pixel
@@ -4,9 +4,9 @@
  * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
  ******************************************************************************************************/
 
+#include "BitPlane.h"
 #include "CmdAddPointGraph.h"
 #include "CmdMediator.h"
-#include "ColorFilter.h"
 #include "CurveStyles.h"
 #include "DigitizeStateContext.h"
 #include "DigitizeStatePointMatch.h"
@@ -18,16 +18,16 @@
 #include "Logger.h"
 #include "MainWindow.h"
 #include "OrdinalGenerator.h"
-#include "PointMatchAlgorithm.h"
+#include "PointMatchThread.h"
 #include "PointStyle.h"
 #include <QApplication>
 #include <QCursor>
 #include <QGraphicsEllipseItem>
 #include <QGraphicsScene>
-#include <QImage>
 #include <qmath.h>
 #include <QMessageBox>
 #include <QPen>
+#include <QProgressDialog>
 #include <QSize>
 #include "Transformation.h"
 
@@ -36,12 +36,17 @@ const double Z_VALUE = 200.0;
 DigitizeStatePointMatch::DigitizeStatePointMatch (DigitizeStateContext &context) :
   DigitizeStateAbstractBase (context),
   m_outline (0),
-  m_candidatePoint (0)
+  m_candidatePoint (0),
+  m_pointMatchSession (new PointMatchSession),
+  m_pointMatchThread (0),
+  m_progressDlg (0),
+  m_firstCandidateIsShown (false)
 {
 }
 
 DigitizeStatePointMatch::~DigitizeStatePointMatch ()
 {
+  stopThread ();
 }
 
 QString DigitizeStatePointMatch::activeCurve () const
@@ -131,6 +136,9 @@ void DigitizeStatePointMatch::end ()
 {
   LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::end";
 
+  // Search results would be for a curve or image that may be gone by the time this state is entered again
+  stopThread ();
+
   // Remove candidate point which may or may not exist at this point
   context().mainWindow().scene().removeTemporaryPointIfExists();
 
@@ -138,9 +146,12 @@ void DigitizeStatePointMatch::end ()
   ENGAUGE_CHECK_PTR (m_outline);
   context().mainWindow().scene().removeItem (m_outline);
   m_outline = 0;
+
+  // Image transform can be large, and the image may change before this state is entered again
+  m_pointMatchSession->clear ();
 }
 
-QList<PointMatchPixel> DigitizeStatePointMatch::extractSamplePointPixels (const QImage &img,
+QList<PointMatchPixel> DigitizeStatePointMatch::extractSamplePointPixels (const BitPlane &bits,
                                                                           const DocumentModelPointMatch &modelPointMatch,
                                                                           const QPointF &posScreen) const
 {
@@ -153,7 +164,6 @@ QList<PointMatchPixel> DigitizeStatePointMatch::extractSamplePointPixels (const
 
   int radiusMax = modelPointMatch.maxPointSize() / 2;
 
-  ColorFilter colorFilter;
   for (int xOffset = -radiusMax; xOffset <= radiusMax; xOffset++) {
     for (int yOffset = -radiusMax; yOffset <= radiusMax; yOffset++) {
 
@@ -163,9 +173,8 @@ QList<PointMatchPixel> DigitizeStatePointMatch::extractSamplePointPixels (const
 
       if (radius <= radiusMax) {
 
-        bool pixelIsOn = colorFilter.pixelFilteredIsOn (img,
-                                                        x,
-                                                        y);
+        bool pixelIsOn = bits.pixel (x,
+                                     y);
 
         PointMatchPixel point (xOffset,
                                yOffset,
@@ -205,8 +214,10 @@ void DigitizeStatePointMatch::handleKeyPress (CmdMediator *cmdMediator,
   LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::handleKeyPress"
                               << " key=" << QKeySequence (key).toString ().toLatin1 ().data ();
 
-  // The selected key button has to be compatible with GraphicsView::keyPressEvent
-  if (key == Qt::Key_Right) {
+  // The selected key button has to be compatible with GraphicsView::keyPressEvent. The remaining candidates are
+  // not known until the search has finished
+  if ((key == Qt::Key_Right) &&
+      (m_pointMatchThread == 0)) {
 
     promoteCandidatePointToPermanentPoint (cmdMediator); // This removes the current temporary point
 
@@ -227,9 +238,9 @@ void DigitizeStatePointMatch::handleMouseMove (CmdMediator *cmdMediator,
                       modelPointMatch.maxPointSize(),
                       modelPointMatch.maxPointSize());
 
-  const QImage &img = context().mainWindow().imageFiltered();
+  BitPlane bits = context().mainWindow().bitsFiltered();
   int radiusLimit = cmdMediator->document().modelGeneral().cursorSize();
-  bool pixelShouldBeOn = pixelIsOnInImage (img,
+  bool pixelShouldBeOn = pixelIsOnInImage (bits,
                                            posScreen.x(),
                                            posScreen.y(),
                                            radiusLimit);
@@ -266,9 +277,9 @@ void DigitizeStatePointMatch::findPointsAndShowFirstCandidate (CmdMediator *cmdM
   LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::findPointsAndShowFirstCandidate";
 
   const DocumentModelPointMatch &modelPointMatch = cmdMediator->document().modelPointMatch();
-  const QImage &img = context().mainWindow().imageFiltered();
+  BitPlane bits = context().mainWindow().bitsFiltered();
 
-  QList<PointMatchPixel> samplePointPixels = extractSamplePointPixels (img,
+  QList<PointMatchPixel> samplePointPixels = extractSamplePointPixels (bits,
                                                                        modelPointMatch,
                                                                        posScreen);
 
@@ -276,28 +287,43 @@ void DigitizeStatePointMatch::findPointsAndShowFirstCandidate (CmdMediator *cmdM
   const Document &doc = cmdMediator->document();
   const Curve *curve = doc.curveForCurveName (curveName);
 
-  // The point match algorithm takes a few seconds, so set the cursor so user knows we are processing
-  QApplication::setOverrideCursor(Qt::WaitCursor);
-
-  PointMatchAlgorithm pointMatchAlgorithm (context().isGnuplot());
-  m_candidatePoints = pointMatchAlgorithm.findPoints (samplePointPixels,
-                                                      img,
-                                                      modelPointMatch,
-                                                      curve->points());
-
-  QApplication::restoreOverrideCursor(); // Heavy duty processing has finished
-  context().mainWindow().showTemporaryMessage ("Right arrow adds next matched point");
+  // Any earlier search is abandoned since its results do not account for the point that was just added
+  stopThread ();
+  m_candidatePoints.clear ();
+  m_firstCandidateIsShown = false;
+  context().mainWindow().scene().removeTemporaryPointIfExists();
 
-  popCandidatePoint (cmdMediator);
+  // The point match algorithm takes a few seconds, so set the cursor so user knows we are processing. The busy
+  // cursor, unlike the wait cursor, shows that the gui can still be used
+  QApplication::setOverrideCursor(Qt::BusyCursor);
+
+  m_pointMatchThread = new PointMatchThread (samplePointPixels,
+                                             bits,
+                                             modelPointMatch,
+                                             curve->points(),
+                                             m_pointMatchSession,
+                                             context().isGnuplot());
+  ENGAUGE_CHECK_PTR (m_pointMatchThread);
+  connect (m_pointMatchThread, SIGNAL (signalFirstCandidate (QPoint)), this, SLOT (slotFirstCandidate (QPoint)));
+  connect (m_pointMatchThread, SIGNAL (signalProgress (int)), this, SLOT (slotProgress (int)));
+  connect (m_pointMatchThread, SIGNAL (finished ()), this, SLOT (slotFinished ()));
+
+  // Dialog only appears if the search takes a while
+  m_progressDlg = new QProgressDialog (QObject::tr ("Matching points"),
+                                       QObject::tr ("Cancel"),
+                                       0,
+                                       100);
+  ENGAUGE_CHECK_PTR (m_progressDlg);
+  connect (m_progressDlg, SIGNAL (canceled ()), this, SLOT (slotCancel ()));
+
+  m_pointMatchThread->start ();
 }
 
-bool DigitizeStatePointMatch::pixelIsOnInImage (const QImage &img,
+bool DigitizeStatePointMatch::pixelIsOnInImage (const BitPlane &bits,
                                                 int x,
                                                 int y,
                                                 int radiusLimit) const
 {
-  ColorFilter filter;
-
   // Examine all nearby pixels
   bool pixelShouldBeOn = false;
   for (int xOffset = -radiusLimit; xOffset <= radiusLimit; xOffset++) {
@@ -310,18 +336,12 @@ bool DigitizeStatePointMatch::pixelIsOnInImage (const QImage &img,
         int xNearby = x + xOffset;
         int yNearby = y + yOffset;
 
-        if ((0 <= xNearby) &&
-            (0 <= yNearby) &&
-            (xNearby < img.width()) &&
-            (yNearby < img.height())) {
-
-          if (filter.pixelFilteredIsOn (img,
-                                        xNearby,
-                                        yNearby)) {
+        // Pixels outside the image are off
+        if (bits.pixel (xNearby,
+                        yNearby)) {
 
-            pixelShouldBeOn = true;
-            break;
-          }
+          pixelShouldBeOn = true;
+          break;
         }
       }
     }
@@ -359,11 +379,112 @@ void DigitizeStatePointMatch::promoteCandidatePointToPermanentPoint(CmdMediator
                         m_posCandidatePoint);
 }
 
+void DigitizeStatePointMatch::releaseThread ()
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::releaseThread";
+
+  ENGAUGE_CHECK_PTR (m_pointMatchThread);
+
+  // The thread is not waited for, since a cancelled search can take a moment to notice and the gui must not block
+  // meanwhile. It deletes itself once run has returned. Calling deleteLater again, when finished was already sent, is
+  // harmless. Any of its signals that are still queued are dropped, since they are for this search
+  disconnect (m_pointMatchThread, 0, this, 0);
+  connect (m_pointMatchThread, SIGNAL (finished ()), m_pointMatchThread, SLOT (deleteLater ()));
+  if (m_pointMatchThread->isFinished ()) {
+    m_pointMatchThread->deleteLater ();
+  }
+  QCoreApplication::removePostedEvents (this,
+                                        QEvent::MetaCall);
+
+  m_pointMatchThread = 0;
+
+  delete m_progressDlg;
+  m_progressDlg = 0;
+
+  QApplication::restoreOverrideCursor(); // Heavy duty processing has finished
+}
+
+void DigitizeStatePointMatch::slotCancel ()
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::slotCancel";
+
+  // Thread finishes soon afterwards, and then slotFinished cleans up
+  if (m_pointMatchThread != 0) {
+    m_pointMatchThread->requestInterruption ();
+  }
+}
+
+void DigitizeStatePointMatch::slotFinished ()
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::slotFinished";
+
+  ENGAUGE_CHECK_PTR (m_pointMatchThread);
+
+  bool isCanceled = m_pointMatchThread->isInterruptionRequested ();
+  m_candidatePoints = m_pointMatchThread->pointsCreated ();
+
+  releaseThread ();
+
+  if (m_firstCandidateIsShown) {
+
+    // Best match is already on the screen. A search that was cancelled after showing it has no other matches
+    if (!m_candidatePoints.isEmpty ()) {
+      m_candidatePoints.pop_front ();
+    }
+    context().mainWindow().showTemporaryMessage (isCanceled ?
+                                                 "Point match was cancelled" :
+                                                 "Right arrow adds next matched point");
+
+  } else if (isCanceled) {
+
+    context().mainWindow().showTemporaryMessage ("Point match was cancelled");
+
+  } else {
+
+    popCandidatePoint (context().mainWindow().cmdMediator());
+
+  }
+}
+
+void DigitizeStatePointMatch::slotFirstCandidate (QPoint posScreen)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::slotFirstCandidate";
+
+  // Show the best match while the rest are still being sorted
+  createTemporaryPoint (context().mainWindow().cmdMediator(),
+                        posScreen);
+  m_firstCandidateIsShown = true;
+}
+
+void DigitizeStatePointMatch::slotProgress (int percent)
+{
+  if (m_progressDlg != 0) {
+    m_progressDlg->setValue (percent);
+  }
+}
+
 QString DigitizeStatePointMatch::state() const
 {
   return "DigitizeStatePointMatch";
 }
 
+void DigitizeStatePointMatch::stopThread ()
+{
+  if (m_pointMatchThread != 0) {
+
+    LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::stopThread";
+
+    m_pointMatchThread->requestInterruption ();
+
+    // Session stays with the cancelled thread until it notices, so later searches start from a new one
+    if (!m_pointMatchThread->isFinished ()) {
+      m_pointMatchSession = PointMatchSessionPtr (new PointMatchSession);
+    }
+
+    releaseThread ();
+  }
+}
+
 void DigitizeStatePointMatch::updateAfterPointAddition ()
 {
   LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStatePointMatch::updateAfterPointAddition";
@@ -9,17 +9,24 @@
 
 #include "DigitizeStateAbstractBase.h"
 #include "PointMatchPixel.h"
+#include "PointMatchSession.h"
 #include <QList>
+#include <QObject>
 #include <QPoint>
 
+class BitPlane;
 class DocumentModelPointMatch;
+class PointMatchThread;
 class QGraphicsEllipseItem;
 class QGraphicsPixmapItem;
-class QImage;
+class QProgressDialog;
 
-/// Digitizing state for matching Curve Points, one at a time.
-class DigitizeStatePointMatch : public DigitizeStateAbstractBase
+/// Digitizing state for matching Curve Points, one at a time. Matches are found by a PointMatchThread so the gui
+/// stays responsive, with a progress dialog that can cancel the search. The best match is shown as soon as it is known
+class DigitizeStatePointMatch : public QObject, public DigitizeStateAbstractBase
 {
+  Q_OBJECT;
+
 public:
   /// Single constructor.
   DigitizeStatePointMatch(DigitizeStateContext &context);
@@ -52,6 +59,12 @@ public:
                                          const DocumentModelDigitizeCurve &modelDigitizeCurve);
   virtual void updateModelSegments(const DocumentModelSegments &modelSegments);
 
+private slots:
+  void slotCancel ();
+  void slotFirstCandidate (QPoint posScreen);
+  void slotFinished ();
+  void slotProgress (int percent);
+
 private:
   DigitizeStatePointMatch();
 
@@ -59,17 +72,19 @@ private:
                              const QPointF &posScreen);
   void createTemporaryPoint (CmdMediator *cmdMediator,
                              const QPoint &posScreen);
-  QList<PointMatchPixel> extractSamplePointPixels (const QImage &img,
+  QList<PointMatchPixel> extractSamplePointPixels (const BitPlane &bits,
                                                    const DocumentModelPointMatch &modelPointMatch,
                                                    const QPointF &posScreen) const;
   void findPointsAndShowFirstCandidate (CmdMediator *cmdMediator,
                                         const QPointF &posScreen);
-  bool pixelIsOnInImage (const QImage &img,
+  bool pixelIsOnInImage (const BitPlane &bits,
                          int x,
                          int y,
                          int radiusLimit) const;
   void popCandidatePoint (CmdMediator *cmdMediator);
   void promoteCandidatePointToPermanentPoint(CmdMediator *cmdMediator);
+  void releaseThread (); // Let go of the thread, which deletes itself once finished, and delete the progress dialog
+  void stopThread (); // Cancel any search that is still running
 
   QGraphicsEllipseItem *m_outline;
   QGraphicsPixmapItem *m_candidatePoint;
@@ -79,6 +94,16 @@ private:
   QList<QPoint> m_candidatePoints;
 
   QPoint m_posCandidatePoint;
+
+  // Image transform kept between point match requests, since only the sample and existing points change between them.
+  // Shared with the running thread, if any
+  PointMatchSessionPtr m_pointMatchSession;
+
+  // Thread and its progress dialog while a search is running, otherwise zero
+  PointMatchThread *m_pointMatchThread;
+  QProgressDialog *m_progressDlg;
+
+  bool m_firstCandidateIsShown; // True once the best match of the running search has been shown
 };
 
 #endif // DIGITIZE_STATE_POINT_MATCH_H
@@ -4,6 +4,7 @@
  * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
  ******************************************************************************************************/
 
+#include "BitPlane.h"
 #include "CmdAddPointsGraph.h"
 #include "DigitizeStateContext.h"
 #include "DigitizeStateSegment.h"
@@ -90,7 +91,7 @@ void DigitizeStateSegment::handleCurveChange(CmdMediator *cmdMediator)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "DigitizeStateSegment::handleCurveChange";
 
-  QImage img = context().mainWindow().imageFiltered();
+  BitPlane bits = context().mainWindow().bitsFiltered();
 
   GraphicsScene &scene = context().mainWindow().scene();
   SegmentFactory segmentFactory ((QGraphicsScene &) scene,
@@ -99,7 +100,7 @@ void DigitizeStateSegment::handleCurveChange(CmdMediator *cmdMediator)
   segmentFactory.clearSegments (m_segments);
 
   // Create new segments
-  segmentFactory.makeSegments (img,
+  segmentFactory.makeSegments (bits,
                                cmdMediator->document().modelSegments(),
                                m_segments);
 
@@ -28,6 +28,8 @@ void DlgFilterThread::run ()
     // Connect signal to start process
     connect (&m_dlgSettingsColorFilter, SIGNAL (signalApplyFilter (ColorFilterMode, double, double)),
              m_dlgFilterWorker, SLOT (slotNewParameters (ColorFilterMode, double, double)));
+    connect (&m_dlgSettingsColorFilter, SIGNAL (signalResetPreview ()),
+             m_dlgFilterWorker, SLOT (slotResetPreview ()));
 
     // Connect signal to return each piece of completed processing
     connect (m_dlgFilterWorker, SIGNAL (signalTransferPiece (int, QImage)),
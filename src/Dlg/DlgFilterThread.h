@@ -29,8 +29,8 @@ public:
   virtual void run();
 
 signals:
-  /// Send a processed vertical piece of the original pixmap. The destination is between xLeft and xLeft+pixmap.width()
-  void signalTransferPiece (int xLeft,
+  /// Send a processed horizontal piece of the original pixmap. The destination is between yTop and yTop+image.height()
+  void signalTransferPiece (int yTop,
                             QImage image);
 
 private:
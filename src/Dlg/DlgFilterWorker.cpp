@@ -4,13 +4,15 @@
  * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
  ******************************************************************************************************/
 
-#include "ColorFilter.h"
 #include "DlgFilterWorker.h"
 #include "Logger.h"
 #include <QImage>
+#include <qmath.h>
+#include <string.h>
 
 const int NO_DELAY = 0;
-const int COLUMNS_PER_PIECE = 5;
+const int PIXELS_PER_PIECE = 1000000; // Refinement is done in pieces of about this size, so new parameters are noticed quickly
+const int PIXELS_REDUCED = 512 * 512; // Larger images get a quick preview at reduced resolution first
 
 DlgFilterWorker::DlgFilterWorker(const QPixmap &pixmapOriginal,
                                  QRgb rgbBackground) :
@@ -20,7 +22,19 @@ DlgFilterWorker::DlgFilterWorker(const QPixmap &pixmapOriginal,
   m_low (-1.0),
   m_high (-1.0)
 {
-  m_restartTimer.setSingleShot (false);
+  // Quick preview uses every n'th pixel, rather than averaging pixels, so the reduced image has only original colors
+  int pixelsOriginal = m_imageOriginal.width () * m_imageOriginal.height ();
+  if (pixelsOriginal > PIXELS_REDUCED) {
+    double reduction = qSqrt ((double) PIXELS_REDUCED / (double) pixelsOriginal);
+    m_imageReduced = m_imageOriginal.scaled (qMax (1, (int) (reduction * m_imageOriginal.width ())),
+                                             qMax (1, (int) (reduction * m_imageOriginal.height ())),
+                                             Qt::IgnoreAspectRatio,
+                                             Qt::FastTransformation);
+  }
+
+  m_rowsPerPiece = qMax (1, PIXELS_PER_PIECE / qMax (1, m_imageOriginal.width ()));
+
+  m_restartTimer.setSingleShot (true);
   connect (&m_restartTimer, SIGNAL (timeout ()), this, SLOT (slotRestartTimeout()));
 }
 
@@ -45,70 +59,132 @@ void DlgFilterWorker::slotNewParameters (ColorFilterMode colorFilterMode,
   }
 }
 
+void DlgFilterWorker::slotResetPreview ()
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "DlgFilterWorker::slotResetPreview";
+
+  m_bitsSent = BitPlane ();
+}
+
+void DlgFilterWorker::emitChangedRows (const BitPlane &bitsFiltered)
+{
+  // Moving a divider usually changes only some of the pixels, and the rows that did not change are not sent
+  int yStart = 0;
+  int yStop = bitsFiltered.height ();
+  if ((m_bitsSent.width () == bitsFiltered.width ()) &&
+      (m_bitsSent.height () == bitsFiltered.height ())) {
+
+    int bytesPerLine = bitsFiltered.wordsPerLine () * sizeof (quint64);
+    while ((yStart < yStop) &&
+           (memcmp (bitsFiltered.constScanLine (yStart), m_bitsSent.constScanLine (yStart), bytesPerLine) == 0)) {
+      ++yStart;
+    }
+    while ((yStop > yStart) &&
+           (memcmp (bitsFiltered.constScanLine (yStop - 1), m_bitsSent.constScanLine (yStop - 1), bytesPerLine) == 0)) {
+      --yStop;
+    }
+  }
+
+  m_bitsSent = bitsFiltered;
+
+  if (yStart < yStop) {
+    emit signalTransferPiece (yStart,
+                              bitsFiltered.toImageRows (yStart,
+                                                        yStop));
+  }
+}
+
+void DlgFilterWorker::emitFullResolution ()
+{
+  BitPlane bitsFiltered (m_imageOriginal.width(),
+                         m_imageOriginal.height());
+  m_levels.threshold (m_low,
+                      m_high,
+                      bitsFiltered);
+
+  emitChangedRows (bitsFiltered);
+}
+
+void DlgFilterWorker::emitReducedResolution ()
+{
+  BitPlane bitsReduced (m_imageReduced.width(),
+                        m_imageReduced.height());
+  m_levelsReduced.threshold (m_low,
+                             m_high,
+                             bitsReduced);
+
+  // Enlarged by repeating pixels, like Qt::FastTransformation. Consecutive rows that come from the same reduced row
+  // are copies of each other
+  int width = m_imageOriginal.width ();
+  int height = m_imageOriginal.height ();
+  BitPlane bitsFiltered (width,
+                         height);
+  int bytesPerLine = bitsFiltered.wordsPerLine () * sizeof (quint64);
+  int yReducedLast = -1;
+  for (int y = 0; y < height; y++) {
+
+    int yReduced = (y * bitsReduced.height ()) / height;
+    if (yReduced == yReducedLast) {
+      memcpy (bitsFiltered.scanLine (y), bitsFiltered.scanLine (y - 1), bytesPerLine);
+    } else {
+      yReducedLast = yReduced;
+      for (int x = 0; x < width; x++) {
+        if (bitsReduced.pixel ((x * bitsReduced.width ()) / width, yReduced)) {
+          bitsFiltered.setPixel (x, y, true);
+        }
+      }
+    }
+  }
+
+  emitChangedRows (bitsFiltered);
+}
+
 void DlgFilterWorker::slotRestartTimeout ()
 {
   if (m_inputCommandQueue.count() > 0) {
 
+    // Only the most recent command matters. Any refinement for an earlier command is abandoned, although levels that
+    // were already computed are kept if the mode is unchanged since they do not depend on the thresholds
     DlgFilterCommand command = m_inputCommandQueue.last();
     m_inputCommandQueue.clear ();
 
-    // Start over from the left side
     m_colorFilterMode = command.colorFilterMode();
     m_low = command.low0To1();
     m_high = command.high0To1();
 
-    m_xLeft = 0;
-
-    // Start timer to process first piece
-    m_restartTimer.start (NO_DELAY);
-
-  } else if (m_xLeft < m_imageOriginal.width ()) {
-
-    // To to process a new piece, starting at m_xLeft
-    int xStop = m_xLeft + COLUMNS_PER_PIECE;
-    if (xStop >= m_imageOriginal.width()) {
-      xStop = m_imageOriginal.width();
+    // The expensive per pixel conversion is only done when the mode changes. Dragging the dividers just changes
+    // the thresholds, which are applied by the cheap pass in ColorFilterLevels::threshold
+    if (m_levels.colorFilterMode () != m_colorFilterMode) {
+
+      bool computeAllRows = m_imageReduced.isNull (); // Small images are computed at once, without a quick preview
+      m_levels = ColorFilterLevels (m_imageOriginal,
+                                    m_colorFilterMode,
+                                    m_rgbBackground,
+                                    computeAllRows);
+      if (!m_imageReduced.isNull ()) {
+        m_levelsReduced = ColorFilterLevels (m_imageReduced,
+                                             m_colorFilterMode,
+                                             m_rgbBackground);
+      }
     }
 
-    // From  here on, if a new command gets pushed onto the queue then we immediately stop processing
-    // and do nothing except start the timer so we can start over after the next timeout. The goal is
-    // to not tie up the gui by emitting signalTransferPiece unnecessarily.
-    //
-    // This code is basically a heavily customized version of ColorFilter::filterImage
-    ColorFilter filter;
-    int processedWidth = xStop - m_xLeft;
-    QImage imageProcessed (processedWidth,
-                           m_imageOriginal.height(),
-                           QImage::Format_RGB32);
-    for (int xFrom = m_xLeft, xTo = 0; (xFrom < xStop) && (m_inputCommandQueue.count() == 0); xFrom++, xTo++) {
-      for (int y = 0; (y < m_imageOriginal.height ()) && (m_inputCommandQueue.count() == 0); y++) {
-        QColor pixel = m_imageOriginal.pixel (xFrom, y);
-        bool isOn = false;
-        if (pixel.rgb() != m_rgbBackground) {
-
-          isOn = filter.pixelUnfilteredIsOn (m_colorFilterMode,
-                                             pixel,
-                                             m_rgbBackground,
-                                             m_low,
-                                             m_high);
-        }
+    if (m_levels.isComplete ()) {
+      emitFullResolution ();
+    } else {
 
-        imageProcessed.setPixel (xTo, y, (isOn ?
-                                          QColor (Qt::black).rgb () :
-                                          QColor (Qt::white).rgb ()));
-      }
+      // Quick preview of the whole image now, and refinement in pieces starting with the next timeout
+      emitReducedResolution ();
+      m_restartTimer.start (NO_DELAY);
     }
 
-    if (m_inputCommandQueue.count() == 0) {
-      emit signalTransferPiece (m_xLeft,
-                                imageProcessed);
-      m_xLeft += processedWidth;
-    }
+  } else if (!m_levels.isComplete ()) {
 
-    if ((xStop < m_imageOriginal.width()) ||
-        (m_inputCommandQueue.count () > 0)) {
+    // Refine the next piece. Returning to the event loop after each piece lets a new command cancel the refinement
+    m_levels.computeRows (m_rowsPerPiece);
 
-      // Restart timer to process next piece
+    if (m_levels.isComplete ()) {
+      emitFullResolution ();
+    } else {
       m_restartTimer.start (NO_DELAY);
     }
   }
@@ -7,6 +7,8 @@
 #ifndef DLG_FILTER_WORKER_H
 #define DLG_FILTER_WORKER_H
 
+#include "BitPlane.h"
+#include "ColorFilterLevels.h"
 #include "ColorFilterMode.h"
 #include "DlgFilterCommand.h"
 #include <QImage>
@@ -29,22 +31,38 @@ public:
                   QRgb m_rgbBackground);
 
 public slots:
-  /// Start processing with a new set of parameters. Any ongoing processing is interrupted when m_filterMode changes.
+  /// Start processing with a new set of parameters. Any ongoing refinement of the preview is abandoned. Large images
+  /// get a quick preview at reduced resolution, which is then refined to full resolution in pieces
   void slotNewParameters (ColorFilterMode colorFilterMode,
                           double low,
                           double high);
 
+  /// Forget the filtered image that was sent last, since the preview was reset to the original image. The next
+  /// filtered image is then sent in full rather than just its changed rows
+  void slotResetPreview ();
+
 private slots:
   void slotRestartTimeout ();
 
 signals:
-  /// Send a processed vertical piece of the original pixmap. The destination is between xLeft and xLeft+pixmap.width()
-  void signalTransferPiece (int xLeft,
+  /// Send a processed horizontal piece of the original pixmap, as a one bit per pixel image. The destination is between
+  /// yTop and yTop+image.height(). The piece is the band of rows that changed since the last piece was sent, first for
+  /// an enlarged quick preview and then at full resolution. Nothing is sent if no row changed
+  void signalTransferPiece (int yTop,
                             QImage image);
 
 private:
   DlgFilterWorker();
 
+  // Send the rows of the filtered bit plane that differ from the ones that were sent last
+  void emitChangedRows (const BitPlane &bitsFiltered);
+
+  // Threshold the levels of the original image and send the result
+  void emitFullResolution ();
+
+  // Threshold the levels of the reduced image and send the result, enlarged to the size of the original image
+  void emitReducedResolution ();
+
   QImage m_imageOriginal; // Use QImage rather than QPixmap so we can access pixel by pixel
   QRgb m_rgbBackground;
 
@@ -53,7 +71,12 @@ private:
   double m_low;
   double m_high;
 
-  int m_xLeft;
+  QImage m_imageReduced; // Reduced resolution copy of m_imageOriginal for the quick preview. Null for small images
+  int m_rowsPerPiece; // Rows of levels computed per timeout while refining
+
+  ColorFilterLevels m_levels; // Levels for m_colorFilterMode, which are recomputed only when the mode changes
+  ColorFilterLevels m_levelsReduced; // Levels of m_imageReduced for m_colorFilterMode
+  BitPlane m_bitsSent; // Filtered bits that the dialog is showing, for finding the rows that change
   QTimer m_restartTimer; // Decouple slotRestartProcessing from the processing that this class performs
 };
 
@@ -17,10 +17,12 @@
 #include <QComboBox>
 #include <QDebug>
 #include <QGraphicsLineItem>
+#include <QGraphicsPixmapItem>
 #include <QGraphicsScene>
 #include <QGridLayout>
 #include <QImage>
 #include <QLabel>
+#include <QPainter>
 #include <qmath.h>
 #include <QPixmap>
 #include <QRadioButton>
@@ -40,6 +42,7 @@ DlgSettingsColorFilter::DlgSettingsColorFilter(MainWindow &mainWindow) :
   m_scenePreview (0),
   m_viewPreview (0),
   m_filterThread (0),
+  m_itemPreview (0),
   m_modelColorFilterBefore (0),
   m_modelColorFilterAfter (0)
 {
@@ -196,9 +199,8 @@ QRgb DlgSettingsColorFilter::createThread ()
   LOG4CPP_INFO_S ((*mainCat)) << "DlgSettingsColorFilter::createThread";
 
   // Get background color
-  QImage image = cmdMediator().document().pixmap().toImage();
   ColorFilter filter;
-  QRgb rgbBackground = filter.marginColor(&image);
+  QRgb rgbBackground = filter.marginColor(cmdMediator().document().pixmap());
 
   // Only create thread once
   if (m_filterThread == 0) {
@@ -280,8 +282,9 @@ void DlgSettingsColorFilter::loadForCurveName()
     m_btnValue->setChecked (colorFilterMode == COLOR_FILTER_MODE_VALUE);
 
     m_scenePreview->clear();
-    m_imagePreview = cmdMediator().document().pixmap().toImage();
-    m_scenePreview->addPixmap (QPixmap::fromImage (m_imagePreview));
+    m_pixmapPreview = cmdMediator().document().pixmap();
+    m_itemPreview = m_scenePreview->addPixmap (m_pixmapPreview);
+    emit signalResetPreview ();
 
     QRgb rgbBackground = createThread ();
     m_scale->setBackgroundColor (rgbBackground);
@@ -359,29 +362,23 @@ void DlgSettingsColorFilter::slotSaturation ()
   updatePreview();
 }
 
-void DlgSettingsColorFilter::slotTransferPiece (int xLeft,
+void DlgSettingsColorFilter::slotTransferPiece (int yTop,
                                                 QImage image)
 {
-  // Overwrite one piece of the processed image. This approach is a bit slow because the entire QPixmap
-  // in the QGraphicsScene gets exchanged as part of each update, but that seems to be the only possible
-  // approach when using QGraphicsScene. If not fast enough or there is ugly flicker, we may replace
-  // QGraphicsScene by a simple QWidget and override the paint function - but that approach may get
-  // complicated when resizing the QGraphicsView
-  for (int xFrom = 0, xTo = xLeft; xFrom < image.width(); xFrom++, xTo++) {
-    for (int y = 0; y < image.height (); y++) {
-
-      QColor pixel = image.pixel (xFrom, y);
-      m_imagePreview.setPixel (xTo, y, pixel.rgb());
-    }
-  }
-
-  // Remove old pixmap
-  QGraphicsItem *itemPixmap = m_scenePreview->items().at(0);
-  m_scenePreview->removeItem (itemPixmap);
-  delete itemPixmap;
-
-  // Save new pixmap. Only visible change should be the area covered by the pixels in image
-  m_scenePreview->addPixmap (QPixmap::fromImage (m_imagePreview));
+  // Overwrite the band of rows that changed. The item lets go of the pixmap while it is painted, so the painter
+  // modifies the pixels in place rather than detaching a full size copy. Only the band is converted from one bit
+  // per pixel, and the pixels are copied with the source mode so they replace rather than blend with the old pixels
+  m_itemPreview->setPixmap (QPixmap ());
+
+  QPainter painter (&m_pixmapPreview);
+  painter.setCompositionMode (QPainter::CompositionMode_Source);
+  painter.drawImage (0,
+                     yTop,
+                     image);
+  painter.end ();
+
+  // Sharing the pixmap again does not copy it. The view repaints only the part of the item it shows
+  m_itemPreview->setPixmap (m_pixmapPreview);
 }
 
 void DlgSettingsColorFilter::slotValue ()
@@ -408,9 +405,6 @@ void DlgSettingsColorFilter::updateHistogram()
 
   m_scale->setColorFilterMode (m_modelColorFilterAfter->colorFilterMode(curveName));
 
-  // Start with original image
-  QImage image = cmdMediator().document().pixmap().toImage();
-
   double *histogramBins = new double [ColorFilterHistogram::HISTOGRAM_BINS ()];
 
   ColorFilter filter;
@@ -419,7 +413,7 @@ void DlgSettingsColorFilter::updateHistogram()
   filterHistogram.generate (filter,
                             histogramBins,
                             m_modelColorFilterAfter->colorFilterMode (curveName),
-                            image,
+                            cmdMediator().document().pixmap(),
                             maxBinCount);
 
   // Draw histogram, normalizing so highest peak exactly fills the vertical range. Log scale is used
@@ -16,6 +16,7 @@
 class DlgFilterThread;
 class DocumentModelColorFilter;
 class QComboBox;
+class QGraphicsPixmapItem;
 class QGraphicsScene;
 class QGridLayout;
 class QLabel;
@@ -41,8 +42,8 @@ public:
   virtual void setSmallDialogs (bool smallDialogs);
 
 public slots:
-  /// Receive processed piece of preview image, to be inserted at xLeft to xLeft+pixmap.width().
-  void slotTransferPiece (int xLeft,
+  /// Receive processed piece of preview image, to be inserted at yTop to yTop+image.height().
+  void slotTransferPiece (int yTop,
                           QImage image);
 
 signals:
@@ -51,6 +52,9 @@ signals:
                           double low,
                           double high);
 
+  /// Tell DlgFilterWorker that the preview shows the original image again, so the next filtered image is sent in full
+  void signalResetPreview ();
+
 private slots:
   void slotCurveName(const QString &curveName);
   void slotDividerHigh (double);
@@ -98,7 +102,8 @@ private:
   // will not be slowed down by the filter parameter processing
   DlgFilterThread *m_filterThread;
 
-  QImage m_imagePreview;
+  QPixmap m_pixmapPreview;
+  QGraphicsPixmapItem *m_itemPreview; // Shows m_pixmapPreview. Owned by m_scenePreview
 
   DocumentModelColorFilter *m_modelColorFilterBefore;
   DocumentModelColorFilter *m_modelColorFilterAfter;
@@ -26,6 +26,8 @@
 #include "ZoomFactorInitial.h"
 #include "ZoomLabels.h"
 
+const int FILTERED_IMAGE_CACHE_MEGABYTES_MIN = 0;
+const int FILTERED_IMAGE_CACHE_MEGABYTES_MAX = 4096;
 const int MAX_GRID_LINES_MIN = 2;
 const int MAX_GRID_LINES_MAX = 1000;
 const int MINIMUM_DIALOG_WIDTH_MAIN_WINDOW = 550;
@@ -163,6 +165,18 @@ void DlgSettingsMainWindow::createControls (QGridLayout *layout,
   connect (m_spinMaximumGridLines, SIGNAL (valueChanged (int)), this, (SLOT (slotMaximumGridLines (int))));
   layout->addWidget (m_spinMaximumGridLines, row++, 2);
 
+  QLabel *labelFilteredImageCache = new QLabel (tr ("Filtered image cache (MB):"));
+  layout->addWidget (labelFilteredImageCache, row, 1);
+
+  m_spinFilteredImageCache = new QSpinBox;
+  m_spinFilteredImageCache->setRange (FILTERED_IMAGE_CACHE_MEGABYTES_MIN, FILTERED_IMAGE_CACHE_MEGABYTES_MAX);
+  m_spinFilteredImageCache->setWhatsThis (tr ("Filtered Image Cache\n\n"
+                                              "Memory, in megabytes, used to remember recently filtered images so switching back to "
+                                              "a curve whose color filter and grid removal settings have not changed is immediate. "
+                                              "Zero disables the cache"));
+  connect (m_spinFilteredImageCache, SIGNAL (valueChanged (int)), this, (SLOT (slotFilteredImageCache (int))));
+  layout->addWidget (m_spinFilteredImageCache, row++, 2);
+
   QLabel *labelHighlightOpacity = new QLabel (tr ("Highlight opacity:"));
   layout->addWidget (labelHighlightOpacity, row, 1);
 
@@ -294,6 +308,7 @@ void DlgSettingsMainWindow::loadMainWindowModel (CmdMediator &cmdMediator,
   m_cmbPdfResolution->setCurrentIndex(index);
 #endif
   m_spinMaximumGridLines->setValue (m_modelMainWindowAfter->maximumGridLines());
+  m_spinFilteredImageCache->setValue (m_modelMainWindowAfter->filteredImageCacheMegabytes());
   m_spinHighlightOpacity->setValue (m_modelMainWindowAfter->highlightOpacity());
   m_chkSmallDialogs->setChecked (m_modelMainWindowAfter->smallDialogs());
   m_chkDragDropExport->setChecked (m_modelMainWindowAfter->dragDropExport());
@@ -314,6 +329,14 @@ void DlgSettingsMainWindow::slotDragDropExport (bool)
   updateControls ();
 }
 
+void DlgSettingsMainWindow::slotFilteredImageCache (int megabytes)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "DlgSettingsMainWindow::slotFilteredImageCache";
+
+  m_modelMainWindowAfter->setFilteredImageCacheMegabytes (megabytes);
+  updateControls ();
+}
+
 void DlgSettingsMainWindow::slotHighlightOpacity(double)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "DlgSettingsMainWindow::slotHighlightOpacity";
@@ -39,6 +39,7 @@ public:
 
 private slots:
   void slotDragDropExport (bool);
+  void slotFilteredImageCache (int megabytes);
   void slotHighlightOpacity (double);
   void slotImportCropping (int index);
   void slotLocale (int index);
@@ -67,6 +68,7 @@ private:
   QCheckBox *m_chkTitleBarFormat;
   QComboBox *m_cmbPdfResolution;
   QSpinBox *m_spinMaximumGridLines;
+  QSpinBox *m_spinFilteredImageCache;
   QDoubleSpinBox *m_spinHighlightOpacity;
   QCheckBox *m_chkSmallDialogs;
   QCheckBox *m_chkDragDropExport;
@@ -10,6 +10,7 @@
 #include "EngaugeAssert.h"
 #include "Logger.h"
 #include "MainWindow.h"
+#include <QCheckBox>
 #include <QComboBox>
 #include <QGraphicsEllipseItem>
 #include <QGraphicsPixmapItem>
@@ -95,6 +96,23 @@ void DlgSettingsPointMatch::createControls (QGridLayout *layout,
   connect (m_spinPointSize, SIGNAL (valueChanged (int)), this, SLOT (slotMaxPointSize (int)));
   layout->addWidget (m_spinPointSize, row++, 2);
 
+  m_chkCoarseToFine = new QCheckBox (tr ("Coarse to fine matching"));
+  m_chkCoarseToFine->setWhatsThis (tr ("Select to search a reduced resolution copy of the image first, and then refine each "
+                                       "candidate point at full resolution.\n\n"
+                                       "The candidate points are still found to the nearest pixel. Very small points are always "
+                                       "searched at full resolution"));
+  connect (m_chkCoarseToFine, SIGNAL (stateChanged (int)), this, SLOT (slotCoarseToFine (int)));
+  layout->addWidget (m_chkCoarseToFine, row++, 2);
+
+  m_chkTemplateBank = new QCheckBox (tr ("Rotation and scale tolerant matching"));
+  m_chkTemplateBank->setWhatsThis (tr ("Select to also match slightly rotated and rescaled copies of the sample point, for "
+                                       "scanned images that are a little rotated or stretched.\n\n"
+                                       "Candidate locations are found with the sample point, and each one gets the best nearby "
+                                       "match of any copy. The copies are only compared near the candidates, so matching is "
+                                       "only a little slower"));
+  connect (m_chkTemplateBank, SIGNAL (stateChanged (int)), this, SLOT (slotTemplateBank (int)));
+  layout->addWidget (m_chkTemplateBank, row++, 2);
+
   QLabel *labelAcceptedPointColor = new QLabel (tr ("Accepted point color:"));
   layout->addWidget (labelAcceptedPointColor, row, 1);
 
@@ -228,6 +246,8 @@ void DlgSettingsPointMatch::load (CmdMediator &cmdMediator)
 
   // Populate controls
   m_spinPointSize->setValue(m_modelPointMatchAfter->maxPointSize());
+  m_chkCoarseToFine->setChecked(m_modelPointMatchAfter->coarseToFine());
+  m_chkTemplateBank->setChecked(m_modelPointMatchAfter->templateBank());
 
   int indexAccepted = m_cmbAcceptedPointColor->findData(QVariant(m_modelPointMatchAfter->paletteColorAccepted()));
   ENGAUGE_ASSERT (indexAccepted >= 0);
@@ -290,6 +310,14 @@ void DlgSettingsPointMatch::slotCandidatePointColor (const QString &)
   updatePreview();
 }
 
+void DlgSettingsPointMatch::slotCoarseToFine (int)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "DlgSettingsPointMatch::slotCoarseToFine";
+
+  m_modelPointMatchAfter->setCoarseToFine(m_chkCoarseToFine->isChecked());
+  updateControls();
+}
+
 void DlgSettingsPointMatch::slotMaxPointSize (int maxPointSize)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "DlgSettingsPointMatch::slotMaxPointSize";
@@ -317,6 +345,14 @@ void DlgSettingsPointMatch::slotRejectedPointColor (const QString &)
   updatePreview();
 }
 
+void DlgSettingsPointMatch::slotTemplateBank (int)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "DlgSettingsPointMatch::slotTemplateBank";
+
+  m_modelPointMatchAfter->setTemplateBank(m_chkTemplateBank->isChecked());
+  updateControls();
+}
+
 void DlgSettingsPointMatch::updateControls()
 {
   // All controls in this dialog are always fully validated so the ok button is always enabled (after the first change)
@@ -11,6 +11,7 @@
 #include "DlgSettingsAbstractBase.h"
 
 class DocumentModelPointMatch;
+class QCheckBox;
 class QComboBox;
 class QGraphicsEllipseItem;
 class QGraphicsLineItem;
@@ -38,9 +39,11 @@ public:
 private slots:
   void slotAcceptedPointColor (const QString &);
   void slotCandidatePointColor (const QString &);
+  void slotCoarseToFine (int);
   void slotMaxPointSize (int);
   void slotMouseMove (QPointF pos);
   void slotRejectedPointColor (const QString &);
+  void slotTemplateBank (int);
 
 protected:
   virtual void handleOk ();
@@ -60,6 +63,8 @@ private:
 
   QSpinBox *m_spinMinPointSeparation;
   QSpinBox *m_spinPointSize;
+  QCheckBox *m_chkCoarseToFine;
+  QCheckBox *m_chkTemplateBank;
   QComboBox *m_cmbAcceptedPointColor;
   QComboBox *m_cmbRejectedPointColor;
   QComboBox *m_cmbCandidatePointColor;
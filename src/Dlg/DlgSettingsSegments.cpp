@@ -4,6 +4,7 @@
  * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
  ******************************************************************************************************/
 
+#include "BitPlane.h"
 #include "CmdMediator.h"
 #include "CmdSettingsSegments.h"
 #include "DlgSettingsSegments.h"
@@ -368,7 +369,7 @@ void DlgSettingsSegments::updatePreview()
     segmentFactory.clearSegments (m_segments);
 
     // Create new segments
-    segmentFactory.makeSegments (createPreviewImage(),
+    segmentFactory.makeSegments (BitPlane (createPreviewImage()),
                                  *m_modelSegmentsAfter,
                                  m_segments);
 
@@ -15,6 +15,8 @@
 
 const double DEFAULT_MIN_POINT_SEPARATION = 20;
 const double DEFAULT_MAX_POINT_SIZE = 48;
+const bool DEFAULT_COARSE_TO_FINE = false;
+const bool DEFAULT_TEMPLATE_BANK = false;
 const ColorPalette DEFAULT_COLOR_ACCEPTED = COLOR_PALETTE_GREEN;
 const ColorPalette DEFAULT_COLOR_CANDIDATE = COLOR_PALETTE_YELLOW;
 const ColorPalette DEFAULT_COLOR_REJECTED = COLOR_PALETTE_RED;
@@ -22,6 +24,8 @@ const ColorPalette DEFAULT_COLOR_REJECTED = COLOR_PALETTE_RED;
 DocumentModelPointMatch::DocumentModelPointMatch() :
   m_minPointSeparation (DEFAULT_MIN_POINT_SEPARATION),
   m_maxPointSize (DEFAULT_MAX_POINT_SIZE),
+  m_coarseToFine (DEFAULT_COARSE_TO_FINE),
+  m_templateBank (DEFAULT_TEMPLATE_BANK),
   m_paletteColorAccepted (DEFAULT_COLOR_ACCEPTED),
   m_paletteColorCandidate (DEFAULT_COLOR_CANDIDATE),
   m_paletteColorRejected (DEFAULT_COLOR_REJECTED)
@@ -30,6 +34,8 @@ DocumentModelPointMatch::DocumentModelPointMatch() :
 
 DocumentModelPointMatch::DocumentModelPointMatch(const Document &document) :
   m_maxPointSize (document.modelPointMatch().maxPointSize()),
+  m_coarseToFine (document.modelPointMatch().coarseToFine()),
+  m_templateBank (document.modelPointMatch().templateBank()),
   m_paletteColorAccepted (document.modelPointMatch().paletteColorAccepted()),
   m_paletteColorCandidate (document.modelPointMatch().paletteColorCandidate()),
   m_paletteColorRejected (document.modelPointMatch().paletteColorRejected())
@@ -38,6 +44,8 @@ DocumentModelPointMatch::DocumentModelPointMatch(const Document &document) :
 
 DocumentModelPointMatch::DocumentModelPointMatch(const DocumentModelPointMatch &other) :
   m_maxPointSize (other.maxPointSize()),
+  m_coarseToFine (other.coarseToFine()),
+  m_templateBank (other.templateBank()),
   m_paletteColorAccepted (other.paletteColorAccepted()),
   m_paletteColorCandidate (other.paletteColorCandidate()),
   m_paletteColorRejected (other.paletteColorRejected())
@@ -47,6 +55,8 @@ DocumentModelPointMatch::DocumentModelPointMatch(const DocumentModelPointMatch &
 DocumentModelPointMatch &DocumentModelPointMatch::operator=(const DocumentModelPointMatch &other)
 {
   m_maxPointSize = other.maxPointSize();
+  m_coarseToFine = other.coarseToFine();
+  m_templateBank = other.templateBank();
   m_paletteColorAccepted = other.paletteColorAccepted();
   m_paletteColorCandidate = other.paletteColorCandidate();
   m_paletteColorRejected = other.paletteColorRejected();
@@ -54,6 +64,11 @@ DocumentModelPointMatch &DocumentModelPointMatch::operator=(const DocumentModelP
   return *this;
 }
 
+bool DocumentModelPointMatch::coarseToFine() const
+{
+  return m_coarseToFine;
+}
+
 void DocumentModelPointMatch::loadXml(QXmlStreamReader &reader)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "DocumentModelPointMatch::loadXml";
@@ -71,6 +86,20 @@ void DocumentModelPointMatch::loadXml(QXmlStreamReader &reader)
     setPaletteColorAccepted ((ColorPalette) attributes.value(DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_ACCEPTED).toInt());
     setPaletteColorCandidate ((ColorPalette) attributes.value(DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_CANDIDATE).toInt());
     setPaletteColorRejected ((ColorPalette) attributes.value(DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_REJECTED).toInt());
+    if (attributes.hasAttribute(DOCUMENT_SERIALIZE_POINT_MATCH_COARSE_TO_FINE)) {
+
+      // Boolean value
+      QString stringCoarseToFine = attributes.value (DOCUMENT_SERIALIZE_POINT_MATCH_COARSE_TO_FINE).toString();
+
+      setCoarseToFine (stringCoarseToFine == DOCUMENT_SERIALIZE_BOOL_TRUE);
+    }
+    if (attributes.hasAttribute(DOCUMENT_SERIALIZE_POINT_MATCH_TEMPLATE_BANK)) {
+
+      // Boolean value
+      QString stringTemplateBank = attributes.value (DOCUMENT_SERIALIZE_POINT_MATCH_TEMPLATE_BANK).toString();
+
+      setTemplateBank (stringTemplateBank == DOCUMENT_SERIALIZE_BOOL_TRUE);
+    }
 
     // Read until end of this subtree
     while ((reader.tokenType() != QXmlStreamReader::EndElement) ||
@@ -88,6 +117,14 @@ void DocumentModelPointMatch::loadXml(QXmlStreamReader &reader)
   }
 }
 
+int DocumentModelPointMatch::maxCandidates (int imageWidth,
+                                            int imageHeight) const
+{
+  int pointSize = qMax (1, (int) m_maxPointSize);
+
+  return qMax (1, (imageWidth / pointSize) * (imageHeight / pointSize));
+}
+
 double DocumentModelPointMatch::maxPointSize () const
 {
   return m_maxPointSize;
@@ -117,6 +154,8 @@ void DocumentModelPointMatch::printStream(QString indentation,
 
   str << indentation << "minPointSeparation=" << m_minPointSeparation << "\n";
   str << indentation << "maxPointSize=" << m_maxPointSize << "\n";
+  str << indentation << "coarseToFine=" << (m_coarseToFine ? "true" : "false") << "\n";
+  str << indentation << "templateBank=" << (m_templateBank ? "true" : "false") << "\n";
   str << indentation << "colorAccepted=" << colorPaletteToString (m_paletteColorAccepted) << "\n";
   str << indentation << "colorCandidate=" << colorPaletteToString (m_paletteColorCandidate) << "\n";
   str << indentation << "colorRejected=" << colorPaletteToString (m_paletteColorRejected) << "\n";
@@ -128,6 +167,12 @@ void DocumentModelPointMatch::saveXml(QXmlStreamWriter &writer) const
 
   writer.writeStartElement(DOCUMENT_SERIALIZE_POINT_MATCH);
   writer.writeAttribute(DOCUMENT_SERIALIZE_POINT_MATCH_POINT_SIZE, QString::number (m_maxPointSize));
+  writer.writeAttribute(DOCUMENT_SERIALIZE_POINT_MATCH_COARSE_TO_FINE, m_coarseToFine ?
+                          DOCUMENT_SERIALIZE_BOOL_TRUE :
+                          DOCUMENT_SERIALIZE_BOOL_FALSE);
+  writer.writeAttribute(DOCUMENT_SERIALIZE_POINT_MATCH_TEMPLATE_BANK, m_templateBank ?
+                          DOCUMENT_SERIALIZE_BOOL_TRUE :
+                          DOCUMENT_SERIALIZE_BOOL_FALSE);
   writer.writeAttribute(DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_ACCEPTED, QString::number (m_paletteColorAccepted));
   writer.writeAttribute(DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_ACCEPTED_STRING, colorPaletteToString (m_paletteColorAccepted));
   writer.writeAttribute(DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_CANDIDATE, QString::number (m_paletteColorCandidate));
@@ -137,6 +182,11 @@ void DocumentModelPointMatch::saveXml(QXmlStreamWriter &writer) const
   writer.writeEndElement();
 }
 
+void DocumentModelPointMatch::setCoarseToFine(bool coarseToFine)
+{
+  m_coarseToFine = coarseToFine;
+}
+
 void DocumentModelPointMatch::setMaxPointSize(double maxPointSize)
 {
   m_maxPointSize = maxPointSize;
@@ -156,3 +206,13 @@ void DocumentModelPointMatch::setPaletteColorRejected(ColorPalette paletteColorR
 {
   m_paletteColorRejected = paletteColorRejected;
 }
+
+void DocumentModelPointMatch::setTemplateBank(bool templateBank)
+{
+  m_templateBank = templateBank;
+}
+
+bool DocumentModelPointMatch::templateBank() const
+{
+  return m_templateBank;
+}
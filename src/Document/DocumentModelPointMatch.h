@@ -29,8 +29,16 @@ public:
   /// Assignment constructor.
   DocumentModelPointMatch &operator=(const DocumentModelPointMatch &other);
 
+  /// Get method for coarse to fine matching, which correlates a downsampled image before refining at full resolution
+  bool coarseToFine() const;
+
   virtual void loadXml(QXmlStreamReader &reader);
 
+  /// Most point match candidates that are useful in an image of the specified size, which is the number of points
+  /// of max point size that fit side by side. Weaker candidates would overlap better ones
+  int maxCandidates (int imageWidth,
+                     int imageHeight) const;
+
   /// Get method for max point size.
   double maxPointSize() const;
 
@@ -49,6 +57,9 @@ public:
 
   virtual void saveXml(QXmlStreamWriter &writer) const;
 
+  /// Set method for coarse to fine matching.
+  void setCoarseToFine (bool coarseToFine);
+
   /// Set method for max point size.
   void setMaxPointSize (double maxPointSize);
 
@@ -61,10 +72,18 @@ public:
   /// Set method for rejected color.
   void setPaletteColorRejected(ColorPalette paletteColorRejected);
 
+  /// Set method for template bank.
+  void setTemplateBank (bool templateBank);
+
+  /// Get method for template bank, which also matches slightly rotated and rescaled copies of the sample point
+  bool templateBank() const;
+
 private:
 
   double m_minPointSeparation;
   double m_maxPointSize;
+  bool m_coarseToFine;
+  bool m_templateBank;
   ColorPalette m_paletteColorAccepted;
   ColorPalette m_paletteColorCandidate;
   ColorPalette m_paletteColorRejected;
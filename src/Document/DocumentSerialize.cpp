@@ -203,6 +203,8 @@ const QString DOCUMENT_SERIALIZE_POINT_IS_AXIS_POINT ("IsAxisPoint");
 const QString DOCUMENT_SERIALIZE_POINT_IS_X_ONLY ("IsXOnly");
 const QString DOCUMENT_SERIALIZE_POINT_MATCH ("PointMatch");
 const QString DOCUMENT_SERIALIZE_POINT_MATCH_POINT_SIZE ("PointSize");
+const QString DOCUMENT_SERIALIZE_POINT_MATCH_COARSE_TO_FINE ("CoarseToFine");
+const QString DOCUMENT_SERIALIZE_POINT_MATCH_TEMPLATE_BANK ("TemplateBank");
 const QString DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_ACCEPTED ("ColorAccepted");
 const QString DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_ACCEPTED_STRING ("ColorAcceptedString");
 const QString DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_CANDIDATE ("ColorCandidate");
@@ -205,6 +205,8 @@ extern const QString DOCUMENT_SERIALIZE_POINT_IS_AXIS_POINT;
 extern const QString DOCUMENT_SERIALIZE_POINT_IS_X_ONLY;
 extern const QString DOCUMENT_SERIALIZE_POINT_MATCH;
 extern const QString DOCUMENT_SERIALIZE_POINT_MATCH_POINT_SIZE;
+extern const QString DOCUMENT_SERIALIZE_POINT_MATCH_COARSE_TO_FINE;
+extern const QString DOCUMENT_SERIALIZE_POINT_MATCH_TEMPLATE_BANK;
 extern const QString DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_ACCEPTED;
 extern const QString DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_ACCEPTED_STRING;
 extern const QString DOCUMENT_SERIALIZE_POINT_MATCH_COLOR_CANDIDATE;
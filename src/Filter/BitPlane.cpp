@@ -0,0 +1,229 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#include "BitPlane.h"
+#include "ColorFilter.h"
+#include "EngaugeAssert.h"
+#include "mmsubs.h"
+#include <QColor>
+
+const int BITS_PER_WORD = 64;
+
+// Index of the least significant bit that is set. The word must not be zero
+static inline int countTrailingZeros (quint64 word)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll (word);
+#else
+  int count = 0;
+  while ((word & 1) == 0) {
+    word >>= 1;
+    ++count;
+  }
+  return count;
+#endif
+}
+
+BitPlane::BitPlane() :
+  m_width (0),
+  m_height (0),
+  m_wordsPerLine (0)
+{
+}
+
+BitPlane::BitPlane(int width,
+                   int height) :
+  m_width (width),
+  m_height (height),
+  m_wordsPerLine ((width + BITS_PER_WORD - 1) / BITS_PER_WORD),
+  m_words (m_wordsPerLine * height, 0)
+{
+}
+
+BitPlane::BitPlane(const QImage &imageFiltered) :
+  m_width (imageFiltered.width ()),
+  m_height (imageFiltered.height ()),
+  m_wordsPerLine ((imageFiltered.width () + BITS_PER_WORD - 1) / BITS_PER_WORD),
+  m_words (m_wordsPerLine * imageFiltered.height (), 0)
+{
+  // Pixels are read the same way as pixelRGB, which is used by ColorFilter::pixelFilteredIsOn. The common 32 bit case
+  // reads scan lines directly
+  bool is32Bit = (imageFiltered.depth () == 32);
+
+  for (int y = 0; y < m_height; y++) {
+
+    const QRgb *line = (const QRgb *) imageFiltered.constScanLine (y);
+    quint64 *words = m_words.data () + y * m_wordsPerLine;
+
+    for (int x = 0; x < m_width; x++) {
+
+      QRgb rgb = (is32Bit ?
+                  line [x] :
+                  pixelRGB (imageFiltered, x, y));
+
+      if (ColorFilter::rgbFilteredIsOn (rgb)) {
+        words [x / BITS_PER_WORD] |= ((quint64) 1 << (x % BITS_PER_WORD));
+      }
+    }
+  }
+}
+
+const quint64 *BitPlane::constScanLine (int y) const
+{
+  return m_words.constData () + y * m_wordsPerLine;
+}
+
+int BitPlane::height () const
+{
+  return m_height;
+}
+
+bool BitPlane::isNull () const
+{
+  return (m_width == 0) || (m_height == 0);
+}
+
+int BitPlane::nextPixelOn (int xStart,
+                           int y) const
+{
+  if ((xStart >= m_width) || (y < 0) || (y >= m_height)) {
+    return m_width;
+  }
+
+  xStart = qMax (0, xStart);
+
+  const quint64 *words = constScanLine (y);
+  int index = xStart / BITS_PER_WORD;
+
+  // Bits before xStart in the first word are masked off
+  quint64 word = words [index] & (~(quint64) 0 << (xStart % BITS_PER_WORD));
+  while (word == 0) {
+    if (++index >= m_wordsPerLine) {
+      return m_width;
+    }
+    word = words [index];
+  }
+
+  // Padding bits are off, so the result is always inside the row
+  return index * BITS_PER_WORD + countTrailingZeros (word);
+}
+
+quint64 BitPlane::pixels64 (int xStart,
+                            int y) const
+{
+  if ((y < 0) || (y >= m_height) || (xStart >= m_width) || (xStart <= -BITS_PER_WORD)) {
+    return 0;
+  }
+
+  const quint64 *words = constScanLine (y);
+
+  if (xStart < 0) {
+
+    // Only the first word can reach this far left
+    return words [0] << (-xStart);
+  }
+
+  int index = xStart / BITS_PER_WORD;
+  int shift = xStart % BITS_PER_WORD;
+
+  quint64 word = words [index] >> shift;
+  if ((shift != 0) && (index + 1 < m_wordsPerLine)) {
+    word |= words [index + 1] << (BITS_PER_WORD - shift);
+  }
+
+  return word;
+}
+
+quint64 *BitPlane::scanLine (int y)
+{
+  return m_words.data () + y * m_wordsPerLine;
+}
+
+void BitPlane::setPixel (int x,
+                         int y,
+                         bool on)
+{
+  ENGAUGE_ASSERT ((0 <= x) && (x < m_width) && (0 <= y) && (y < m_height));
+
+  quint64 &word = m_words [y * m_wordsPerLine + x / BITS_PER_WORD];
+  quint64 mask = (quint64) 1 << (x % BITS_PER_WORD);
+  if (on) {
+    word |= mask;
+  } else {
+    word &= ~mask;
+  }
+}
+
+QImage BitPlane::toImage () const
+{
+  const QRgb RGB_ON = QColor (Qt::black).rgb ();
+  const QRgb RGB_OFF = QColor (Qt::white).rgb ();
+
+  QImage image (m_width,
+                m_height,
+                QImage::Format_RGB32);
+
+  for (int y = 0; y < m_height; y++) {
+
+    const quint64 *words = constScanLine (y);
+    QRgb *line = (QRgb *) image.scanLine (y);
+
+    for (int x = 0; x < m_width; x++) {
+      line [x] = (((words [x / BITS_PER_WORD] >> (x % BITS_PER_WORD)) & 1) ?
+                  RGB_ON :
+                  RGB_OFF);
+    }
+  }
+
+  return image;
+}
+
+QImage BitPlane::toImageRows (int yStart,
+                              int yStop) const
+{
+  ENGAUGE_ASSERT ((0 <= yStart) && (yStart <= yStop) && (yStop <= m_height));
+
+  // Rows of a one bit per pixel image are the bytes of the words in least significant first order. Color table index
+  // 0 is for off pixels
+  QImage image (m_width,
+                yStop - yStart,
+                QImage::Format_MonoLSB);
+
+  QVector<QRgb> colorTable;
+  colorTable << QColor (Qt::white).rgb ()
+             << QColor (Qt::black).rgb ();
+  image.setColorTable (colorTable);
+
+  int bytesPerLine = (m_width + 7) / 8;
+  for (int y = yStart; y < yStop; y++) {
+
+    const quint64 *words = constScanLine (y);
+    uchar *line = image.scanLine (y - yStart);
+
+    for (int byte = 0; byte < bytesPerLine; byte++) {
+      line [byte] = (uchar) (words [byte / 8] >> (8 * (byte % 8)));
+    }
+  }
+
+  return image;
+}
+
+QPixmap BitPlane::toPixmap () const
+{
+  // One bit per pixel image is a small fraction of the size of toImage
+  return QPixmap::fromImage (toImageRows (0,
+                                          m_height));
+}
+
+int BitPlane::width () const
+{
+  return m_width;
+}
+
+int BitPlane::wordsPerLine () const
+{
+  return m_wordsPerLine;
+}
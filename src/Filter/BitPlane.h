@@ -0,0 +1,98 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef BIT_PLANE_H
+#define BIT_PLANE_H
+
+#include <QImage>
+#include <QPixmap>
+#include <QVector>
+#include <QtGlobal>
+
+/// Filtered image with one bit per pixel, which is on for pixels that survived filtering. This is the output of
+/// the filter stage that is consumed by segment extraction and point matching, and is 32 times smaller than the
+/// equivalent 32 bit image. Rows are stored one after the other, with each row padded to a whole number of 64 bit
+/// words. Pixel x of a row is bit x % 64 of word x / 64, so leftmost pixels are in the least significant bits.
+/// Conversion to an image or pixmap is only needed for display.
+///
+/// Copies are cheap since the words are implicitly shared
+class BitPlane
+{
+public:
+  /// Default constructor gives a null bit plane
+  BitPlane();
+
+  /// Constructor for a bit plane with all pixels off
+  BitPlane(int width,
+           int height);
+
+  /// Constructor that converts a filtered image, with each pixel on if ColorFilter::pixelFilteredIsOn would say so
+  explicit BitPlane(const QImage &imageFiltered);
+
+  /// Height in pixels
+  int height () const;
+
+  /// True if there are no pixels
+  bool isNull () const;
+
+  /// Return the first x at or after xStart where the pixel in row y is on, or width if there is none. This skips
+  /// over entire words of off pixels at a time
+  int nextPixelOn (int xStart,
+                   int y) const;
+
+  /// True if the pixel is on. Pixels outside the bit plane are off
+  inline bool pixel (int x,
+                     int y) const
+  {
+    if ((0 <= x) && (x < m_width) && (0 <= y) && (y < m_height)) {
+      return (m_words [y * m_wordsPerLine + (x >> 6)] >> (x & 63)) & 1;
+    }
+    return false;
+  }
+
+  /// Pixels xStart to xStart+63 of row y, with pixel xStart in the least significant bit. Pixels outside the bit plane
+  /// are off. This lets a row of a small template be compared against the image with one AND
+  quint64 pixels64 (int xStart,
+                    int y) const;
+
+  /// Words of one row. Padding bits at the end of the last word are always off
+  const quint64 *constScanLine (int y) const;
+
+  /// Words of one row, for writing. Padding bits at the end of the last word must be left off. Rows of a bit plane that
+  /// is not shared with any copy can be written by several threads at once
+  quint64 *scanLine (int y);
+
+  /// Turn one pixel on or off. The pixel must be inside the bit plane
+  void setPixel (int x,
+                 int y,
+                 bool on);
+
+  /// Image for display, with black on white pixels
+  QImage toImage () const;
+
+  /// One bit per pixel image of rows yStart through yStop-1, with black on white pixels. This is a small fraction of the
+  /// size of toImage, so it suits sending parts of a bit plane for display
+  QImage toImageRows (int yStart,
+                      int yStop) const;
+
+  /// Pixmap for display, with black on white pixels
+  QPixmap toPixmap () const;
+
+  /// Width in pixels
+  int width () const;
+
+  /// Number of 64 bit words in each row
+  int wordsPerLine () const;
+
+private:
+
+  int m_width;
+  int m_height;
+  int m_wordsPerLine;
+  QVector<quint64> m_words;
+};
+
+#endif // BIT_PLANE_H
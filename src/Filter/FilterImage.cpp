@@ -10,26 +10,174 @@
 #include "FilterImage.h"
 #include "GridRemoval.h"
 #include "Logger.h"
+#include <QCache>
+#include <QDataStream>
 #include <QImage>
+#include <QLineF>
+#include <QList>
 #include <QPixmap>
 #include "Transformation.h"
 
+const int DEFAULT_FILTERED_IMAGE_CACHE_MEGABYTES = 256;
+
+const int BYTES_PER_KILOBYTE = 1024;
+const int KILOBYTES_PER_MEGABYTE = 1024;
+
+// Filtered bit plane and, once it has been displayed, its pixmap
+struct FilteredBits
+{
+  BitPlane bits;
+  QPixmap pixmap;
+};
+
+// Filtered bit planes, shared by all FilterImage instances. The cost of each entry is its size in kilobytes. Filtering
+// is only performed in the gui thread so no locking is needed
+static QCache<QByteArray, FilteredBits> filteredBitsCache (DEFAULT_FILTERED_IMAGE_CACHE_MEGABYTES * KILOBYTES_PER_MEGABYTE);
+
+// Cost of a cache entry in kilobytes
+static int filteredBitsCost (const FilteredBits &filtered)
+{
+  qint64 bytes = (qint64) filtered.bits.wordsPerLine () *
+                 (qint64) filtered.bits.height () *
+                 (qint64) sizeof (quint64);
+  if (!filtered.pixmap.isNull ()) {
+    bytes += (qint64) filtered.pixmap.width () *
+             (qint64) filtered.pixmap.height () *
+             (qint64) filtered.pixmap.depth () / 8;
+  }
+
+  return qMax (1, (int) (bytes / BYTES_PER_KILOBYTE));
+}
+
 FilterImage::FilterImage ()
 {
 }
 
-QPixmap FilterImage::filter (const QImage &imageUnfiltered,
-                             const Transformation &transformation,
-                             const QString &curveSelected,
-                             const DocumentModelColorFilter &modelColorFilter,
-                             const DocumentModelGridRemoval &modelGridRemoval) const
+QByteArray FilterImage::cacheKey (const QPixmap &pixmapUnfiltered,
+                                  const Transformation &transformation,
+                                  const QString &curveSelected,
+                                  const DocumentModelColorFilter &modelColorFilter,
+                                  const DocumentModelGridRemoval &modelGridRemoval) const
+{
+  QByteArray key;
+  QDataStream str (&key, QIODevice::WriteOnly);
+
+  str << pixmapUnfiltered.cacheKey ()
+      << (int) modelColorFilter.colorFilterMode (curveSelected)
+      << modelColorFilter.low (curveSelected)
+      << modelColorFilter.high (curveSelected);
+
+  GridRemoval gridRemoval;
+  QList<QLineF> lines = gridRemoval.linesToRemove (transformation,
+                                                   modelGridRemoval);
+  bool isRemovingGridLines = (modelGridRemoval.removeDefinedGridLines () &&
+                              transformation.transformIsDefined ());
+
+  str << isRemovingGridLines;
+  if (isRemovingGridLines) {
+    str << modelGridRemoval.closeDistance ()
+        << lines;
+  }
+
+  return key;
+}
+
+BitPlane FilterImage::filter (const QPixmap &pixmapUnfiltered,
+                              const Transformation &transformation,
+                              const QString &curveSelected,
+                              const DocumentModelColorFilter &modelColorFilter,
+                              const DocumentModelGridRemoval &modelGridRemoval) const
+{
+  return filterCached (pixmapUnfiltered,
+                       transformation,
+                       curveSelected,
+                       modelColorFilter,
+                       modelGridRemoval,
+                       0);
+}
+
+BitPlane FilterImage::filter (const QPixmap &pixmapUnfiltered,
+                              const Transformation &transformation,
+                              const QString &curveSelected,
+                              const DocumentModelColorFilter &modelColorFilter,
+                              const DocumentModelGridRemoval &modelGridRemoval,
+                              QPixmap &pixmapFiltered) const
+{
+  return filterCached (pixmapUnfiltered,
+                       transformation,
+                       curveSelected,
+                       modelColorFilter,
+                       modelGridRemoval,
+                       &pixmapFiltered);
+}
+
+BitPlane FilterImage::filterCached (const QPixmap &pixmapUnfiltered,
+                                    const Transformation &transformation,
+                                    const QString &curveSelected,
+                                    const DocumentModelColorFilter &modelColorFilter,
+                                    const DocumentModelGridRemoval &modelGridRemoval,
+                                    QPixmap *pixmapFiltered) const
+{
+  QByteArray key = cacheKey (pixmapUnfiltered,
+                             transformation,
+                             curveSelected,
+                             modelColorFilter,
+                             modelGridRemoval);
+
+  FilteredBits filtered;
+  const FilteredBits *filteredCached = filteredBitsCache.object (key);
+  if (filteredCached != 0) {
+
+    LOG4CPP_INFO_S ((*mainCat)) << "FilterImage::filterCached cached";
+
+    filtered = *filteredCached;
+
+  } else {
+
+    filtered.bits = filterUncached (pixmapUnfiltered,
+                                    transformation,
+                                    curveSelected,
+                                    modelColorFilter,
+                                    modelGridRemoval);
+  }
+
+  if ((pixmapFiltered != 0) &&
+      filtered.pixmap.isNull ()) {
+
+    // Converted only once per entry, since switching curves would otherwise convert the whole image every time
+    filtered.pixmap = filtered.bits.toPixmap ();
+    filteredCached = 0;
+  }
+
+  if (filteredCached == 0) {
+
+    // Bit plane and pixmap copies are shallow so keeping them in the cache is cheap until the originals are discarded.
+    // Inserting replaces any entry that had no pixmap
+    filteredBitsCache.insert (key,
+                              new FilteredBits (filtered),
+                              filteredBitsCost (filtered));
+  }
+
+  if (pixmapFiltered != 0) {
+    *pixmapFiltered = filtered.pixmap;
+  }
+
+  return filtered.bits;
+}
+
+BitPlane FilterImage::filterUncached (const QPixmap &pixmapUnfiltered,
+                                      const Transformation &transformation,
+                                      const QString &curveSelected,
+                                      const DocumentModelColorFilter &modelColorFilter,
+                                      const DocumentModelGridRemoval &modelGridRemoval) const
 {
   // Filtered image
   ColorFilter filter;
+  QImage imageUnfiltered = pixmapUnfiltered.toImage ();
   QImage imageFiltered (imageUnfiltered.width (),
                         imageUnfiltered.height (),
                         QImage::Format_RGB32);
-  QRgb rgbBackground = filter.marginColor (&imageUnfiltered);
+  QRgb rgbBackground = filter.marginColor (pixmapUnfiltered);
   filter.filterImage (imageUnfiltered,
                       imageFiltered,
                       modelColorFilter.colorFilterMode(curveSelected),
@@ -37,12 +185,19 @@ QPixmap FilterImage::filter (const QImage &imageUnfiltered,
                       modelColorFilter.high(curveSelected),
                       rgbBackground);
   
+  // Grid removal works on the 32 bit image, and its result is packed into the bit plane
   GridRemoval gridRemoval;
-  QPixmap pixmapFiltered = gridRemoval.remove (transformation,
-                                               modelGridRemoval,
-                                               imageFiltered);
+  QImage imageGridRemoved = gridRemoval.remove (transformation,
+                                                modelGridRemoval,
+                                                imageFiltered);
 
-  return pixmapFiltered;
+  return BitPlane (imageGridRemoved);
 }
 
+void FilterImage::setCacheMegabytes (int megabytes)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "FilterImage::setCacheMegabytes"
+                              << " megabytes=" << megabytes;
 
+  filteredBitsCache.setMaxCost (megabytes * KILOBYTES_PER_MEGABYTE);
+}
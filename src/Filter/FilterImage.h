@@ -7,26 +7,69 @@
 #ifndef FILTER_IMAGE_H
 #define FILTER_IMAGE_H
 
+#include "BitPlane.h"
+#include <QByteArray>
 #include <QPixmap>
 
 class DocumentModelColorFilter;
 class DocumentModelGridRemoval;
-class QImage;
 class Transformation;
 
-/// Filters an image using a combination of color filtering and grid removal
+extern const int DEFAULT_FILTERED_IMAGE_CACHE_MEGABYTES;
+
+/// Filters an image using a combination of color filtering and grid removal. Recently filtered bit planes, and the
+/// pixmaps that display them, are kept in a least recently used cache shared by all instances, so switching back to a
+/// curve with unchanged settings is immediate
 class FilterImage
 {
  public:
   /// Single constructor
   FilterImage();
 
-  /// Filter original unfiltered image into filtered pixmap
-  QPixmap filter (const QImage &imageUnfiltered,
-                  const Transformation &transformation,
-                  const QString &curveSelected,
-                  const DocumentModelColorFilter &modelColorFilter,
-                  const DocumentModelGridRemoval &modelGridRemoval) const;
+  /// Filter original unfiltered pixmap into filtered bit plane
+  BitPlane filter (const QPixmap &pixmapUnfiltered,
+                   const Transformation &transformation,
+                   const QString &curveSelected,
+                   const DocumentModelColorFilter &modelColorFilter,
+                   const DocumentModelGridRemoval &modelGridRemoval) const;
+
+  /// Filter original unfiltered pixmap into filtered bit plane, and also return the filtered pixmap for display. The
+  /// pixmap is cached with the bit plane, so it is only converted the first time it is needed
+  BitPlane filter (const QPixmap &pixmapUnfiltered,
+                   const Transformation &transformation,
+                   const QString &curveSelected,
+                   const DocumentModelColorFilter &modelColorFilter,
+                   const DocumentModelGridRemoval &modelGridRemoval,
+                   QPixmap &pixmapFiltered) const;
+
+  /// Set the memory budget of the filtered bit plane cache. Least recently used bit planes are dropped to fit. Zero disables
+  /// the cache
+  static void setCacheMegabytes (int megabytes);
+
+ private:
+
+  // Key that identifies the filtered bit plane. The transformation only affects the result through the screen
+  // positions of the removed grid lines, so those positions are used in its place
+  QByteArray cacheKey (const QPixmap &pixmapUnfiltered,
+                       const Transformation &transformation,
+                       const QString &curveSelected,
+                       const DocumentModelColorFilter &modelColorFilter,
+                       const DocumentModelGridRemoval &modelGridRemoval) const;
+
+  // Filtering through the cache. The pixmap is only returned if pixmapFiltered is not null
+  BitPlane filterCached (const QPixmap &pixmapUnfiltered,
+                         const Transformation &transformation,
+                         const QString &curveSelected,
+                         const DocumentModelColorFilter &modelColorFilter,
+                         const DocumentModelGridRemoval &modelGridRemoval,
+                         QPixmap *pixmapFiltered) const;
+
+  // Filtering without the cache
+  BitPlane filterUncached (const QPixmap &pixmapUnfiltered,
+                           const Transformation &transformation,
+                           const QString &curveSelected,
+                           const DocumentModelColorFilter &modelColorFilter,
+                           const DocumentModelGridRemoval &modelGridRemoval) const;
 };
 
 #endif // FILTER_IMAGE_H
@@ -103,8 +103,10 @@ void GraphicsScene::hideAllItemsExceptImage()
 {
   LOG4CPP_INFO_S ((*mainCat)) << "GraphicsScene::hideAllItemsExceptImage";
 
-  for (int index = 0; index < QGraphicsScene::items().count(); index++) {
-    QGraphicsItem *item = QGraphicsScene::items().at(index);
+  // The item list is sorted by stacking order on every call, so it is only requested once
+  const QList<QGraphicsItem*> items = QGraphicsScene::items();
+  for (int index = 0; index < items.count(); index++) {
+    QGraphicsItem *item = items.at(index);
 
     if (item->data (DATA_KEY_GRAPHICS_ITEM_TYPE).toInt() == GRAPHICS_ITEM_TYPE_IMAGE) {
 
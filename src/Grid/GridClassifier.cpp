@@ -455,8 +455,10 @@ void GridClassifier::searchStartStepSpace (bool isGnuplot,
   double corr = 0, corrMax = 0;
   bool isFirst = true;
 
-  // We do not explicitly search(=loop) through binStart here, since Correlation::correlateWithShift will take
-  // care of that for us
+  // We do not explicitly search(=loop) through binStart here, since Correlation::correlateWithSpectrum will take
+  // care of that for us. The bins are the same for every step, so they are transformed only once
+  correlation.loadSpectrum (m_numHistogramBins,
+                            bins);
 
   // Step search starts out small, and stops at value that gives count substantially greater than 2. Freakishly small
   // images need to have MIN_STEP_PIXELS overridden so the loop iterates at least once
@@ -470,12 +472,11 @@ void GridClassifier::searchStartStepSpace (bool isGnuplot,
                      PEAK_HALF_WIDTH,
                      false);
 
-    correlation.correlateWithShift (m_numHistogramBins,
-                                    bins,
-                                    picketFence,
-                                    binStart,
-                                    corr,
-                                    correlations);
+    correlation.correlateWithSpectrum (m_numHistogramBins,
+                                       picketFence,
+                                       binStart,
+                                       corr,
+                                       correlations);
     if (isFirst || (corr > corrMax)) {
 
       int binStartMaxNext = binStart + BIN_START_UNSHIFTED + 1; // Compensate for the shift performed inside loadPicketFence
@@ -11,6 +11,7 @@
 #include "Logger.h"
 #include <qdebug.h>
 #include <QImage>
+#include <QLineF>
 #include <qmath.h>
 #include "Transformation.h"
 
@@ -42,23 +43,15 @@ QPointF GridRemoval::clipY (const QPointF &posUnprojected,
                   (1.0 - s) * posUnprojected.y() + s * posOther.y());
 }
 
-QPixmap GridRemoval::remove (const Transformation &transformation,
-                             const DocumentModelGridRemoval &modelGridRemoval,
-                             const QImage &imageBefore)
+QList<QLineF> GridRemoval::linesToRemove (const Transformation &transformation,
+                                          const DocumentModelGridRemoval &modelGridRemoval) const
 {
-  LOG4CPP_INFO_S ((*mainCat)) << "GridRemoval::remove"
-                              << " transformationIsDefined=" << (transformation.transformIsDefined() ? "true" : "false")
-                              << " removeDefinedGridLines=" << (modelGridRemoval.removeDefinedGridLines() ? "true" : "false");
+  QList<QLineF> lines;
 
-  QImage image = imageBefore;
-
-  // Make sure grid line removal is wanted, and possible. Otherwise all processing is skipped
+  // Make sure grid line removal is wanted, and possible. Otherwise there are no lines
   if (modelGridRemoval.removeDefinedGridLines() &&
       transformation.transformIsDefined()) {
 
-    GridHealer gridHealer (imageBefore,
-                           modelGridRemoval);
-
     double yGraphMin = modelGridRemoval.startY();
     double yGraphMax = modelGridRemoval.stopY();
     for (int i = 0; i < modelGridRemoval.countX(); i++) {
@@ -73,10 +66,8 @@ QPixmap GridRemoval::remove (const Transformation &transformation,
                                                          yGraphMax),
                                                 posScreenMax);
 
-      removeLine (posScreenMin,
-                  posScreenMax,
-                  image,
-                  gridHealer);
+      lines << QLineF (posScreenMin,
+                       posScreenMax);
     }
 
     double xGraphMin = modelGridRemoval.startX();
@@ -93,8 +84,37 @@ QPixmap GridRemoval::remove (const Transformation &transformation,
                                                          yGraph),
                                                 posScreenMax);
 
-      removeLine (posScreenMin,
-                  posScreenMax,
+      lines << QLineF (posScreenMin,
+                       posScreenMax);
+    }
+  }
+
+  return lines;
+}
+
+QImage GridRemoval::remove (const Transformation &transformation,
+                             const DocumentModelGridRemoval &modelGridRemoval,
+                             const QImage &imageBefore)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "GridRemoval::remove"
+                              << " transformationIsDefined=" << (transformation.transformIsDefined() ? "true" : "false")
+                              << " removeDefinedGridLines=" << (modelGridRemoval.removeDefinedGridLines() ? "true" : "false");
+
+  QImage image = imageBefore;
+
+  // Make sure grid line removal is wanted, and possible. Otherwise all processing is skipped
+  if (modelGridRemoval.removeDefinedGridLines() &&
+      transformation.transformIsDefined()) {
+
+    GridHealer gridHealer (imageBefore,
+                           modelGridRemoval);
+
+    QList<QLineF> lines = linesToRemove (transformation,
+                                         modelGridRemoval);
+    QList<QLineF>::const_iterator itr;
+    for (itr = lines.begin(); itr != lines.end(); itr++) {
+      removeLine (itr->p1 (),
+                  itr->p2 (),
                   image,
                   gridHealer);
     }
@@ -103,7 +123,7 @@ QPixmap GridRemoval::remove (const Transformation &transformation,
     gridHealer.heal (image);
   }
 
-  return QPixmap::fromImage (image);
+  return image;
 }
 
 void GridRemoval::removeLine (const QPointF &posMin,
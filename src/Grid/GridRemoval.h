@@ -7,12 +7,13 @@
 #ifndef GRID_REMOVAL_H
 #define GRID_REMOVAL_H
 
-#include <QPixmap>
+#include <QLineF>
+#include <QImage>
+#include <QList>
 #include <QPointF>
 
 class DocumentModelGridRemoval;
 class GridHealer;
-class QImage;
 class Transformation;
 
 /// Strategy class for grid removal
@@ -22,8 +23,13 @@ class GridRemoval
   /// Single constructor
   GridRemoval();
 
-  /// Process QImage into QPixmap, removing the grid lines
-  QPixmap remove (const Transformation &transformation,
+  /// Screen coordinates of the defined grid lines that remove would erase, in the order they are erased. The list is
+  /// empty when grid line removal is turned off or the transformation is not defined
+  QList<QLineF> linesToRemove (const Transformation &transformation,
+                               const DocumentModelGridRemoval &modelGridRemoval) const;
+
+  /// Process QImage, removing the grid lines
+  QImage remove (const Transformation &transformation,
                   const DocumentModelGridRemoval &modelGridRemoval,
                   const QImage &imageBefore);
 
@@ -4,16 +4,25 @@
  * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
  ******************************************************************************************************/
 
-#include "ColorFilter.h"
+#include "BitPlane.h"
 #include "DocumentModelPointMatch.h"
 #include "EngaugeAssert.h"
 #include <iostream>
 #include "Logger.h"
 #include "PointMatchAlgorithm.h"
+#include "PointMatchFftw.h"
+#include "PointMatchSession.h"
+#include <algorithm>
+#include <limits>
 #include <QFile>
-#include <QImage>
+#include <QMap>
 #include <qmath.h>
+#include <QPair>
+#include <QSet>
+#include <QtAlgorithms>
 #include <QTextStream>
+#include <QThread>
+#include <QVector>
 
 using namespace std;
 
@@ -23,134 +32,217 @@ const int PIXEL_OFF = -1; // Negative of PIXEL_ON so two off pixels are just as
                           // multiplied. One off pixel and one on pixel give +1 * -1 = -1 which reduces the correlation
 const int PIXEL_ON = 1; // Arbitrary value as long as negative of PIXEL_OFF
 
+// Ignore tiny correlation values near zero by applying this threshold to the log10 of the correlation
+const double SINGLE_PIXEL_CORRELATION = 1.0;
+
+// Coarse to fine matching downsamples by the largest power of two, up to this maximum, that leaves the sample at least
+// the minimum size. Smaller samples match too many places in the downsampled image to be useful
+const int COARSE_FACTOR_MAX = 8;
+const double COARSE_POINT_SIZE_MIN = 5;
+
+// Copies in the template bank besides the sample itself. Scanned plots are rarely more than a few degrees or percent
+// off, and each copy costs one more sample transform and backward transform
+const int TEMPLATE_BANK_COPIES = 4;
+const double TEMPLATE_BANK_ROTATIONS [TEMPLATE_BANK_COPIES] = {5.0, -5.0, 0.0, 0.0}; // Degrees
+const double TEMPLATE_BANK_SCALES [TEMPLATE_BANK_COPIES] = {1.0, 1.0, 0.9, 1.1};
+
+// Progress percentages at the end of each stage of findPoints. The transforms take most of the time
+const int PROGRESS_IMAGE = 40;
+const int PROGRESS_CONVOLUTION = 70;
+const int PROGRESS_LOCAL_MAXIMA = 95;
+const int PROGRESS_DONE = 100;
+
 PointMatchAlgorithm::PointMatchAlgorithm(bool isGnuplot) :
-  m_isGnuplot (isGnuplot)
+  m_isGnuplot (isGnuplot),
+  m_precision (precisionDefault ())
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::PointMatchAlgorithm";
+}
+
+PointMatchAlgorithm::PointMatchAlgorithm(bool isGnuplot,
+                                         Precision precision) :
+  m_isGnuplot (isGnuplot),
+  m_precision (precision)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::PointMatchAlgorithm";
+
+#ifndef ENGAUGE_FFTWF
+  ENGAUGE_ASSERT (precision == PRECISION_DOUBLE); // Single precision is not built in
+#endif
 }
 
-void PointMatchAlgorithm::allocateMemory(double** array,
-                                         fftw_complex** arrayPrime,
+template <class Real>
+void PointMatchAlgorithm::allocateMemory(Real** array,
+                                         typename PointMatchFftw<Real>::Complex** arrayPrime,
                                          int width,
                                          int height)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::allocateMemory";
 
-  *array = new double [width * height];
+  typedef typename PointMatchFftw<Real>::Complex Complex;
+
+  // Arrays come from fftw_malloc, so they have the alignment of the arrays that the shared plans were created with. The
+  // transformed array only needs height / 2 + 1 values per column, since the other half follows by symmetry
+  *array = (Real *) PointMatchFftw<Real>::allocate (sizeof (Real) * width * height);
   ENGAUGE_CHECK_PTR(*array);
 
-  *arrayPrime = new fftw_complex [width * height];
+  *arrayPrime = (Complex *) PointMatchFftw<Real>::allocate (sizeof (Complex) * width * (height / 2 + 1));
   ENGAUGE_CHECK_PTR(*arrayPrime);
 }
 
-void PointMatchAlgorithm::assembleLocalMaxima(double* convolution,
-                                              PointMatchList& listCreated, 
+template <class Real>
+void PointMatchAlgorithm::assembleLocalMaxima(const Real* convolution,
+                                              double convolutionOffset,
+                                              PointMatchList& listCreated,
                                               int width,
-                                              int height)
+                                              int height,
+                                              int maxCandidates,
+                                              bool isFirstCandidateSent,
+                                              int progressStart,
+                                              int progressEnd)
 {
-  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::assembleLocalMaxima";
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::assembleLocalMaxima"
+                              << " maxCandidates=" << maxCandidates;
 
-  // Ignore tiny correlation values near zero by applying this threshold
-  const double SINGLE_PIXEL_CORRELATION = 1.0;
+  // The threshold used to be applied to the log10 of the correlation, which is monotonic, so it is applied to the raw
+  // convolution values instead
+  const Real threshold = (Real) (qPow (10.0, SINGLE_PIXEL_CORRELATION) - convolutionOffset);
 
-  for (int i = 0; i < width; i++) {
-    for (int j = 0; j < height; j++) {
+  // Columns outside the array never suppress a maximum
+  QVector<Real> columnOutside (height, -numeric_limits<Real>::max ());
 
-      // Log is used since values are otherwise too huge to debug (10^10)
-      double convIJ = log10 (convolution[FOLD2DINDEX(i, j, height)]);
+  // Flags for the maxima in one column, computed without branches so the compiler can vectorize the loop
+  QVector<unsigned char> isLocalMax (height, 0);
 
-      // Loop through nearest neighbor points
-      bool isLocalMax = true;
-      for (int iDelta = -1; (iDelta <= 1) && isLocalMax; iDelta++) {
+  // Bounded heap of the best candidates so far. Since PointMatchTriplet::operator< puts better candidates first,
+  // the front of the heap is the worst candidate being kept, which is the one replaced by a better candidate
+  QVector<PointMatchTriplet> heap;
+  heap.reserve (maxCandidates);
 
-        int iNeighbor = i + iDelta;
-        if ((0 <= iNeighbor) && (iNeighbor < width)) {
+  int percentLast = progressStart;
+  for (int i = 0; i < width; i++) {
 
-          for (int jDelta = -1; (jDelta <= 1) && isLocalMax; jDelta++) {
+    // Columns are a small enough unit of work that cancellation is prompt
+    if (isCanceled ()) {
+      return;
+    }
 
-            int jNeighbor = j + jDelta;
-            if ((0 <= jNeighbor) && (jNeighbor < height)) {
+    int percent = progressStart + ((progressEnd - progressStart) * i) / width;
+    if (percent != percentLast) {
+      percentLast = percent;
+      emit signalProgress (percent);
+    }
 
-              // Log is used since values are otherwise too huge to debug (10^10)
-              double convNeighbor = log10 (convolution[FOLD2DINDEX(iNeighbor, jNeighbor, height)]);
-              if (convIJ < convNeighbor) {
+    const Real *left = (i > 0 ? &convolution [FOLD2DINDEX(i - 1, 0, height)] : columnOutside.constData ());
+    const Real *center = &convolution [FOLD2DINDEX(i, 0, height)];
+    const Real *right = (i < width - 1 ? &convolution [FOLD2DINDEX(i + 1, 0, height)] : columnOutside.constData ());
+
+    // A maximum must be larger than the neighbors before it, and at least as large as the neighbors after it. In the
+    // event of a tie, the lower row/column wins (an arbitrary convention)
+    for (int j = 1; j < height - 1; j++) {
+      Real c = center [j];
+      isLocalMax [j] = (c > threshold) &
+                       (c > left [j - 1]) & (c > center [j - 1]) & (c > right [j - 1]) & (c > left [j]) &
+                       (c >= right [j]) & (c >= left [j + 1]) & (c >= center [j + 1]) & (c >= right [j + 1]);
+    }
 
-                isLocalMax = false;
+    // First and last rows have no neighbors on one side
+    isLocalMax [0] = (center [0] > threshold) &
+                     (center [0] > left [0]) &
+                     (center [0] >= right [0]);
+    if (height > 1) {
+      isLocalMax [0] = isLocalMax [0] &
+                       (center [0] >= left [1]) & (center [0] >= center [1]) & (center [0] >= right [1]);
+
+      int j = height - 1;
+      isLocalMax [j] = (center [j] > threshold) &
+                       (center [j] > left [j - 1]) & (center [j] > center [j - 1]) & (center [j] > right [j - 1]) &
+                       (center [j] > left [j]) & (center [j] >= right [j]);
+    }
 
-              } else if (convIJ == convNeighbor) {
+    for (int j = 0; j < height; j++) {
+      if (isLocalMax [j]) {
 
-                // Rare situation. In the event of a tie, the lower row/column wins (an arbitrary convention)
-                if ((jDelta < 0) || (jDelta == 0 && iDelta < 0)) {
+        PointMatchTriplet t (i,
+                             j,
+                             center [j] + convolutionOffset);
 
-                  isLocalMax = false;
-                }
-              }
-            }
-          }
-        }
-      }
+        if (heap.count () < maxCandidates) {
 
-      if (isLocalMax &&
-          (convIJ > SINGLE_PIXEL_CORRELATION) ) {
+          heap.append (t);
+          push_heap (heap.begin (), heap.end ());
 
-        // Save new local maximum
-        PointMatchTriplet t (i,
-                             j,
-                             convolution [FOLD2DINDEX(i, j, height)]);
+        } else if (t < heap.first ()) {
 
-        listCreated.append(t);
+          // Replace the worst candidate being kept
+          pop_heap (heap.begin (), heap.end ());
+          heap.last () = t;
+          push_heap (heap.begin (), heap.end ());
+        }
       }
     }
   }
+
+  // Best to worst. The best candidate can be shown while the others are sorted, so it is moved to the front first
+  if (isFirstCandidateSent && !heap.isEmpty ()) {
+    iter_swap (heap.begin (), min_element (heap.begin (), heap.end ()));
+    emit signalFirstCandidate (heap.first ().point ());
+    sort (heap.begin () + 1, heap.end ());
+  } else {
+    sort_heap (heap.begin (), heap.end ());
+  }
+  listCreated = heap.toList ();
 }
 
-void PointMatchAlgorithm::computeConvolution(fftw_complex* imagePrime,
-                                             fftw_complex* samplePrime,
+int PointMatchAlgorithm::coarseFactor (double maxPointSize) const
+{
+  // Largest power of two that leaves enough pixels in the downsampled sample for the coarse search to be selective
+  int factor = 1;
+  while ((2 * factor <= COARSE_FACTOR_MAX) &&
+         (maxPointSize / (2 * factor) >= COARSE_POINT_SIZE_MIN)) {
+    factor *= 2;
+  }
+
+  return factor;
+}
+
+template <class Real>
+void PointMatchAlgorithm::computeConvolution(const typename PointMatchFftw<Real>::Complex* imagePrime,
+                                             typename PointMatchFftw<Real>::Complex* samplePrime,
                                              int width, int height,
-                                             double** convolution,
+                                             typename PointMatchFftw<Real>::Complex* convolutionPrime,
+                                             Real* convolution,
                                              int sampleXCenter,
                                              int sampleYCenter)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::computeConvolution";
 
-  fftw_complex* convolutionPrime;
-
-  allocateMemory(convolution,
-                 &convolutionPrime,
-                 width,
-                 height);
-
   // Perform in-place conjugation of the sample since equation is F-1 {F(f) * F*(g)}
-  conjugateMatrix(width,
-                  height,
-                  samplePrime);
+  conjugateMatrix<Real>(width,
+                        height,
+                        samplePrime);
 
   // Perform the convolution in transform space
-  multiplyMatrices(width,
-                   height,
-                   imagePrime,
-                   samplePrime,
-                   convolutionPrime);
+  multiplyMatrices<Real>(width,
+                         height,
+                         imagePrime,
+                         samplePrime,
+                         convolutionPrime);
 
   // Backward transform the convolution
-  fftw_plan pConvolution = fftw_plan_dft_c2r_2d(width,
-                                                height,
-                                                convolutionPrime,
-                                                *convolution,
-                                                FFTW_ESTIMATE);
-
-  fftw_execute (pConvolution);
-
-  releasePhaseArray(convolutionPrime);
+  PointMatchFftw<Real>::transformBackward (width,
+                                           height,
+                                           convolutionPrime,
+                                           convolution);
 
   // The convolution pattern is shifted by (sampleXExtent, sampleYExtent). So the downstream code
   // does not have to repeatedly compensate for that shift, we unshift it here
-  double *temp = new double [width * height];
+  Real *temp = new Real [width * height];
   ENGAUGE_CHECK_PTR(temp);
 
   for (int i = 0; i < width; i++) {
     for (int j = 0; j < height; j++) {
-      temp [FOLD2DINDEX(i, j, height)] = (*convolution) [FOLD2DINDEX(i, j, height)];
+      temp [FOLD2DINDEX(i, j, height)] = convolution [FOLD2DINDEX(i, j, height)];
     }
   }
   for (int iFrom = 0; iFrom < width; iFrom++) {
@@ -158,30 +250,317 @@ void PointMatchAlgorithm::computeConvolution(fftw_complex* imagePrime,
       // Gnuplot of convolution file shows x and y shifts should be positive
       int iTo = (iFrom + sampleXCenter) % width;
       int jTo = (jFrom + sampleYCenter) % height;
-      (*convolution) [FOLD2DINDEX(iTo, jTo, height)] = temp [FOLD2DINDEX(iFrom, jFrom, height)];
+      convolution [FOLD2DINDEX(iTo, jTo, height)] = temp [FOLD2DINDEX(iFrom, jFrom, height)];
     }
   }
   delete [] temp;
 }
 
+template <class Real>
 void PointMatchAlgorithm::conjugateMatrix(int width,
                                           int height,
-                                          fftw_complex* matrix)
+                                          typename PointMatchFftw<Real>::Complex* matrix)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::conjugateMatrix";
 
   ENGAUGE_CHECK_PTR(matrix);
 
-  for (int x = 0; x < width; x++) {
-    for (int y = 0; y < height; y++) {
+  // Transformed arrays hold width by (height / 2 + 1) values, and this is element by element
+  int count = width * (height / 2 + 1);
+  for (int index = 0; index < count; index++) {
+    matrix [index] [1] = -1 * matrix [index] [1];
+  }
+}
+
+double PointMatchAlgorithm::convolutionOffset (const BitPlane &bitsProcessed,
+                                               int width,
+                                               int height,
+                                               int countRemoved) const
+{
+  // Count the on pixels that are left after the pixels near existing points are removed. Padding is always off
+  int countOn = -countRemoved;
+  for (int y = 0; y < bitsProcessed.height(); y++) {
+    for (int x = bitsProcessed.nextPixelOn (0, y);
+         x < bitsProcessed.width();
+         x = bitsProcessed.nextPixelOn (x + 1, y)) {
+      ++countOn;
+    }
+  }
+
+  // The part of the unnormalized convolution that comes from the off pixels of the sample is the same for every shift,
+  // namely width*height times PIXEL_OFF times the sum of all image values
+  double scale = (double) width * (double) height;
+  double imageSum = (double) PIXEL_ON * countOn + (double) PIXEL_OFF * (scale - countOn);
+
+  return scale * PIXEL_OFF * imageSum;
+}
+
+QList<PointMatchList> PointMatchAlgorithm::correlate (const QList<QList<PointMatchPixel> > &samplesPointPixels,
+                                                      const BitPlane &bitsProcessed,
+                                                      const QList<QPoint> &pixelsRemoved,
+                                                      int maxCandidates,
+                                                      bool isFirstCandidateSent,
+                                                      PointMatchSession &session)
+{
+#ifdef ENGAUGE_FFTWF
+  if (m_precision == PRECISION_FLOAT) {
+    return correlateWithPrecision<float> (samplesPointPixels,
+                                          bitsProcessed,
+                                          pixelsRemoved,
+                                          maxCandidates,
+                                          isFirstCandidateSent,
+                                          session);
+  }
+#endif
+
+  return correlateWithPrecision<double> (samplesPointPixels,
+                                         bitsProcessed,
+                                         pixelsRemoved,
+                                         maxCandidates,
+                                         isFirstCandidateSent,
+                                         session);
+}
+
+template <class Real>
+QList<PointMatchList> PointMatchAlgorithm::correlateWithPrecision (const QList<QList<PointMatchPixel> > &samplesPointPixels,
+                                                                   const BitPlane &bitsProcessed,
+                                                                   const QList<QPoint> &pixelsRemoved,
+                                                                   int maxCandidates,
+                                                                   bool isFirstCandidateSent,
+                                                                   PointMatchSession &session)
+{
+  ENGAUGE_ASSERT (!isFirstCandidateSent || (samplesPointPixels.count () == 1));
+
+  typedef typename PointMatchFftw<Real>::Complex Complex;
+
+  // Use larger arrays for computations, if necessary, to improve fft performance
+  int width = optimizeLengthForFft(bitsProcessed.width());
+  int height = optimizeLengthForFft(bitsProcessed.height());
+
+  QList<PointMatchList> listsCreated;
+
+  emit signalProgress (0);
+
+  // Planning and running the image transform can take a while for a big image, so a search that was already cancelled
+  // does not start it
+  if (isCanceled ()) {
+    return listsCreated;
+  }
+
+  // The image transform only depends on the filtered image, so it is reused by later requests until that changes.
+  // Every sample in the batch uses the same transform
+  if (!session.isCurrent (bitsProcessed,
+                          width,
+                          height,
+                          m_precision)) {
+
+    Real *image;
+    Complex *imagePrime;
+    loadImage(bitsProcessed,
+              width,
+              height,
+              &image,
+              &imagePrime);
+    releaseImageArray(image);
+
+    session.setImagePrime (bitsProcessed,
+                           width,
+                           height,
+                           m_precision,
+                           imagePrime);
+  }
+
+  emit signalProgress (PROGRESS_IMAGE);
+  if (isCanceled ()) {
+    return listsCreated;
+  }
+
+  // The untransformed (unprimed) and transformed (primed) storage arrays can be huge for big pictures, so the same
+  // arrays are used for every sample in the batch
+  Real *sample, *convolution;
+  Complex *samplePrime, *convolutionPrime;
+  allocateMemory(&sample,
+                 &samplePrime,
+                 width,
+                 height);
+  allocateMemory(&convolution,
+                 &convolutionPrime,
+                 width,
+                 height);
+
+  double offset = convolutionOffset (bitsProcessed,
+                                     width,
+                                     height,
+                                     pixelsRemoved.count ());
+
+  int count = samplesPointPixels.count ();
+  for (int index = 0; (index < count) && !isCanceled (); index++) {
+
+    // Each sample gets an equal share of the progress after the image transform
+    int progressStart = PROGRESS_IMAGE + ((PROGRESS_LOCAL_MAXIMA - PROGRESS_IMAGE) * index) / count;
+    int progressEnd = PROGRESS_IMAGE + ((PROGRESS_LOCAL_MAXIMA - PROGRESS_IMAGE) * (index + 1)) / count;
+    int progressConvolution = progressStart + ((PROGRESS_CONVOLUTION - PROGRESS_IMAGE) * (progressEnd - progressStart)) /
+                              (PROGRESS_LOCAL_MAXIMA - PROGRESS_IMAGE);
+
+    // Compute convolution=F(-1){F(image)*F(*)(sample)}
+    int sampleXCenter, sampleYCenter, sampleXExtent, sampleYExtent;
+    loadSample(samplesPointPixels.at (index),
+               width,
+               height,
+               sample,
+               samplePrime,
+               &sampleXCenter,
+               &sampleYCenter,
+               &sampleXExtent,
+               &sampleYExtent);
+
+    // Cancellation is checked between the sample transform and the inverse transform, which are the slow steps
+    if (isCanceled ()) {
+      break;
+    }
+
+    computeConvolution((const Complex *) session.imagePrime(),
+                       samplePrime,
+                       width,
+                       height,
+                       convolutionPrime,
+                       convolution,
+                       sampleXCenter,
+                       sampleYCenter);
+
+    // Pixels near existing points are removed from the convolution rather than from the transformed image, which
+    // would then have to be transformed again for every request
+    removePixelsFromConvolution(convolution,
+                                width,
+                                height,
+                                pixelsRemoved,
+                                sample,
+                                sampleXExtent,
+                                sampleYExtent,
+                                sampleXCenter,
+                                sampleYCenter);
+
+    emit signalProgress (progressConvolution);
+
+    if (m_isGnuplot && (index == 0)) {
+
+      // Image with the pixels near existing points removed, which is only needed for the dump. Only the first sample
+      // is dumped since the files would be overwritten by the others
+      Real *image = (Real *) PointMatchFftw<Real>::allocate (sizeof (Real) * width * height);
+      ENGAUGE_CHECK_PTR(image);
+      populateImageArray(bitsProcessed,
+                         width,
+                         height,
+                         &image);
+      for (int i = 0; i < pixelsRemoved.count(); i++) {
+        image [FOLD2DINDEX(pixelsRemoved.at (i).x(), pixelsRemoved.at (i).y(), height)] = PIXEL_OFF;
+      }
 
-      int index = FOLD2DINDEX(x, y, height);
-      matrix [index] [1] = -1.0 * matrix [index] [1];
+      dumpToGnuplot(image,
+                    width,
+                    height,
+                    "image.gnuplot");
+      releaseImageArray(image);
+      dumpToGnuplot(sample,
+                    width,
+                    height,
+                    "sample.gnuplot");
+      dumpToGnuplot(convolution,
+                    width,
+                    height,
+                    "convolution.gnuplot");
     }
+
+    // Assemble local maxima, where each is the maxima centered in a region
+    // having a width of sampleWidth and a height of sampleHeight
+    PointMatchList listCreated;
+    assembleLocalMaxima(convolution,
+                        offset,
+                        listCreated,
+                        width,
+                        height,
+                        maxCandidates,
+                        isFirstCandidateSent,
+                        progressConvolution,
+                        progressEnd);
+
+    listsCreated.append (listCreated);
   }
+
+  releaseImageArray(sample);
+  releasePhaseArray<Real>(samplePrime);
+  releaseImageArray(convolution);
+  releasePhaseArray<Real>(convolutionPrime);
+
+  return listsCreated;
 }
 
-void PointMatchAlgorithm::dumpToGnuplot (double* convolution,
+QList<QPoint> PointMatchAlgorithm::downsamplePixelsRemoved (const BitPlane &bitsProcessed,
+                                                            const QList<QPoint> &pixelsRemoved,
+                                                            int factor) const
+{
+  BitPlane bitsRemaining = bitsProcessed;
+  for (int i = 0; i < pixelsRemoved.count(); i++) {
+    bitsRemaining.setPixel (pixelsRemoved.at (i).x(), pixelsRemoved.at (i).y(), false);
+  }
+
+  // A downsampled pixel is removed when none of the pixels in its block are left on
+  QList<QPoint> pixelsRemovedCoarse;
+  QSet<int> blocksChecked;
+  int widthCoarse = (bitsProcessed.width() + factor - 1) / factor;
+  for (int i = 0; i < pixelsRemoved.count(); i++) {
+
+    QPoint block (pixelsRemoved.at (i).x() / factor,
+                  pixelsRemoved.at (i).y() / factor);
+    int key = block.y() * widthCoarse + block.x();
+    if (!blocksChecked.contains (key)) {
+      blocksChecked.insert (key);
+
+      bool isOn = false;
+      for (int y = block.y() * factor; (y < (block.y() + 1) * factor) && !isOn; y++) {
+        for (int x = block.x() * factor; (x < (block.x() + 1) * factor) && !isOn; x++) {
+          isOn = bitsRemaining.pixel (x, y);
+        }
+      }
+
+      if (!isOn) {
+        pixelsRemovedCoarse.append (block);
+      }
+    }
+  }
+
+  return pixelsRemovedCoarse;
+}
+
+QList<PointMatchPixel> PointMatchAlgorithm::downsampleSample (const QList<PointMatchPixel> &samplePointPixels,
+                                                              int factor) const
+{
+  // Same pooling as PointMatchSession::bitsCoarse, with offsets rounded toward negative infinity so blocks on either
+  // side of the center are the same size
+  QMap<QPair<int, int>, bool> blocks;
+  for (int i = 0; i < samplePointPixels.count(); i++) {
+
+    int xOffset = samplePointPixels.at (i).xOffset();
+    int yOffset = samplePointPixels.at (i).yOffset();
+    QPair<int, int> block ((xOffset >= 0 ? xOffset / factor : -((factor - 1 - xOffset) / factor)),
+                           (yOffset >= 0 ? yOffset / factor : -((factor - 1 - yOffset) / factor)));
+
+    blocks [block] = blocks.value (block, false) || samplePointPixels.at (i).pixelIsOn();
+  }
+
+  QList<PointMatchPixel> samplePointPixelsCoarse;
+  QMap<QPair<int, int>, bool>::const_iterator itr;
+  for (itr = blocks.begin(); itr != blocks.end(); itr++) {
+    samplePointPixelsCoarse.append (PointMatchPixel (itr.key().first,
+                                                     itr.key().second,
+                                                     itr.value()));
+  }
+
+  return samplePointPixelsCoarse;
+}
+
+template <class Real>
+void PointMatchAlgorithm::dumpToGnuplot (const Real* convolution,
                                          int width,
                                          int height,
                                          const QString &filename) const
@@ -215,105 +594,262 @@ void PointMatchAlgorithm::dumpToGnuplot (double* convolution,
 }
 
 QList<QPoint> PointMatchAlgorithm::findPoints (const QList<PointMatchPixel> &samplePointPixels,
-                                               const QImage &imageProcessed,
+                                               const BitPlane &bitsProcessed,
                                                const DocumentModelPointMatch &modelPointMatch,
-                                               const Points &pointsExisting)
+                                               const Points &pointsExisting,
+                                               PointMatchSession &session)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::findPoints"
                               << " samplePointPixels=" << samplePointPixels.count();
 
-  // Use larger arrays for computations, if necessary, to improve fft performance
-  int originalWidth = imageProcessed.width();
-  int originalHeight = imageProcessed.height();
-  int width = optimizeLengthForFft(originalWidth);
-  int height = optimizeLengthForFft(originalHeight);
-
-  // The untransformed (unprimed) and transformed (primed) storage arrays can be huge for big pictures, so minimize
-  // the number of allocated arrays at every point in time
-  double *image, *sample, *convolution;
-  fftw_complex *imagePrime, *samplePrime;
-
-  // Compute convolution=F(-1){F(image)*F(*)(sample)}
-  int sampleXCenter, sampleYCenter, sampleXExtent, sampleYExtent;
-  loadImage(imageProcessed,
-            modelPointMatch,
-            pointsExisting,
-            width,
-            height,
-            &image,
-            &imagePrime);
-  loadSample(samplePointPixels,
-             width,
-             height,
-             &sample,
-             &samplePrime,
-             &sampleXCenter,
-             &sampleYCenter,
-             &sampleXExtent,
-             &sampleYExtent);
-  computeConvolution(imagePrime,
-                     samplePrime,
-                     width,
-                     height,
-                     &convolution,
-                     sampleXCenter,
-                     sampleYCenter);
-
-  if (m_isGnuplot) {
-
-    dumpToGnuplot(image,
-                  width,
-                  height,
-                  "image.gnuplot");
-    dumpToGnuplot(sample,
-                  width,
-                  height,
-                  "sample.gnuplot");
-    dumpToGnuplot(convolution,
-                  width,
-                  height,
-                  "convolution.gnuplot");
-  }
-
-  // Assemble local maxima, where each is the maxima centered in a region
-  // having a width of sampleWidth and a height of sampleHeight
-  PointMatchList listCreated;
-  assembleLocalMaxima(convolution,
-                      listCreated,
-                      width,
-                      height);
-  qSort (listCreated);
+  QList<QList<PointMatchPixel> > samplesPointPixels;
+  samplesPointPixels << samplePointPixels;
 
-  // Copy sorted match points to output
-  QList<QPoint> pointsCreated;
-  PointMatchList::iterator itr;
-  for (itr = listCreated.begin(); itr != listCreated.end(); itr++) {
+  return findPointsBatch (samplesPointPixels,
+                          bitsProcessed,
+                          modelPointMatch,
+                          pointsExisting,
+                          session).first ();
+}
 
-    PointMatchTriplet triplet = *itr;
-    pointsCreated.push_back (triplet.point ());
+QList<QList<QPoint> > PointMatchAlgorithm::findPointsBatch (const QList<QList<PointMatchPixel> > &samplesPointPixels,
+                                                            const BitPlane &bitsProcessed,
+                                                            const DocumentModelPointMatch &modelPointMatch,
+                                                            const Points &pointsExisting,
+                                                            PointMatchSession &session)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::findPointsBatch"
+                              << " samples=" << samplesPointPixels.count()
+                              << " precision=" << (m_precision == PRECISION_FLOAT ? "float" : "double")
+                              << " coarseToFine=" << (modelPointMatch.coarseToFine() ? "true" : "false");
+
+  // Padding outside the bit plane is always off, so only the bit plane has to be searched for pixels to remove
+  QList<QPoint> pixelsRemoved = pixelsOnNearExistingPoints(bitsProcessed,
+                                                           bitsProcessed.width(),
+                                                           bitsProcessed.height(),
+                                                           pointsExisting,
+                                                           modelPointMatch.maxPointSize());
+
+  int maxCandidates = modelPointMatch.maxCandidates (bitsProcessed.width(),
+                                                     bitsProcessed.height());
+
+  int factor = (modelPointMatch.coarseToFine() ? coarseFactor (modelPointMatch.maxPointSize()) : 1);
+
+  // With the template bank, each sample is replaced by its rotated and scaled copies. Correlating every copy with the
+  // whole image would cost one transform pair per copy, so only the sample itself is correlated and the copies are
+  // compared at its candidates by findPointsCoarseToFine, even without downsampling
+  QList<QList<PointMatchPixel> > templatesPointPixels;
+  int bankSize = 1;
+  for (int index = 0; index < samplesPointPixels.count(); index++) {
+    if (modelPointMatch.templateBank()) {
+      QList<QList<PointMatchPixel> > bank = templateBank (samplesPointPixels.at (index));
+      bankSize = bank.count();
+      templatesPointPixels += bank;
+    } else {
+      templatesPointPixels << samplesPointPixels.at (index);
+    }
+  }
 
-    // Current order of maxima would be fine if they never overlapped. However, they often overlap so as each
-    // point is pulled off the list, and its pixels are removed from the image, we might consider updating all
-    // succeeding maxima here if those maximax overlap the just-removed maxima. The maxima list is kept
-    // in descending order according to correlation value
+  QList<PointMatchList> listsCreated;
+  if ((factor > 1) || (bankSize > 1)) {
+    listsCreated = findPointsCoarseToFine (templatesPointPixels,
+                                           bitsProcessed,
+                                           pixelsRemoved,
+                                           factor,
+                                           maxCandidates,
+                                           bankSize,
+                                           session);
+  } else {
+    listsCreated = correlate (templatesPointPixels,
+                              bitsProcessed,
+                              pixelsRemoved,
+                              maxCandidates,
+                              samplesPointPixels.count () == 1,
+                              session);
   }
 
-  releaseImageArray(image);
-  releasePhaseArray(imagePrime);
-  releaseImageArray(sample);
-  releasePhaseArray(samplePrime);
-  releaseImageArray(convolution);
+  // Copy sorted match points to output. If cancelled, every sample gets an empty list
+  QList<QList<QPoint> > pointsCreated;
+  for (int index = 0; index < samplesPointPixels.count(); index++) {
+
+    QList<QPoint> points;
+    if (!isCanceled () && (index < listsCreated.count ())) {
+
+      PointMatchList::const_iterator itr;
+      for (itr = listsCreated.at (index).begin(); itr != listsCreated.at (index).end(); itr++) {
+
+        points.push_back ((*itr).point ());
+
+        // Current order of maxima would be fine if they never overlapped. However, they often overlap so as each
+        // point is pulled off the list, and its pixels are removed from the image, we might consider updating all
+        // succeeding maxima here if those maximax overlap the just-removed maxima. The maxima list is kept
+        // in descending order according to correlation value
+      }
+    }
+
+    pointsCreated.append (points);
+  }
+
+  emit signalProgress (PROGRESS_DONE);
 
   return pointsCreated;
 }
 
-void PointMatchAlgorithm::loadImage(const QImage &imageProcessed,
-                                    const DocumentModelPointMatch &modelPointMatch,
-                                    const Points &pointsExisting,
+QList<PointMatchList> PointMatchAlgorithm::findPointsCoarseToFine (const QList<QList<PointMatchPixel> > &samplesPointPixels,
+                                                                   const BitPlane &bitsProcessed,
+                                                                   const QList<QPoint> &pixelsRemoved,
+                                                                   int factor,
+                                                                   int maxCandidates,
+                                                                   int bankSize,
+                                                                   PointMatchSession &session)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::findPointsCoarseToFine"
+                              << " factor=" << factor
+                              << " bankSize=" << bankSize;
+
+  QList<PointMatchList> listsCreated;
+
+  // Candidates come from the first sample of each bank, which is the original sample. The copies of a bank are only
+  // compared at those candidates, so the bank adds local refinement rather than whole image transforms
+  QList<QList<PointMatchPixel> > samplesPointPixelsCandidates;
+  for (int index = 0; index < samplesPointPixels.count(); index += bankSize) {
+    samplesPointPixelsCandidates << samplesPointPixels.at (index);
+  }
+
+  QList<PointMatchList> listsCoarse;
+  if (factor > 1) {
+
+    // Candidates at the reduced resolution. The downsampled image only changes with the filtered image, so it and its
+    // transform are kept in the session like the full resolution transform
+    QList<QList<PointMatchPixel> > samplesPointPixelsCoarse;
+    for (int index = 0; index < samplesPointPixelsCandidates.count(); index++) {
+      samplesPointPixelsCoarse << downsampleSample (samplesPointPixelsCandidates.at (index),
+                                                    factor);
+    }
+
+    listsCoarse = correlate (samplesPointPixelsCoarse,
+                             session.bitsCoarse (bitsProcessed,
+                                                 factor),
+                             downsamplePixelsRemoved (bitsProcessed,
+                                                      pixelsRemoved,
+                                                      factor),
+                             maxCandidates,
+                             false,
+                             session.sessionCoarse ());
+  } else {
+
+    // Candidates at full resolution, from the transform in the session just like a search without the bank
+    listsCoarse = correlate (samplesPointPixelsCandidates,
+                             bitsProcessed,
+                             pixelsRemoved,
+                             maxCandidates,
+                             false,
+                             session);
+  }
+  if (isCanceled ()) {
+    return listsCreated;
+  }
+
+  // Full resolution image with the pixels near existing points removed, for refining
+  BitPlane bitsRemaining = bitsProcessed;
+  for (int i = 0; i < pixelsRemoved.count(); i++) {
+    bitsRemaining.setPixel (pixelsRemoved.at (i).x(), pixelsRemoved.at (i).y(), false);
+  }
+
+  // Refined correlations are computed exactly as the exhaustive search would, including its padding
+  int width = optimizeLengthForFft(bitsProcessed.width());
+  int height = optimizeLengthForFft(bitsProcessed.height());
+  double offset = convolutionOffset (bitsProcessed,
+                                     width,
+                                     height,
+                                     pixelsRemoved.count ());
+
+  for (int index = 0; index < listsCoarse.count(); index++) {
+
+    const PointMatchList &listCoarse = listsCoarse.at (index);
+    QList<QList<QPoint> > samplesOn;
+    for (int copy = 0; copy < bankSize; copy++) {
+      samplesOn << sampleOnOffsets (samplesPointPixels.at (index * bankSize + copy));
+    }
+
+    PointMatchList listRefined;
+    for (int i = 0; i < listCoarse.count(); i++) {
+
+      if (isCanceled ()) {
+        return listsCreated;
+      }
+
+      // Center of the block of full resolution pixels that the coarse pixel came from. The sample and image blocks are
+      // not necessarily aligned, so the full resolution match is within one block of this
+      QPoint posEstimate (listCoarse.at (i).x() * factor + factor / 2,
+                          listCoarse.at (i).y() * factor + factor / 2);
+
+      // Best of the copies in the bank, just like the best convolution at each location in the exhaustive search
+      PointMatchTriplet triplet = refineCandidate (bitsRemaining,
+                                                   width,
+                                                   height,
+                                                   samplesOn.first (),
+                                                   offset,
+                                                   posEstimate,
+                                                   factor);
+      for (int copy = 1; copy < bankSize; copy++) {
+        PointMatchTriplet tripletCopy = refineCandidate (bitsRemaining,
+                                                         width,
+                                                         height,
+                                                         samplesOn.at (copy),
+                                                         offset,
+                                                         posEstimate,
+                                                         factor);
+        if (tripletCopy.correlation () > triplet.correlation ()) {
+          triplet = tripletCopy;
+        }
+      }
+
+      if (triplet.correlation () > qPow (10.0, SINGLE_PIXEL_CORRELATION)) {
+        listRefined.append (triplet);
+      }
+    }
+
+    // Nearby coarse candidates can refine to the same pixel, in which case only one is kept. With a single sample, the
+    // best candidate can be shown while the others are sorted, so it is moved to the front first
+    if ((samplesPointPixelsCandidates.count () == 1) && !listRefined.isEmpty ()) {
+      listRefined.swap (0, min_element (listRefined.begin (), listRefined.end ()) - listRefined.begin ());
+      emit signalFirstCandidate (listRefined.first ().point ());
+      qSort (listRefined.begin () + 1,
+             listRefined.end ());
+    } else {
+      qSort (listRefined.begin (),
+             listRefined.end ());
+    }
+    PointMatchList listCreated;
+    QSet<int> pixelsUsed;
+    for (int i = 0; (i < listRefined.count()) && (listCreated.count() < maxCandidates); i++) {
+
+      int key = FOLD2DINDEX(listRefined.at (i).x(), listRefined.at (i).y(), height);
+      if (!pixelsUsed.contains (key)) {
+        pixelsUsed.insert (key);
+        listCreated.append (listRefined.at (i));
+      }
+    }
+
+    listsCreated.append (listCreated);
+  }
+
+  return listsCreated;
+}
+
+bool PointMatchAlgorithm::isCanceled () const
+{
+  // Only a worker thread, like PointMatchThread, can be interrupted. Calls from the gui thread are never cancelled
+  return QThread::currentThread ()->isInterruptionRequested ();
+}
+
+template <class Real>
+void PointMatchAlgorithm::loadImage(const BitPlane &bitsProcessed,
                                     int width,
                                     int height,
-                                    double** image,
-                                    fftw_complex** imagePrime)
+                                    Real** image,
+                                    typename PointMatchFftw<Real>::Complex** imagePrime)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::loadImage";
 
@@ -322,79 +858,64 @@ void PointMatchAlgorithm::loadImage(const QImage &imageProcessed,
                  width,
                  height);
   
-  populateImageArray(imageProcessed, 
+  populateImageArray(bitsProcessed,
                      width,
                      height,
                      image);
 
-  removePixelsNearExistingPoints(*image,
-                                 width,
-                                 height,
-                                 pointsExisting,
-                                 modelPointMatch.maxPointSize());
-
   // Forward transform the image
-  fftw_plan pImage = fftw_plan_dft_r2c_2d(width,
+  PointMatchFftw<Real>::transformForward (width,
                                           height,
                                           *image,
-                                          *imagePrime,
-                                          FFTW_ESTIMATE);
-  fftw_execute(pImage);
+                                          *imagePrime);
 }
 
+template <class Real>
 void PointMatchAlgorithm::loadSample(const QList<PointMatchPixel> &samplePointPixels,
                                      int width,
                                      int height,
-                                     double** sample,
-                                     fftw_complex** samplePrime,
+                                     Real* sample,
+                                     typename PointMatchFftw<Real>::Complex* samplePrime,
                                      int* sampleXCenter,
                                      int* sampleYCenter,
                                      int* sampleXExtent,
                                      int* sampleYExtent)
 {
-  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::loadImage";
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::loadSample";
 
   // Populate 2d sample array with same size (width x height) as image so fft transforms will have same
   // dimensions, which means their transforms can be multiplied element-to-element
-  allocateMemory(sample,
-                 samplePrime,
-                 width,
-                 height);
-
   populateSampleArray(samplePointPixels,
                       width,
                       height,
-                      sample,
+                      &sample,
                       sampleXCenter,
                       sampleYCenter,
                       sampleXExtent,
                       sampleYExtent);
 
   // Forward transform the sample
-  fftw_plan pSample = fftw_plan_dft_r2c_2d(width,
-                                           height,
-                                           *sample,
-                                           *samplePrime,
-                                           FFTW_ESTIMATE);
-  fftw_execute(pSample);
+  PointMatchFftw<Real>::transformForward (width,
+                                          height,
+                                          sample,
+                                          samplePrime);
 }
 
+template <class Real>
 void PointMatchAlgorithm::multiplyMatrices(int width,
-                                        int height,
-                                        fftw_complex* in1, 
-                                        fftw_complex* in2,
-                                        fftw_complex* out)
+                                           int height,
+                                           const typename PointMatchFftw<Real>::Complex* in1,
+                                           typename PointMatchFftw<Real>::Complex* in2,
+                                           typename PointMatchFftw<Real>::Complex* out)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::multiplyMatrices";
 
-  for (int x = 0; x < width; x++) {
-    for (int y = 0; y < height; y++) {
-
-      int index = FOLD2DINDEX(x, y, height);
+  // Transformed arrays hold width by (height / 2 + 1) values, and this is element by element
+  int count = width * (height / 2 + 1);
+  for (int index = 0; index < count; index++) {
 
-      out [index] [0] = in1 [index] [0] * in2 [index] [0] - in1 [index] [1] * in2 [index] [1];
-      out [index] [1] = in1 [index] [0] * in2 [index] [1] + in1 [index] [1] * in2 [index] [0];
-    }
+    out [index] [0] = in1 [index] [0] * in2 [index] [0] - in1 [index] [1] * in2 [index] [1];
+    out [index] [1] = in1 [index] [0] * in2 [index] [1] + in1 [index] [1] * in2 [index] [0];
   }
 }
 
@@ -442,32 +963,88 @@ int PointMatchAlgorithm::optimizeLengthForFft(int originalLength)
   return closestLength;
 }
 
-void PointMatchAlgorithm::populateImageArray(const QImage &imageProcessed,
+QList<QPoint> PointMatchAlgorithm::pixelsOnNearExistingPoints(const BitPlane &bitsProcessed,
+                                                              int imageWidth,
+                                                              int imageHeight,
+                                                              const Points &pointsExisting,
+                                                              int pointSeparation) const
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::pixelsOnNearExistingPoints";
+
+  // Pixels are turned off in a copy as they are found, so pixels near more than one point are only returned once
+  BitPlane bitsRemaining = bitsProcessed;
+  QList<QPoint> pixels;
+
+  for (int i = 0; i < pointsExisting.size(); i++) {
+
+    int xPoint = pointsExisting.at(i).posScreen().x();
+    int yPoint = pointsExisting.at(i).posScreen().y();
+
+    // Loop through rows of pixels
+    int yMin = yPoint - pointSeparation;
+    if (yMin < 0)
+      yMin = 0;
+    int yMax = yPoint + pointSeparation;
+    if (imageHeight < yMax)
+      yMax = imageHeight;
+
+    for (int y = yMin; y < yMax; y++) {
+
+      // Pythagorean theorem gives range of x values
+      int radical = pointSeparation * pointSeparation - (y - yPoint) * (y - yPoint);
+      if (0 < radical) {
+
+        int xMin = (int) (xPoint - qSqrt((double) radical));
+        if (xMin < 0)
+          xMin = 0;
+        int xMax = xPoint + (xPoint - xMin);
+        if (imageWidth < xMax)
+          xMax = imageWidth;
+
+        // Collect the on pixels in this row of pixels. Pixels in the padding outside the bit plane are always off
+        for (int x = xMin; x < xMax; x++) {
+
+          if (bitsRemaining.pixel (x, y)) {
+            bitsRemaining.setPixel (x, y, false);
+            pixels.append (QPoint (x, y));
+          }
+        }
+      }
+    }
+  }
+
+  return pixels;
+}
+
+template <class Real>
+void PointMatchAlgorithm::populateImageArray(const BitPlane &bitsProcessed,
                                              int width,
                                              int height,
-                                             double** image)
+                                             Real** image)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::populateImageArray";
 
-  // Initialize memory with original image in real component, and imaginary component set to zero
-  ColorFilter colorFilter;
-  for (int x = 0; x < width; x++) {
-    for (int y = 0; y < height; y++) {
-      bool pixelIsOn = colorFilter.pixelFilteredIsOn (imageProcessed,
-                                                      x,
-                                                      y);
+  // Initialize memory with original image in real component, and imaginary component set to zero. Everything starts
+  // off, including the padding outside the bit plane, and then the on pixels are visited one run of words at a time
+  for (int i = 0; i < width * height; i++) {
+    (*image) [i] = PIXEL_OFF;
+  }
+
+  for (int y = 0; y < bitsProcessed.height(); y++) {
+    for (int x = bitsProcessed.nextPixelOn (0, y);
+         x < bitsProcessed.width();
+         x = bitsProcessed.nextPixelOn (x + 1, y)) {
 
-      (*image) [FOLD2DINDEX(x, y, height)]  = (pixelIsOn ?
-                                                 PIXEL_ON :
-                                                 PIXEL_OFF);
+      (*image) [FOLD2DINDEX(x, y, height)] = PIXEL_ON;
     }
   }
 }
 
+template <class Real>
 void PointMatchAlgorithm::populateSampleArray(const QList<PointMatchPixel> &samplePointPixels,
                                               int width,
                                               int height,
-                                              double** sample,
+                                              Real** sample,
                                               int* sampleXCenter,
                                               int* sampleYCenter,
                                               int* sampleXExtent,
@@ -502,11 +1079,14 @@ void PointMatchAlgorithm::populateSampleArray(const QList<PointMatchPixel> &samp
   xMax += border;
   yMax += border;
 
-  // Initialize memory with original image in real component, and imaginary component set to zero
+  // Initialize memory with original image in real component, and imaginary component set to zero. The sample is
+  // stored relative to PIXEL_OFF, so only its on pixels are nonzero. Otherwise the off pixels, which cover the whole
+  // array, would add a huge term that is the same for every shift (see convolutionOffset) and would swamp the
+  // differences between matches in single precision
   int x, y;
   for (x = 0; x < width; x++) {
     for (y = 0; y < height; y++) {
-      (*sample) [FOLD2DINDEX(x, y, height)] = PIXEL_OFF;
+      (*sample) [FOLD2DINDEX(x, y, height)] = 0;
     }
   }
 
@@ -525,7 +1105,7 @@ void PointMatchAlgorithm::populateSampleArray(const QList<PointMatchPixel> &samp
 
     bool pixelIsOn = samplePointPixels.at(i).pixelIsOn();
 
-    (*sample) [FOLD2DINDEX(x, y, height)] = (pixelIsOn ? PIXEL_ON : PIXEL_OFF);
+    (*sample) [FOLD2DINDEX(x, y, height)] = (pixelIsOn ? PIXEL_ON - PIXEL_OFF : 0);
 
     if (pixelIsOn) {
       xSumOn += x;
@@ -544,63 +1124,246 @@ void PointMatchAlgorithm::populateSampleArray(const QList<PointMatchPixel> &samp
   *sampleYExtent = yMax - yMin + 1;
 }
 
-void PointMatchAlgorithm::releaseImageArray(double* array)
+PointMatchAlgorithm::Precision PointMatchAlgorithm::precisionDefault ()
+{
+#ifdef ENGAUGE_FFTWF
+  return PRECISION_FLOAT;
+#else
+  return PRECISION_DOUBLE;
+#endif
+}
+
+PointMatchTriplet PointMatchAlgorithm::refineCandidate (const BitPlane &bitsRemaining,
+                                                        int width,
+                                                        int height,
+                                                        const QList<QPoint> &sampleOn,
+                                                        double convolutionOffset,
+                                                        const QPoint &posEstimate,
+                                                        int radius) const
+{
+  const int BITS_PER_WORD = 64;
+
+  // Same scaling as the unnormalized backward transform, so refined correlations can be compared with exhaustive ones
+  double scale = (double) width * (double) height;
+
+  // Bounds of the on sample pixels
+  int xMin = 0, xMax = 0, yMin = 0, yMax = 0;
+  for (int k = 0; k < sampleOn.count(); k++) {
+    const QPoint &on = sampleOn.at (k);
+    if ((k == 0) || (on.x() < xMin)) xMin = on.x();
+    if ((k == 0) || (on.x() > xMax)) xMax = on.x();
+    if ((k == 0) || (on.y() < yMin)) yMin = on.y();
+    if ((k == 0) || (on.y() > yMax)) yMax = on.y();
+  }
+
+  // Sample as bit masks, so each row of it is compared against the image a word at a time
+  int wordsPerRow = (xMax - xMin) / BITS_PER_WORD + 1;
+  QVector<quint64> masks ((yMax - yMin + 1) * wordsPerRow, 0);
+  for (int k = 0; k < sampleOn.count(); k++) {
+    int bit = sampleOn.at (k).x() - xMin;
+    masks [(sampleOn.at (k).y() - yMin) * wordsPerRow + bit / BITS_PER_WORD] |= ((quint64) 1 << (bit % BITS_PER_WORD));
+  }
+
+  PointMatchTriplet best (posEstimate.x(),
+                          posEstimate.y(),
+                          0);
+  bool first = true;
+
+  // Rows are the outer loop so that, in the event of a tie, the lower row and then the lower column win as in
+  // assembleLocalMaxima
+  for (int j = qMax (0, posEstimate.y() - radius); j <= qMin (bitsRemaining.height() - 1, posEstimate.y() + radius); j++) {
+    for (int i = qMax (0, posEstimate.x() - radius); i <= qMin (bitsRemaining.width() - 1, posEstimate.x() + radius); i++) {
+
+      int countOn = 0;
+      if ((0 <= i + xMin) && (i + xMax < width) && (0 <= j + yMin) && (j + yMax < height)) {
+
+        // Sample does not wrap around, and pixels in the padding are off as in populateImageArray
+        for (int row = 0; row <= yMax - yMin; row++) {
+          for (int word = 0; word < wordsPerRow; word++) {
+            countOn += qPopulationCount (bitsRemaining.pixels64 (i + xMin + word * BITS_PER_WORD, j + yMin + row) &
+                                         masks [row * wordsPerRow + word]);
+          }
+        }
+
+      } else {
+
+        // Circular correlation near the edges, as in computeConvolution
+        for (int k = 0; k < sampleOn.count(); k++) {
+          int x = ((i + sampleOn.at (k).x()) % width + width) % width;
+          int y = ((j + sampleOn.at (k).y()) % height + height) % height;
+          if (bitsRemaining.pixel (x, y)) {
+            ++countOn;
+          }
+        }
+      }
+
+      int sum = PIXEL_ON * countOn + PIXEL_OFF * (sampleOn.count() - countOn);
+      double correlation = scale * (PIXEL_ON - PIXEL_OFF) * sum + convolutionOffset;
+
+      if (first || (correlation > best.correlation ())) {
+        best = PointMatchTriplet (i,
+                                  j,
+                                  correlation);
+        first = false;
+      }
+    }
+  }
+
+  return best;
+}
+
+template <class Real>
+void PointMatchAlgorithm::releaseImageArray(Real* array)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::releaseImageArray";
 
   ENGAUGE_CHECK_PTR(array);
-  delete[] array;
+  PointMatchFftw<Real>::release (array);
 }
 
-void PointMatchAlgorithm::releasePhaseArray(fftw_complex* arrayPrime)
+template <class Real>
+void PointMatchAlgorithm::releasePhaseArray(typename PointMatchFftw<Real>::Complex* arrayPrime)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::releasePhaseArray";
 
   ENGAUGE_CHECK_PTR(arrayPrime);
-  delete[] arrayPrime;
+  PointMatchFftw<Real>::release (arrayPrime);
 }
 
-void PointMatchAlgorithm::removePixelsNearExistingPoints(double* image,
-                                                         int imageWidth,
-                                                         int imageHeight,
-                                                         const Points &pointsExisting,
-                                                         int pointSeparation)
+template <class Real>
+void PointMatchAlgorithm::removePixelsFromConvolution(Real* convolution,
+                                                      int width,
+                                                      int height,
+                                                      const QList<QPoint> &pixelsRemoved,
+                                                      const Real* sample,
+                                                      int sampleXExtent,
+                                                      int sampleYExtent,
+                                                      int sampleXCenter,
+                                                      int sampleYCenter)
 {
-  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::removePixelsNearExistingPoints";
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchAlgorithm::removePixelsFromConvolution"
+                              << " pixelsRemoved=" << pixelsRemoved.count();
+
+  if (pixelsRemoved.count() > 0) {
+
+    // The unnormalized backward transform gives width*height times the circular correlation
+    // sum over pixels p of image(p)*sample(p-shift). Turning a pixel from PIXEL_ON to PIXEL_OFF changes its term for
+    // every shift by (PIXEL_OFF-PIXEL_ON)*sample(p-shift). The sample is zero except at its on pixels, so only the
+    // few shifts that line up a removed pixel with an on sample pixel change. The change to the other shifts is
+    // in convolutionOffset
+    double scale = (double) width * (double) height;
+    double changeOnSample = scale * (PIXEL_OFF - PIXEL_ON) * (PIXEL_ON - PIXEL_OFF);
+
+    QList<QPoint> sampleOn;
+    for (int x = 0; x < qMin (sampleXExtent, width); x++) {
+      for (int y = 0; y < qMin (sampleYExtent, height); y++) {
+        if (sample [FOLD2DINDEX(x, y, height)] != 0) {
+          sampleOn.append (QPoint (x, y));
+        }
+      }
+    }
 
-  for (int i = 0; i < pointsExisting.size(); i++) {
+    for (int i = 0; i < pixelsRemoved.count(); i++) {
+      const QPoint &pixel = pixelsRemoved.at (i);
+      for (int j = 0; j < sampleOn.count(); j++) {
+        const QPoint &on = sampleOn.at (j);
 
-    int xPoint = pointsExisting.at(i).posScreen().x();
-    int yPoint = pointsExisting.at(i).posScreen().y();
+        // Same unshifting as computeConvolution
+        int iTo = ((pixel.x() - on.x() + sampleXCenter) % width + width) % width;
+        int jTo = ((pixel.y() - on.y() + sampleYCenter) % height + height) % height;
+        convolution [FOLD2DINDEX(iTo, jTo, height)] += (Real) changeOnSample;
+      }
+    }
+  }
+}
 
-    // Loop through rows of pixels
-    int yMin = yPoint - pointSeparation;
-    if (yMin < 0)
-      yMin = 0;
-    int yMax = yPoint + pointSeparation;
-    if (imageHeight < yMax)
-      yMax = imageHeight;
+QList<QPoint> PointMatchAlgorithm::sampleOnOffsets (const QList<PointMatchPixel> &samplePointPixels) const
+{
+  // Same bounds and center of mass as populateSampleArray, so offsets line up with the exhaustive convolution
+  const int border = 1;
 
-    for (int y = yMin; y < yMax; y++) {
+  int xMin = 0, yMin = 0;
+  for (int i = 0; i < samplePointPixels.count(); i++) {
+    if ((i == 0) || (samplePointPixels.at (i).xOffset() < xMin)) {
+      xMin = samplePointPixels.at (i).xOffset();
+    }
+    if ((i == 0) || (samplePointPixels.at (i).yOffset() < yMin)) {
+      yMin = samplePointPixels.at (i).yOffset();
+    }
+  }
+  xMin -= border;
+  yMin -= border;
 
-      // Pythagorean theorem gives range of x values
-      int radical = pointSeparation * pointSeparation - (y - yPoint) * (y - yPoint);
-      if (0 < radical) {
+  QList<QPoint> sampleOn;
+  double xSumOn = 0, ySumOn = 0;
+  for (int i = 0; i < samplePointPixels.count(); i++) {
+    if (samplePointPixels.at (i).pixelIsOn()) {
 
-        int xMin = (int) (xPoint - qSqrt((double) radical));
-        if (xMin < 0)
-          xMin = 0;
-        int xMax = xPoint + (xPoint - xMin);
-        if (imageWidth < xMax)
-          xMax = imageWidth;
+      QPoint pos (samplePointPixels.at (i).xOffset() - xMin,
+                  samplePointPixels.at (i).yOffset() - yMin);
+      sampleOn.append (pos);
+      xSumOn += pos.x();
+      ySumOn += pos.y();
+    }
+  }
 
-        // Turn off pixels in this row of pixels
-        for (int x = xMin; x < xMax; x++) {
+  double countOn = qMax (1.0, (double) sampleOn.count());
+  QPoint center ((int) (0.5 + xSumOn / countOn),
+                 (int) (0.5 + ySumOn / countOn));
 
-          image [FOLD2DINDEX(x, y, imageHeight)] = PIXEL_OFF;
+  for (int i = 0; i < sampleOn.count(); i++) {
+    sampleOn [i] -= center;
+  }
 
-        }
-      }
+  return sampleOn;
+}
+
+QList<QList<PointMatchPixel> > PointMatchAlgorithm::templateBank (const QList<PointMatchPixel> &samplePointPixels) const
+{
+  // Copies are rotated and scaled about the center of mass of the on pixels, which populateSampleArray uses as the
+  // center of the point, so every copy is centered on the same location
+  QSet<QPair<int, int> > pixelsOn;
+  double xSumOn = 0, ySumOn = 0;
+  for (int i = 0; i < samplePointPixels.count(); i++) {
+    if (samplePointPixels.at (i).pixelIsOn()) {
+
+      pixelsOn.insert (QPair<int, int> (samplePointPixels.at (i).xOffset(),
+                                        samplePointPixels.at (i).yOffset()));
+      xSumOn += samplePointPixels.at (i).xOffset();
+      ySumOn += samplePointPixels.at (i).yOffset();
+    }
+  }
+
+  double countOn = qMax (1.0, (double) pixelsOn.count());
+  double xCenter = xSumOn / countOn;
+  double yCenter = ySumOn / countOn;
+
+  QList<QList<PointMatchPixel> > bank;
+  bank << samplePointPixels;
+
+  for (int copy = 0; copy < TEMPLATE_BANK_COPIES; copy++) {
+
+    double angle = qDegreesToRadians (TEMPLATE_BANK_ROTATIONS [copy]);
+    double cosAngle = qCos (angle) / TEMPLATE_BANK_SCALES [copy];
+    double sinAngle = qSin (angle) / TEMPLATE_BANK_SCALES [copy];
+
+    // Each copy covers the same pixels as the sample, so the correlations of the copies can be compared. Every pixel
+    // takes the value of the nearest sample pixel after undoing the rotation and scaling
+    QList<PointMatchPixel> samplePointPixelsCopy;
+    for (int i = 0; i < samplePointPixels.count(); i++) {
+
+      double xDelta = samplePointPixels.at (i).xOffset() - xCenter;
+      double yDelta = samplePointPixels.at (i).yOffset() - yCenter;
+      QPair<int, int> pixelFrom (qFloor (0.5 + xCenter + cosAngle * xDelta + sinAngle * yDelta),
+                                 qFloor (0.5 + yCenter - sinAngle * xDelta + cosAngle * yDelta));
+
+      samplePointPixelsCopy.append (PointMatchPixel (samplePointPixels.at (i).xOffset(),
+                                                     samplePointPixels.at (i).yOffset(),
+                                                     pixelsOn.contains (pixelFrom)));
     }
+
+    bank << samplePointPixelsCopy;
   }
+
+  return bank;
 }
@@ -7,127 +7,269 @@
 #ifndef POINT_MATCH_ALGORITHM_H
 #define POINT_MATCH_ALGORITHM_H
 
-#include "fftw3.h"
 #include "Point.h"
 #include "PointMatchPixel.h"
 #include "PointMatchTriplet.h"
 #include "Points.h"
 #include <QList>
+#include <QObject>
 #include <QPoint>
 
 class DocumentModelPointMatch;
-class QImage;
+class BitPlane;
+class PointMatchSession;
 class QPixmap;
 
+template <class Real>
+struct PointMatchFftw;
+
 typedef QList<PointMatchTriplet> PointMatchList;
 
 /// Algorithm returning a list of points that match the specified point. This returns a list of matches, from best to worst.
-/// This is executed in a separate QThread so the gui thread is not blocked
-class PointMatchAlgorithm
+/// This is executed in a separate QThread (see PointMatchThread) so the gui thread is not blocked. Interrupting that
+/// thread with QThread::requestInterruption cancels the search, in which case no matches are returned
+class PointMatchAlgorithm : public QObject
 {
+  Q_OBJECT;
+
  public:
-  /// Single constructor
+  /// Precision of the transforms and of the arrays they work on
+  enum Precision {
+    PRECISION_DOUBLE,
+    PRECISION_FLOAT
+  };
+
+  /// Default constructor uses precisionDefault
   PointMatchAlgorithm(bool isGnuplot);
 
-  /// Find points that match the specified sample point pixels. They are sorted by best-to-worst match
+  /// Constructor for a specific precision, which must be built in. Used for testing
+  PointMatchAlgorithm(bool isGnuplot,
+                      Precision precision);
+
+  /// Find points that match the specified sample point pixels. They are sorted by best-to-worst match. The image
+  /// transform in the session is reused if it is still current, and replaced otherwise. If coarse to fine matching
+  /// is selected, a downsampled image is searched first and each candidate is then refined at full resolution. If the
+  /// template bank is selected, each candidate of the sample gets the best nearby match of the sample and its rotated
+  /// and scaled copies
   QList<QPoint> findPoints (const QList<PointMatchPixel> &samplePointPixels,
-                            const QImage &imageProcessed,
+                            const BitPlane &bitsProcessed,
                             const DocumentModelPointMatch &modelPointMatch,
-                            const Points &pointsExisting);
+                            const Points &pointsExisting,
+                            PointMatchSession &session);
+
+  /// Find points that match each of the specified samples, such as the point symbols of several curves. This returns
+  /// one list per sample, in the same order as the samples, with each list sorted by best-to-worst match. The image
+  /// is transformed at most once, and the arrays used for the sample transforms and convolutions are shared by all
+  /// samples, so this is faster than calling findPoints for each sample
+  QList<QList<QPoint> > findPointsBatch (const QList<QList<PointMatchPixel> > &samplesPointPixels,
+                                         const BitPlane &bitsProcessed,
+                                         const DocumentModelPointMatch &modelPointMatch,
+                                         const Points &pointsExisting,
+                                         PointMatchSession &session);
+
+  /// Single precision when built with CONFIG+=fftwf, since it halves the memory and its transforms use all cores.
+  /// Otherwise double precision, which is the only one built in
+  static Precision precisionDefault ();
+
+ signals:
+  /// Send the best match as soon as it is known, before the other matches are sorted. This is the first point
+  /// returned by findPoints. It is not sent by findPointsBatch when there is more than one sample
+  void signalFirstCandidate (QPoint posScreen);
+
+  /// Send the progress of findPoints as a percentage
+  void signalProgress (int percent);
 
  private:
 
   // Allocate memory for an image array and phase array pair before calculations
-  void allocateMemory(double** array,
-                      fftw_complex** arrayPrime,
+  template <class Real>
+  void allocateMemory(Real** array,
+                      typename PointMatchFftw<Real>::Complex** arrayPrime,
                       int width,
                       int height);
 
-  // Find each local maxima that is the largest value in a region that is:
-  //   1. as big as the the sample
-  //   2. centered about that local maxima
-  void assembleLocalMaxima(double* convolution,
+  // Find each local maxima that is larger than its eight neighbors, in one pass over the convolution. Only the best
+  // maxCandidates are kept, sorted from best to worst. The offset is added to the correlation of each maxima.
+  // Progress is sent from progressStart to progressEnd. If isFirstCandidateSent, the best maxima is sent by
+  // signalFirstCandidate before the others are sorted
+  template <class Real>
+  void assembleLocalMaxima(const Real* convolution,
+                           double convolutionOffset,
                            PointMatchList& listCreated,
                            int width,
-                           int height);
+                           int height,
+                           int maxCandidates,
+                           bool isFirstCandidateSent,
+                           int progressStart,
+                           int progressEnd);
 
-  // Compute convolution in image space from phase space image and sample arrays
-  void computeConvolution(fftw_complex* imagePrime,
-                          fftw_complex* samplePrime,
+  // Downsampling factor for coarse to fine matching, or one if points of this size are too small to downsample
+  int coarseFactor (double maxPointSize) const;
+
+  // Compute convolution in image space from phase space image and sample arrays. The convolution arrays are
+  // allocated by the caller, and convolutionPrime is only used as working space
+  template <class Real>
+  void computeConvolution(const typename PointMatchFftw<Real>::Complex* imagePrime,
+                          typename PointMatchFftw<Real>::Complex* samplePrime,
                           int width,
                           int height,
-                          double** convolution,
+                          typename PointMatchFftw<Real>::Complex* convolutionPrime,
+                          Real* convolution,
                           int sampleXCenter,
                           int sampleYCenter);
 
   // In-place replacement of matrix by its complex conjugate
+  template <class Real>
   void conjugateMatrix(int width,
                        int height,
-                       fftw_complex* matrix);
+                       typename PointMatchFftw<Real>::Complex* matrix);
+
+  // Part of the convolution that is the same for every shift, and is therefore left out of the computed convolution
+  double convolutionOffset (const BitPlane &bitsProcessed,
+                            int width,
+                            int height,
+                            int countRemoved) const;
+
+  // Correlate each sample with the image, with the specified pixels turned off, using the image transform in the
+  // session. For each sample, the best maxCandidates local maxima are returned from best to worst. If cancelled, fewer
+  // lists than samples may be returned. If isFirstCandidateSent, which is only for a single full resolution sample,
+  // its best maxima is sent by signalFirstCandidate as soon as it is found
+  QList<PointMatchList> correlate (const QList<QList<PointMatchPixel> > &samplesPointPixels,
+                                   const BitPlane &bitsProcessed,
+                                   const QList<QPoint> &pixelsRemoved,
+                                   int maxCandidates,
+                                   bool isFirstCandidateSent,
+                                   PointMatchSession &session);
+
+  // Body of correlate for one precision
+  template <class Real>
+  QList<PointMatchList> correlateWithPrecision (const QList<QList<PointMatchPixel> > &samplesPointPixels,
+                                                const BitPlane &bitsProcessed,
+                                                const QList<QPoint> &pixelsRemoved,
+                                                int maxCandidates,
+                                                bool isFirstCandidateSent,
+                                                PointMatchSession &session);
+
+  // Pixels of the downsampled image that are turned off by removing the specified full resolution pixels
+  QList<QPoint> downsamplePixelsRemoved (const BitPlane &bitsProcessed,
+                                         const QList<QPoint> &pixelsRemoved,
+                                         int factor) const;
+
+  // Downsample the sample point pixels, with each one on if any pixel in its block is on
+  QList<PointMatchPixel> downsampleSample (const QList<PointMatchPixel> &samplePointPixels,
+                                           int factor) const;
 
   // Dump to file for 3d plotting by gnuplot
-  void dumpToGnuplot (double* convolution,
+  template <class Real>
+  void dumpToGnuplot (const Real* convolution,
                       int width,
                       int height,
                       const QString &filename) const;
 
-  // Load image and imagePrime arrays
-  void loadImage(const QImage &imageProcessed,
-                 const DocumentModelPointMatch &modelPointMatch,
-                 const Points &pointsExisting,
+  // Correlate downsampled copies of the image and samples, and then refine each candidate at full resolution. With a
+  // factor of one the candidates come from the full resolution image instead. Consecutive groups of bankSize samples
+  // are copies from templateBank. Only the first sample of each group is correlated, and each group gives one list
+  // with the best of its copies at each refined candidate. If there is only one group, its best refined candidate is
+  // sent by signalFirstCandidate before the others are sorted
+  QList<PointMatchList> findPointsCoarseToFine (const QList<QList<PointMatchPixel> > &samplesPointPixels,
+                                                const BitPlane &bitsProcessed,
+                                                const QList<QPoint> &pixelsRemoved,
+                                                int factor,
+                                                int maxCandidates,
+                                                int bankSize,
+                                                PointMatchSession &session);
+
+  // True if the thread running this algorithm has been asked to stop
+  bool isCanceled () const;
+
+  // Load image and imagePrime arrays. Pixels near existing points are not removed here, so the transform can be reused
+  template <class Real>
+  void loadImage(const BitPlane &bitsProcessed,
                  int width,
                  int height,
-                 double** image,
-                 fftw_complex** imagePrime);
+                 Real** image,
+                 typename PointMatchFftw<Real>::Complex** imagePrime);
 
-  // Load sample and samplePrime arrays, and compute center location and extent
+  // Load the already allocated sample and samplePrime arrays, and compute center location and extent
+  template <class Real>
   void loadSample(const QList<PointMatchPixel> &samplePointPixels,
                   int width,
                   int height,
-                  double** sample,
-                  fftw_complex** samplePrime,
+                  Real* sample,
+                  typename PointMatchFftw<Real>::Complex* samplePrime,
                   int* sampleXCenter,
                   int* sampleYCenter,
                   int* sampleXExtent,
                   int* sampleYExtent);
 
   // Multiply corresponding elements of two matrices into a third matrix
+  template <class Real>
   void multiplyMatrices(int width,
                         int height,
-                        fftw_complex* in1,
-                        fftw_complex* in2,
-                        fftw_complex* out);
-    
+                        const typename PointMatchFftw<Real>::Complex* in1,
+                        typename PointMatchFftw<Real>::Complex* in2,
+                        typename PointMatchFftw<Real>::Complex* out);
+
   // Given an original array length, this method returns an array length that includes enough padding so that the
   // array length equals 2^a * 3^b * 5^c * 7^d, which optimizes the fft performance. Typical memory penalties are
   // less than 6% to get a cpu performance increase of 0% to roughly 100% or 200%
   int optimizeLengthForFft(int originalLength);
 
+  // Prevent duplication of existing points. This function returns the on pixels near the existing points, each once
+  QList<QPoint> pixelsOnNearExistingPoints(const BitPlane &bitsProcessed,
+                                           int imageWidth,
+                                           int imageHeight,
+                                           const Points &pointsExisting,
+                                           int pointSeparation) const;
+
   // Populate image array with processed image
-  void populateImageArray(const QImage &imageProcessed,
+  template <class Real>
+  void populateImageArray(const BitPlane &bitsProcessed,
                           int width, int height,
-                          double** image);
+                          Real** image);
 
   // Populate sample array with sample image
+  template <class Real>
   void populateSampleArray(const QList<PointMatchPixel> &samplePointPixels,
                            int width,
                            int height,
-                           double** sample,
+                           Real** sample,
                            int* sampleXCenter,
                            int* sampleYCenter,
                            int* sampleXExtent,
                            int* sampleYExtent);
 
+  // Best match within radius of the estimated position, using the same correlation as the exhaustive search with the
+  // image padded to width by height. Cost is proportional to the window area times the number of on sample pixels
+  PointMatchTriplet refineCandidate (const BitPlane &bitsRemaining,
+                                     int width,
+                                     int height,
+                                     const QList<QPoint> &sampleOn,
+                                     double convolutionOffset,
+                                     const QPoint &posEstimate,
+                                     int radius) const;
+
   // Release memory for one array after finishing calculations
-  void releaseImageArray(double* array);
-  void releasePhaseArray(fftw_complex* array);
+  template <class Real>
+  void releaseImageArray(Real* array);
+  template <class Real>
+  void releasePhaseArray(typename PointMatchFftw<Real>::Complex* array);
 
-  // Prevent duplication of existing points. this function returns the number of pixels removed
-  void removePixelsNearExistingPoints(double* image,
-                                      int imageWidth,
-                                      int imageHeight,
-                                      const Points &pointsExisting,
-                                      int pointSeparation);
+  // Correct the convolution of the full image so it equals the convolution of the image with the specified pixels
+  // turned off. Cost is proportional to the number of removed pixels times the number of on sample pixels
+  template <class Real>
+  void removePixelsFromConvolution(Real* convolution,
+                                   int width,
+                                   int height,
+                                   const QList<QPoint> &pixelsRemoved,
+                                   const Real* sample,
+                                   int sampleXExtent,
+                                   int sampleYExtent,
+                                   int sampleXCenter,
+                                   int sampleYCenter);
+
+  // Offsets of the on sample pixels from the sample center, as placed by populateSampleArray
+  QList<QPoint> sampleOnOffsets (const QList<PointMatchPixel> &samplePointPixels) const;
 
   // Correlate the sample point with the image, returning points in list that is sorted by correlation
   void scanImage(bool* sampleMaskArray,
@@ -141,7 +283,12 @@ class PointMatchAlgorithm
                  int imageHeight,
                  PointMatchList* pointsCreated);
 
+  // Sample followed by its slightly rotated and rescaled copies, so points in scans that are a little rotated or
+  // stretched still match well
+  QList<QList<PointMatchPixel> > templateBank (const QList<PointMatchPixel> &samplePointPixels) const;
+
   bool m_isGnuplot;
+  Precision m_precision;
 };
 
 #endif // POINT_MATCH_ALGORITHM_H
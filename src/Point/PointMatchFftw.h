@@ -0,0 +1,112 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef POINT_MATCH_FFTW_H
+#define POINT_MATCH_FFTW_H
+
+#include <cstddef>
+#include "FftPlanCache.h"
+#include "fftw3.h"
+
+/// Fftw types and functions for one precision, so PointMatchAlgorithm can be written once for every precision. Only
+/// the specializations below exist, with Real being the type of the untransformed arrays
+template <class Real>
+struct PointMatchFftw;
+
+/// Double precision, which is always available
+template <>
+struct PointMatchFftw<double>
+{
+  /// Type of the transformed arrays
+  typedef fftw_complex Complex;
+
+  /// Allocate an array with the same alignment as the arrays that the shared plans were created with
+  static void *allocate (size_t bytes)
+  {
+    return fftw_malloc (bytes);
+  }
+
+  /// Release an array from allocate
+  static void release (void *array)
+  {
+    fftw_free (array);
+  }
+
+  /// Transform a width by (height / 2 + 1) complex array into a width by height real array. The input is destroyed
+  static void transformBackward (int width,
+                                 int height,
+                                 Complex *in,
+                                 double *out)
+  {
+    fftw_execute_dft_c2r (FftPlanCache::planDftC2r2d (width,
+                                                      height),
+                          in,
+                          out);
+  }
+
+  /// Transform a width by height real array into a width by (height / 2 + 1) complex array
+  static void transformForward (int width,
+                                int height,
+                                double *in,
+                                Complex *out)
+  {
+    fftw_execute_dft_r2c (FftPlanCache::planDftR2c2d (width,
+                                                      height),
+                          in,
+                          out);
+  }
+};
+
+#ifdef ENGAUGE_FFTWF
+
+/// Single precision, which is available when built with CONFIG+=fftwf. The arrays take half the memory, and the plans
+/// use all cores
+template <>
+struct PointMatchFftw<float>
+{
+  /// Type of the transformed arrays
+  typedef fftwf_complex Complex;
+
+  /// Allocate an array with the same alignment as the arrays that the shared plans were created with
+  static void *allocate (size_t bytes)
+  {
+    return fftwf_malloc (bytes);
+  }
+
+  /// Release an array from allocate
+  static void release (void *array)
+  {
+    fftwf_free (array);
+  }
+
+  /// Transform a width by (height / 2 + 1) complex array into a width by height real array. The input is destroyed
+  static void transformBackward (int width,
+                                 int height,
+                                 Complex *in,
+                                 float *out)
+  {
+    fftwf_execute_dft_c2r (FftPlanCache::planDftfC2r2d (width,
+                                                        height),
+                           in,
+                           out);
+  }
+
+  /// Transform a width by height real array into a width by (height / 2 + 1) complex array
+  static void transformForward (int width,
+                                int height,
+                                float *in,
+                                Complex *out)
+  {
+    fftwf_execute_dft_r2c (FftPlanCache::planDftfR2c2d (width,
+                                                        height),
+                           in,
+                           out);
+  }
+};
+
+#endif // ENGAUGE_FFTWF
+
+#endif // POINT_MATCH_FFTW_H
@@ -0,0 +1,141 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#include "EngaugeAssert.h"
+#include "Logger.h"
+#include "PointMatchFftw.h"
+#include "PointMatchSession.h"
+
+PointMatchSession::PointMatchSession() :
+  m_width (0),
+  m_height (0),
+  m_precision (PointMatchAlgorithm::PRECISION_DOUBLE),
+  m_imagePrime (0),
+  m_factorCoarse (0),
+  m_sessionCoarse (0)
+{
+}
+
+PointMatchSession::~PointMatchSession()
+{
+  clear ();
+  delete m_sessionCoarse;
+}
+
+BitPlane PointMatchSession::bitsCoarse (const BitPlane &bitsProcessed,
+                                        int factor)
+{
+  // Same identity test as isCurrent
+  bool isCurrent = !m_bitsCoarse.isNull () &&
+                   (factor == m_factorCoarse) &&
+                   (bitsProcessed.width () == m_bitsCoarseSource.width ()) &&
+                   (bitsProcessed.height () == m_bitsCoarseSource.height ()) &&
+                   (bitsProcessed.constScanLine (0) == m_bitsCoarseSource.constScanLine (0));
+
+  if (!isCurrent) {
+
+    LOG4CPP_INFO_S ((*mainCat)) << "PointMatchSession::bitsCoarse"
+                                << " factor=" << factor;
+
+    BitPlane bits ((bitsProcessed.width () + factor - 1) / factor,
+                   (bitsProcessed.height () + factor - 1) / factor);
+
+    for (int y = 0; y < bitsProcessed.height (); y++) {
+      for (int x = bitsProcessed.nextPixelOn (0, y);
+           x < bitsProcessed.width ();
+           x = bitsProcessed.nextPixelOn (x + 1, y)) {
+
+        bits.setPixel (x / factor, y / factor, true);
+      }
+    }
+
+    m_bitsCoarseSource = bitsProcessed;
+    m_factorCoarse = factor;
+    m_bitsCoarse = bits;
+  }
+
+  return m_bitsCoarse;
+}
+
+void PointMatchSession::clear ()
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchSession::clear";
+
+  if (m_imagePrime != 0) {
+#ifdef ENGAUGE_FFTWF
+    if (m_precision == PointMatchAlgorithm::PRECISION_FLOAT) {
+      PointMatchFftw<float>::release (m_imagePrime);
+    } else {
+      PointMatchFftw<double>::release (m_imagePrime);
+    }
+#else
+    PointMatchFftw<double>::release (m_imagePrime);
+#endif
+    m_imagePrime = 0;
+  }
+
+  m_bitsProcessed = BitPlane ();
+  m_width = 0;
+  m_height = 0;
+
+  m_bitsCoarseSource = BitPlane ();
+  m_factorCoarse = 0;
+  m_bitsCoarse = BitPlane ();
+  if (m_sessionCoarse != 0) {
+    m_sessionCoarse->clear ();
+  }
+}
+
+const void *PointMatchSession::imagePrime () const
+{
+  ENGAUGE_CHECK_PTR (m_imagePrime);
+
+  return m_imagePrime;
+}
+
+bool PointMatchSession::isCurrent (const BitPlane &bitsProcessed,
+                                   int width,
+                                   int height,
+                                   PointMatchAlgorithm::Precision precision) const
+{
+  // Copies of a bit plane share the same words, while a newly filtered image always gets new words
+  return (m_imagePrime != 0) &&
+         !bitsProcessed.isNull () &&
+         (bitsProcessed.width () == m_bitsProcessed.width ()) &&
+         (bitsProcessed.height () == m_bitsProcessed.height ()) &&
+         (bitsProcessed.constScanLine (0) == m_bitsProcessed.constScanLine (0)) &&
+         (width == m_width) &&
+         (height == m_height) &&
+         (precision == m_precision);
+}
+
+PointMatchSession &PointMatchSession::sessionCoarse ()
+{
+  if (m_sessionCoarse == 0) {
+    m_sessionCoarse = new PointMatchSession;
+  }
+
+  return *m_sessionCoarse;
+}
+
+void PointMatchSession::setImagePrime (const BitPlane &bitsProcessed,
+                                       int width,
+                                       int height,
+                                       PointMatchAlgorithm::Precision precision,
+                                       void *imagePrime)
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchSession::setImagePrime"
+                              << " width=" << width
+                              << " height=" << height;
+
+  clear ();
+
+  m_bitsProcessed = bitsProcessed;
+  m_width = width;
+  m_height = height;
+  m_precision = precision;
+  m_imagePrime = imagePrime;
+}
@@ -0,0 +1,75 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef POINT_MATCH_SESSION_H
+#define POINT_MATCH_SESSION_H
+
+#include "BitPlane.h"
+#include "PointMatchAlgorithm.h"
+#include <QSharedPointer>
+
+/// Forward transform of the filtered image, kept by DigitizeStatePointMatch between point match requests so
+/// PointMatchAlgorithm only has to transform the image once per filtered image. The transform is of the image
+/// before the pixels near existing points are removed, since those points change with every request. Any change
+/// to the filtered image, like new color filter settings or a new document, gives a new bit plane which makes the
+/// transform out of date, as does a change of precision. Coarse to fine matching also keeps its downsampled image,
+/// and the transform of that image in a second session
+class PointMatchSession
+{
+public:
+  /// Single constructor, for an empty session
+  PointMatchSession();
+  ~PointMatchSession();
+
+  /// Downsampled copy of the specified bit plane, with each pixel on if any pixel in its factor by factor block is on.
+  /// The copy is kept until the bit plane or factor changes, so its transform in sessionCoarse stays current
+  BitPlane bitsCoarse (const BitPlane &bitsProcessed,
+                       int factor);
+
+  /// Release the transforms, to free memory when point matching is no longer active
+  void clear ();
+
+  /// Transform of the image, padded to width by height. This is an fftw_complex or fftwf_complex array according to
+  /// the precision. This must only be called when isCurrent is true
+  const void *imagePrime () const;
+
+  /// True if the transform is for the specified bit plane, padded to width by height, in the specified precision. Bit
+  /// planes are compared by identity, which is safe since the session keeps its bit plane, and therefore its words, alive
+  bool isCurrent (const BitPlane &bitsProcessed,
+                  int width,
+                  int height,
+                  PointMatchAlgorithm::Precision precision) const;
+
+  /// Session for the downsampled image from bitsCoarse
+  PointMatchSession &sessionCoarse ();
+
+  /// Save the transform of the specified bit plane, padded to width by height. The session takes ownership of
+  /// imagePrime, which must have been allocated by fftw_malloc or fftwf_malloc according to the precision
+  void setImagePrime (const BitPlane &bitsProcessed,
+                      int width,
+                      int height,
+                      PointMatchAlgorithm::Precision precision,
+                      void *imagePrime);
+
+private:
+  PointMatchSession(const PointMatchSession &other);
+  PointMatchSession &operator=(const PointMatchSession &other);
+
+  BitPlane m_bitsProcessed;
+  int m_width;
+  int m_height;
+  PointMatchAlgorithm::Precision m_precision;
+  void *m_imagePrime;
+
+  BitPlane m_bitsCoarseSource;
+  int m_factorCoarse;
+  BitPlane m_bitsCoarse;
+  PointMatchSession *m_sessionCoarse;
+};
+
+typedef QSharedPointer<PointMatchSession> PointMatchSessionPtr;
+
+#endif // POINT_MATCH_SESSION_H
@@ -0,0 +1,48 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#include "Logger.h"
+#include "PointMatchAlgorithm.h"
+#include "PointMatchThread.h"
+
+PointMatchThread::PointMatchThread(const QList<PointMatchPixel> &samplePointPixels,
+                                   const BitPlane &bitsProcessed,
+                                   const DocumentModelPointMatch &modelPointMatch,
+                                   const Points &pointsExisting,
+                                   PointMatchSessionPtr session,
+                                   bool isGnuplot) :
+  m_samplePointPixels (samplePointPixels),
+  m_bitsProcessed (bitsProcessed),
+  m_modelPointMatch (modelPointMatch),
+  m_pointsExisting (pointsExisting),
+  m_session (session),
+  m_isGnuplot (isGnuplot)
+{
+}
+
+QList<QPoint> PointMatchThread::pointsCreated () const
+{
+  return m_pointsCreated;
+}
+
+void PointMatchThread::run ()
+{
+  LOG4CPP_INFO_S ((*mainCat)) << "PointMatchThread::run";
+
+  // Algorithm is created here so it belongs to this thread. Its signals are passed along to the gui thread
+  PointMatchAlgorithm pointMatchAlgorithm (m_isGnuplot);
+
+  connect (&pointMatchAlgorithm, SIGNAL (signalFirstCandidate (QPoint)),
+           this, SIGNAL (signalFirstCandidate (QPoint)), Qt::DirectConnection);
+  connect (&pointMatchAlgorithm, SIGNAL (signalProgress (int)),
+           this, SIGNAL (signalProgress (int)), Qt::DirectConnection);
+
+  m_pointsCreated = pointMatchAlgorithm.findPoints (m_samplePointPixels,
+                                                    m_bitsProcessed,
+                                                    m_modelPointMatch,
+                                                    m_pointsExisting,
+                                                    *m_session);
+}
@@ -0,0 +1,62 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef POINT_MATCH_THREAD_H
+#define POINT_MATCH_THREAD_H
+
+#include "BitPlane.h"
+#include "DocumentModelPointMatch.h"
+#include "PointMatchPixel.h"
+#include "PointMatchSession.h"
+#include "Points.h"
+#include <QList>
+#include <QPoint>
+#include <QThread>
+
+/// Thread that runs PointMatchAlgorithm once, so the gui thread stays responsive while the matches are found. The
+/// inputs are copied, so the document can change while this runs. The session is shared with the owner, which must
+/// not use it until this thread finishes. Use QThread::requestInterruption to cancel. A cancelled thread may take a
+/// moment to notice, so its owner need not wait for it as long as the session stays with this thread
+class PointMatchThread : public QThread
+{
+  Q_OBJECT;
+
+public:
+  /// Single constructor.
+  PointMatchThread(const QList<PointMatchPixel> &samplePointPixels,
+                   const BitPlane &bitsProcessed,
+                   const DocumentModelPointMatch &modelPointMatch,
+                   const Points &pointsExisting,
+                   PointMatchSessionPtr session,
+                   bool isGnuplot);
+
+  /// Matches from best to worst, which are available after the thread has finished. Empty if cancelled
+  QList<QPoint> pointsCreated () const;
+
+  /// Run this thread.
+  virtual void run();
+
+signals:
+  /// Send the best match as soon as it is known, which is before the thread finishes
+  void signalFirstCandidate (QPoint posScreen);
+
+  /// Send the progress as a percentage
+  void signalProgress (int percent);
+
+private:
+  PointMatchThread();
+
+  QList<PointMatchPixel> m_samplePointPixels;
+  BitPlane m_bitsProcessed;
+  DocumentModelPointMatch m_modelPointMatch;
+  Points m_pointsExisting;
+  PointMatchSessionPtr m_session;
+  bool m_isGnuplot;
+
+  QList<QPoint> m_pointsCreated;
+};
+
+#endif // POINT_MATCH_THREAD_H
@@ -8,23 +8,30 @@
 #include "EngaugeAssert.h"
 #include <iostream>
 #include "Logger.h"
-#include "mmsubs.h"
 #include <qdebug.h>
 #include <QFile>
 #include <QGraphicsScene>
+#include <QLineF>
 #include <qmath.h>
 #include <QTextStream>
 #include "QtToString.h"
 #include "Segment.h"
 #include "SegmentLine.h"
 
+const double MAX_DEVIATION = 0.5; // Folded lines stay strictly closer than this many pixels to every removed point
+const double WEDGE_MARGIN = 1.0e-12; // Relative margin that protects MAX_DEVIATION from roundoff
+
 Segment::Segment(QGraphicsScene &scene,
                  int y,
                  bool isGnuplot) :
   m_scene (scene),
   m_yLast (y),
   m_length (0),
-  m_isGnuplot (isGnuplot)
+  m_line (0),
+  m_isGnuplot (isGnuplot),
+  m_fillPointsAreCached (false),
+  m_fillPointsPointSeparation (0),
+  m_fillPointsFillCorners (false)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "Segment::Segment"
                               << " address=0x" << hex << (quintptr) this;
@@ -35,17 +42,14 @@ Segment::~Segment()
   LOG4CPP_INFO_S ((*mainCat)) << "Segment::~Segment"
                               << " address=0x" << hex << (quintptr) this;
 
-  QList<SegmentLine*>::iterator itr;
-  for (itr = m_lines.begin(); itr != m_lines.end(); itr++) {
-
-    SegmentLine *segmentLine = *itr;
-    m_scene.removeItem (segmentLine);
+  if (m_line != 0) {
+    m_scene.removeItem (m_line);
+    delete m_line;
   }
 }
 
 void Segment::appendColumn(int x,
-                           int y,
-                           const DocumentModelSegments &modelSegments)
+                           int y)
 {
   int xOld = x - 1;
   int yOld = m_yLast;
@@ -58,18 +62,12 @@ void Segment::appendColumn(int x,
                                << xOld << "," << yOld << ") to ("
                                << xNew << "," << yNew << ")";
 
-  SegmentLine* line = new SegmentLine(m_scene,
-                                      modelSegments,
-                                      this);
-  ENGAUGE_CHECK_PTR(line);
-  line->setLine(QLineF (xOld,
-                        yOld,
-                        xNew,
-                        yNew));
-
-  // Do not show this line or its segment. this is handled later
-
-  m_lines.append(line);
+  // Graphics items are not created until the segment is complete, in createGraphicsItem
+  if (m_points.empty ()) {
+    m_points.push_back (QPoint (xOld, yOld));
+  }
+  m_points.push_back (QPoint (xNew, yNew));
+  m_fillPointsAreCached = false;
 
   // Update total length using distance formula
   m_length += qSqrt((1.0) * (1.0) + (y - m_yLast) * (y - m_yLast));
@@ -100,57 +98,53 @@ void Segment::createAcceptablePoint(bool *pFirst,
   *pFirst = false;
 }
 
+void Segment::createGraphicsItem(const DocumentModelSegments &modelSegments)
+{
+  LOG4CPP_DEBUG_S ((*mainCat)) << "Segment::createGraphicsItem"
+                               << " segment=0x" << std::hex << (quintptr) this << std::dec
+                               << " points=" << m_points.size ();
+
+  ENGAUGE_ASSERT (m_line == 0);
+
+  m_line = new SegmentLine(m_scene,
+                           modelSegments,
+                           this);
+  ENGAUGE_CHECK_PTR(m_line);
+  m_line->setPolyline (m_points);
+}
+
 void Segment::dumpToGnuplot (QTextStream &strDump,
                              int xInt,
                              int yInt,
-                             const SegmentLine *lineOld,
-                             const SegmentLine *lineNew) const
+                             const QLineF &lineOld,
+                             const QLineF &lineNew) const
 {
   // Only show this dump spew when logging is opened up completely
   if (mainCat->getPriority() == log4cpp::Priority::DEBUG) {
 
-    // Show "before" and "after" line info. Note that the merged line starts with lineOld->line().p1()
-    // and ends with lineNew->line().p2()
+    // Show "before" and "after" line info. Note that the merged line starts with lineOld.p1()
+    // and ends with lineNew.p2()
     QString label = QString ("Old: (%1,%2) to (%3,%4), New: (%5,%6) to (%7,%8)")
-                    .arg (lineOld->line().x1())
-                    .arg (lineOld->line().y1())
-                    .arg (lineOld->line().x2())
-                    .arg (lineOld->line().y2())
-                    .arg (lineNew->line().x1())
-                    .arg (lineNew->line().y1())
-                    .arg (lineNew->line().x2())
-                    .arg (lineNew->line().y2());
+                    .arg (lineOld.x1())
+                    .arg (lineOld.y1())
+                    .arg (lineOld.x2())
+                    .arg (lineOld.y2())
+                    .arg (lineNew.x1())
+                    .arg (lineNew.y1())
+                    .arg (lineNew.x2())
+                    .arg (lineNew.y2());
 
     strDump << "unset label\n";
     strDump << "set label \"" << label << "\" at graph 0, graph 0.02\n";
     strDump << "set grid xtics\n";
     strDump << "set grid ytics\n";
 
-    // Get the bounds
-    int rows = 0, cols = 0;
-    QList<SegmentLine*>::const_iterator itr;
-    for (itr = m_lines.begin(); itr != m_lines.end(); itr++) {
-
-      SegmentLine *line = *itr;
-      ENGAUGE_CHECK_PTR (line);
-
-      int x1 = line->line().x1();
-      int y1 = line->line().y1();
-      int x2 = line->line().x2();
-      int y2 = line->line().y2();
-
-      rows = qMax (rows, y1 + 1);
-      rows = qMax (rows, y2 + 1);
-      cols = qMax (cols, x1 + 1);
-      cols = qMax (cols, x2 + 1);
-    }
-
     // Horizontal and vertical width is computed so merged line mostly fills the plot window,
     // and (xInt,yInt) is at the center
-    int halfWidthX = 1.5 * qMax (qAbs (lineOld->line().dx()),
-                                 qAbs (lineNew->line().dx()));
-    int halfWidthY = 1.5 * qMax (qAbs (lineOld->line().dy()),
-                                 qAbs (lineNew->line().dy()));
+    int halfWidthX = 1.5 * qMax (qAbs (lineOld.dx()),
+                                 qAbs (lineNew.dx()));
+    int halfWidthY = 1.5 * qMax (qAbs (lineOld.dy()),
+                                 qAbs (lineNew.dy()));
 
     // Zoom in so changes are easier to see
     strDump << "set xrange [" << (xInt - halfWidthX - 1) << ":" << (xInt + halfWidthX + 1) << "]\n";
@@ -171,20 +165,19 @@ void Segment::dumpToGnuplot (QTextStream &strDump,
             << (xInt - halfWidthX) << " " << yInt << "\n"
             << (xInt + halfWidthY) << " " << yInt << "\n"
             << "end\n"
-            << lineOld->line().x1() << " " << lineOld->line().y1() << "\n"
-            << lineNew->line().x2() << " " << lineNew->line().y2() << "\n"
+            << lineOld.x1() << " " << lineOld.y1() << "\n"
+            << lineNew.x2() << " " << lineNew.y2() << "\n"
             << "end\n";
 
     // Fill the array from the list
     QString even, odd;
     QTextStream strEven (&even), strOdd (&odd);
-    for (int index = 0; index < m_lines.count(); index++) {
+    for (int index = 0; index < lineCount(); index++) {
 
-      SegmentLine *line = m_lines.at (index);
-      int x1 = line->line().x1();
-      int y1 = line->line().y1();
-      int x2 = line->line().x2();
-      int y2 = line->line().y2();
+      int x1 = m_points [index].x();
+      int y1 = m_points [index].y();
+      int x2 = m_points [index + 1].x();
+      int y2 = m_points [index + 1].y();
 
       if (index % 2 == 0) {
         strEven << x1 << " " << y1 << "\n";
@@ -208,43 +201,53 @@ void Segment::dumpToGnuplot (QTextStream &strDump,
 
 QList<QPoint> Segment::fillPoints(const DocumentModelSegments &modelSegments)
 {
-  LOG4CPP_INFO_S ((*mainCat)) << "Segment::fillPoints";
+  bool isCached = (m_fillPointsAreCached &&
+                   (m_fillPointsPointSeparation == modelSegments.pointSeparation()) &&
+                   (m_fillPointsFillCorners == modelSegments.fillCorners()));
+
+  LOG4CPP_INFO_S ((*mainCat)) << "Segment::fillPoints"
+                              << " cached=" << (isCached ? "true" : "false");
+
+  if (!isCached) {
+
+    if (modelSegments.fillCorners()) {
+      m_fillPoints = fillPointsFillingCorners(modelSegments);
+    } else {
+      m_fillPoints = fillPointsWithoutFillingCorners(modelSegments);
+    }
 
-  if (modelSegments.fillCorners()) {
-    return fillPointsFillingCorners(modelSegments);
-  } else {
-    return fillPointsWithoutFillingCorners(modelSegments);
+    m_fillPointsAreCached = true;
+    m_fillPointsPointSeparation = modelSegments.pointSeparation();
+    m_fillPointsFillCorners = modelSegments.fillCorners();
   }
+
+  return m_fillPoints;
 }
 
 QList<QPoint> Segment::fillPointsFillingCorners(const DocumentModelSegments &modelSegments)
 {
   QList<QPoint> list;
 
-  if (m_lines.count() > 0) {
+  if (lineCount() > 0) {
 
-    double xLast = m_lines.first()->line().x1();
-    double yLast = m_lines.first()->line().y1();
+    double xLast = m_points.front().x();
+    double yLast = m_points.front().y();
     double x, xNext;
     double y, yNext;
     double distanceCompleted = 0.0;
 
     // Variables for createAcceptablePoint
     bool firstPoint = true;
-    double xPrev = m_lines.first()->line().x1();
-    double yPrev = m_lines.first()->line().y1();
-
-    QList<SegmentLine*>::iterator itr;
-    for (itr = m_lines.begin(); itr != m_lines.end(); itr++) {
+    double xPrev = m_points.front().x();
+    double yPrev = m_points.front().y();
 
-      SegmentLine *line = *itr;
+    for (int index = 0; index < lineCount(); index++) {
 
-      ENGAUGE_CHECK_PTR(line);
-      xNext = (double) line->line().x2();
-      yNext = (double) line->line().y2();
+      xNext = (double) m_points [index + 1].x();
+      yNext = (double) m_points [index + 1].y();
 
-      double xStart = (double) line->line().x1();
-      double yStart = (double) line->line().y1();
+      double xStart = (double) m_points [index].x();
+      double yStart = (double) m_points [index].y();
       if (isCorner (yPrev, yStart, yNext)) {
 
         // Insert a corner point
@@ -285,13 +288,12 @@ QList<QPoint> Segment::fillPointsFillingCorners(const DocumentModelSegments &mod
 QPointF Segment::firstPoint () const
 {
   LOG4CPP_INFO_S ((*mainCat)) << "Segment::firstPoint"
-                              << " lineCount=" << m_lines.count();
+                              << " lineCount=" << lineCount();
 
-  // There has to be at least one SegmentLine since this only gets called when a SegmentLine is clicked on
-  ENGAUGE_ASSERT (m_lines.count () > 0);
+  // There has to be at least one line since this only gets called when the SegmentLine is clicked on
+  ENGAUGE_ASSERT (lineCount () > 0);
 
-  SegmentLine *line = m_lines.first();
-  QPointF pos = line->line().p1();
+  QPointF pos = m_points.front();
 
   LOG4CPP_INFO_S ((*mainCat)) << "Segment::firstPoint"
                               << " pos=" << QPointFToString (pos).toLatin1().data();
@@ -302,7 +304,7 @@ QPointF Segment::firstPoint () const
 void Segment::forwardMousePress()
 {
   LOG4CPP_INFO_S ((*mainCat)) << "Segment::forwardMousePress"
-                              << " segmentLines=" << m_lines.count();
+                              << " lines=" << lineCount();
 
   emit signalMouseClickOnSegment (firstPoint ());
 }
@@ -324,27 +326,23 @@ QList<QPoint> Segment::fillPointsWithoutFillingCorners(const DocumentModelSegmen
 {
   QList<QPoint> list;
 
-  if (m_lines.count() > 0) {
+  if (lineCount() > 0) {
 
-    double xLast = m_lines.first()->line().x1();
-    double yLast = m_lines.first()->line().y1();
+    double xLast = m_points.front().x();
+    double yLast = m_points.front().y();
     double x, xNext;
     double y, yNext;
     double distanceCompleted = 0.0;
 
     // Variables for createAcceptablePoint
     bool firstPoint = true;
-    double xPrev = m_lines.first()->line().x1();
-    double yPrev = m_lines.first()->line().y1();
+    double xPrev = m_points.front().x();
+    double yPrev = m_points.front().y();
 
-    QList<SegmentLine*>::iterator itr;
-    for (itr = m_lines.begin(); itr != m_lines.end(); itr++) {
+    for (int index = 0; index < lineCount(); index++) {
 
-      SegmentLine *line = *itr;
-
-      ENGAUGE_CHECK_PTR(line);
-      xNext = (double) line->line().x2();
-      yNext = (double) line->line().y2();
+      xNext = (double) m_points [index + 1].x();
+      yNext = (double) m_points [index + 1].y();
 
       // Distance formula
       double segmentLength = sqrt((xNext - xLast) * (xNext - xLast) + (yNext - yLast) * (yNext - yLast));
@@ -383,38 +381,34 @@ double Segment::length() const
 
 int Segment::lineCount() const
 {
-  return m_lines.count();
+  // There are no points until the first line is appended
+  return (m_points.empty () ? 0 : (int) m_points.size () - 1);
 }
 
-bool Segment::pointIsCloseToLine(double xLeft,
-                                 double yLeft,
-                                 double xInt,
-                                 double yInt,
-                                 double xRight,
-                                 double yRight)
+void Segment::narrowWedge (double xLeft,
+                           double yLeft,
+                           double xRemoved,
+                           double yRemoved,
+                           double *angleLow,
+                           double *angleHigh) const
 {
-  double xProj, yProj, projectedDistanceOutsideLine, distanceToLine;
-  projectPointOntoLine(xInt, yInt, xLeft, yLeft, xRight, yRight, &xProj, &yProj, &projectedDistanceOutsideLine, &distanceToLine);
-
-  return (
-    (xInt - xProj) * (xInt - xProj) +
-    (yInt - yProj) * (yInt - yProj) < 0.5 * 0.5);
+  // Lines from the left point in directions within halfWidth of the direction to the removed point pass closer than
+  // MAX_DEVIATION to it. The removed point is at least one column to the right, so asin is always defined. Since
+  // folded lines always end at least one column further to the right, the closest point on the infinite line is always
+  // within the folded line. The wedge is shrunk by a tiny fraction so roundoff can never loosen the bound
+  double distance = qSqrt ((xRemoved - xLeft) * (xRemoved - xLeft) +
+                           (yRemoved - yLeft) * (yRemoved - yLeft));
+  double angle = qAtan2 (yRemoved - yLeft,
+                         xRemoved - xLeft);
+  double halfWidth = qAsin (MAX_DEVIATION / distance) * (1.0 - WEDGE_MARGIN);
+
+  *angleLow = qMax (*angleLow, angle - halfWidth);
+  *angleHigh = qMin (*angleHigh, angle + halfWidth);
 }
 
-bool Segment::pointsAreCloseToLine(double xLeft,
-                                   double yLeft,
-                                   QList<QPoint> removedPoints,
-                                   double xRight,
-                                   double yRight)
+const std::vector<QPoint> &Segment::polyline () const
 {
-  QList<QPoint>::iterator itr;
-  for (itr = removedPoints.begin(); itr != removedPoints.end(); ++itr) {
-    if (!pointIsCloseToLine(xLeft, yLeft, (double) (*itr).x(), (double) (*itr).y(), xRight, yRight)) {
-      return false;
-    }
-  }
-
-  return true;
+  return m_points;
 }
 
 void Segment::removeUnneededLines (int *foldedLines)
@@ -438,80 +432,78 @@ void Segment::removeUnneededLines (int *foldedLines)
   // Pathological case is y=0.001*x*x, since the small slope can fool a naive algorithm
   // into optimizing away all but one point at the origin and another point at the far right.
   // From this we see that we cannot simply throw away points that were optimized away since they
-  // are needed later to see if we have diverged from the curve
-  SegmentLine *linePrevious = 0; // Previous line which corresponds to itrPrevious
-  QList<SegmentLine*>::iterator itr, itrPrevious;
-  QList<QPoint> removedPoints;
-  for (itr = m_lines.begin(); itr != m_lines.end(); itr++) {
-
-    SegmentLine *line = *itr;
-    ENGAUGE_CHECK_PTR(line);
-
-    if (linePrevious != 0) {
-
-      double xLeft = linePrevious->line().x1();
-      double yLeft = linePrevious->line().y1();
-      double xInt = linePrevious->line().x2();
-      double yInt = linePrevious->line().y2();
-
-      // If linePrevious is the last line of one Segment and line is the first line of another Segment then
-      // it makes no sense to remove any point so we continue the loop
-      if (linePrevious->line().p2() == line->line().p1()) {
-
-        double xRight = line->line().x2();
-        double yRight = line->line().y2();
-
-        if (pointIsCloseToLine(xLeft, yLeft, xInt, yInt, xRight, yRight) &&
-          pointsAreCloseToLine(xLeft, yLeft, removedPoints, xRight, yRight)) {
-
-          if (m_isGnuplot) {
-
-            // Dump
-            dumpToGnuplot (*strDump,
-                           xInt,
-                           yInt,
-                           linePrevious,
-                           line);
-          }
-
-          // Remove intermediate point, by removing older line and stretching new line to first point
-          ++(*foldedLines);
-
-          LOG4CPP_DEBUG_S ((*mainCat)) << "Segment::removeUnneededLines"
-                                       << " segment=0x" << std::hex << (quintptr) this << std::dec
-                                       << " removing ("
-                                       << linePrevious->line().x1() << "," << linePrevious->line().y1() << ") to ("
-                                       << linePrevious->line().x2() << "," << linePrevious->line().y2() << ") "
-                                       << " and modifying ("
-                                       << line->line().x1() << "," << line->line().y1() << ") to ("
-                                       << line->line().x2() << "," << line->line().y2() << ") into ("
-                                       << xLeft << "," << yLeft << ") to ("
-                                       << xRight << "," << yRight << ")";
-
-          removedPoints.append(QPoint((int) xInt, (int) yInt));
-          m_lines.erase (itrPrevious);
-          delete linePrevious;
-
-          // New line
-          line->setLine (xLeft, yLeft, xRight, yRight);
-
-        } else {
-
-          // Keeping this intermediate point and clear out the removed points list
-          removedPoints.clear();
+  // are needed later to see if we have diverged from the curve.
+  //
+  // Rather than keeping the removed points and checking every one of them against each new folded line, which is
+  // quadratic on long smooth curves, each removed point narrows the wedge of directions from the left end that the
+  // folded line can take. The wedge accounts for all removed points at once, so each point is handled in constant time.
+  //
+  // Points are copied to pointsFolded as they are kept. The left end of the folded line is the last point in
+  // pointsFolded, and iPrevious is the right end of the previous line. The original points stay in m_points
+  // until the end, for the gnuplot dump
+  std::vector<QPoint> pointsFolded;
+  if (lineCount () > 0) {
+
+    pointsFolded.push_back (m_points [0]);
+    unsigned int iPrevious = 1;
+    double angleLow = -M_PI, angleHigh = M_PI; // No points have been removed yet, so any direction is allowed
+    for (unsigned int i = 2; i < m_points.size (); i++) {
+
+      double xLeft = pointsFolded.back().x();
+      double yLeft = pointsFolded.back().y();
+      double xInt = m_points [iPrevious].x();
+      double yInt = m_points [iPrevious].y();
+      double xRight = m_points [i].x();
+      double yRight = m_points [i].y();
+
+      // Folding removes the intermediate point, so the folded line must pass close to it too
+      narrowWedge (xLeft, yLeft, xInt, yInt, &angleLow, &angleHigh);
+
+      double angleRight = qAtan2 (yRight - yLeft,
+                                  xRight - xLeft);
+      if ((angleLow < angleRight) && (angleRight < angleHigh)) {
+
+        if (m_isGnuplot) {
+
+          // Dump
+          dumpToGnuplot (*strDump,
+                         xInt,
+                         yInt,
+                         QLineF (pointsFolded.back(), m_points [iPrevious]),
+                         QLineF (m_points [iPrevious], m_points [i]));
         }
-      }
-    }
 
-    linePrevious = line;
-    itrPrevious = itr;
+        // Remove intermediate point, by removing older line and stretching new line to first point
+        ++(*foldedLines);
 
-    // This theoretically should not be needed, but for some reason modifying the last point triggers a segfault
-    if (itr == m_lines.end()) {
-      break;
+        LOG4CPP_DEBUG_S ((*mainCat)) << "Segment::removeUnneededLines"
+                                     << " segment=0x" << std::hex << (quintptr) this << std::dec
+                                     << " removing ("
+                                     << xLeft << "," << yLeft << ") to ("
+                                     << xInt << "," << yInt << ") "
+                                     << " and modifying ("
+                                     << xInt << "," << yInt << ") to ("
+                                     << xRight << "," << yRight << ") into ("
+                                     << xLeft << "," << yLeft << ") to ("
+                                     << xRight << "," << yRight << ")";
+
+      } else {
+
+        // Keeping this intermediate point, which starts a new folded line in any direction
+        pointsFolded.push_back (m_points [iPrevious]);
+        angleLow = -M_PI;
+        angleHigh = M_PI;
+      }
+
+      iPrevious = i;
     }
+
+    pointsFolded.push_back (m_points [iPrevious]);
   }
 
+  m_points.swap (pointsFolded);
+  m_fillPointsAreCached = false;
+
   if (strDump != 0) {
 
     // Final gnuplot processing
@@ -527,11 +519,8 @@ void Segment::slotHover (bool hover)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "Segment::slotHover";
 
-  QList<SegmentLine*>::iterator itr, itrPrevious;
-  for (itr = m_lines.begin(); itr != m_lines.end(); itr++) {
-
-    SegmentLine *line = *itr;
-    line->setHover(hover);
+  if (m_line != 0) {
+    m_line->setHover(hover);
   }
 }
 
@@ -539,10 +528,7 @@ void Segment::updateModelSegment(const DocumentModelSegments &modelSegments)
 {
   LOG4CPP_INFO_S ((*mainCat)) << "Segment::updateModelSegment";
 
-  QList<SegmentLine*>::iterator itr;
-  for (itr = m_lines.begin(); itr != m_lines.end(); itr++) {
-
-    SegmentLine *line = *itr;
-    line->updateModelSegment (modelSegments);
+  if (m_line != 0) {
+    m_line->updateModelSegment (modelSegments);
   }
 }
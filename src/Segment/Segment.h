@@ -9,15 +9,22 @@
 
 #include <QList>
 #include <QObject>
+#include <QPoint>
 #include <QPointF>
+#include <vector>
 
 class DocumentModelSegments;
 class QGraphicsScene;
+class QLineF;
 class QTextStream;
 class SegmentLine;
 
 /// Selectable piecewise-defined line that follows a filtered line in the image. Clicking on a
 /// Segment results in the immediate creation of multiple Points along that Segment.
+///
+/// While the image is being scanned, the Segment is only a compact polyline with one point per column. The single
+/// SegmentLine graphics item is created by createGraphicsItem after the Segment is complete and its unneeded lines
+/// have been removed, so Segments that are too short never touch the scene
 class Segment : public QObject
 { 
   Q_OBJECT;
@@ -30,16 +37,20 @@ public:
   ~Segment();
 
   /// Add some more pixels in a new column to an active segment
-  void appendColumn(int x, int y, const DocumentModelSegments &modelSegments);
+  void appendColumn(int x, int y);
 
-  /// Create evenly spaced points along the segment
+  /// Create the SegmentLine that draws this completed segment, and add it to the scene
+  void createGraphicsItem(const DocumentModelSegments &modelSegments);
+
+  /// Create evenly spaced points along the segment. The points depend only on the point separation and fill corners
+  /// settings, so they are remembered and returned again while those settings and the lines are unchanged
   QList<QPoint> fillPoints(const DocumentModelSegments &modelSegments);
 
   /// Coordinates of first point in Segment. This info can be used to uniquely identify a Segment. This method relies
   /// on SegmentFactory::removeEmptySegments to guarantee every Segment has at least one line
   QPointF firstPoint () const;
 
-  /// Forward mouse press event from a component SegmentLine that was just clicked on
+  /// Forward mouse press event from the SegmentLine that was just clicked on
   void forwardMousePress ();
 
   /// Get method for length in pixels
@@ -48,10 +59,14 @@ public:
   /// Get method for number of lines
   int lineCount() const;
 
+  /// Points of the polyline. These are the column samples until removeUnneededLines folds them
+  const std::vector<QPoint> &polyline () const;
+
   /// Try to compress a segment that was just completed, by folding together line from
   /// point i to point i+1, with the line from i+1 to i+2, then the line from i+2 to i+3,
-  /// until one of the points is more than a half pixel from the folded line. this should
-  /// save memory and improve user interface responsiveness
+  /// until one of the points is a half pixel or more from the folded line. this should
+  /// save memory and improve user interface responsiveness. Every removed point is guaranteed
+  /// to be less than a half pixel from its folded line, and the time is linear in the number of points
   void removeUnneededLines(int *foldedLines);
 
   /// Update this segment given the new settings
@@ -59,7 +74,7 @@ public:
 
 public slots:
 
-  /// Slot for hover enter/leave events in the associated SegmentLines
+  /// Slot for hover enter/leave events in the associated SegmentLine
   void slotHover (bool hover);
 
 signals:
@@ -84,16 +99,14 @@ private:
                              double y);
 
   /// Dump pixels into gnuplot script file with embedded data, ready for input straight into gnuplot. This
-  /// method revealed, when called from removeUnneededLines, that the algorithms have to allow for cases
-  /// when lineOld->line().p2() is not equal to lineNew->line().p1(). In those cases, one Segment is ending
-  /// and another is starting
+  /// method is called from removeUnneededLines, while the pre-merge points are still in m_points
   ///
   /// This method does nothing unless the logging level is set to DEBUG
   void dumpToGnuplot (QTextStream &strDump,
                       int xInt,
                       int yInt,
-                      const SegmentLine *lineOld,
-                      const SegmentLine *lineNew) const;
+                      const QLineF &lineOld,
+                      const QLineF &lineNew) const;
 
   // Create evenly spaced points along the segment, with extra points to fill in corners.This algorithm is the
   // same as fillPointsWithoutFillingCorners except extra points are inserted at the corners
@@ -108,13 +121,14 @@ private:
                  double yPrev,
                  double yNext) const;
 
-  // Return true if point are a half pixel or less away from a line
-  bool pointIsCloseToLine(double xLeft, double yLeft, double xInt, double yInt,
-    double xRight, double yRight);
-
-  // Return true if points are a half pixel or less away from a line
-  bool pointsAreCloseToLine(double xLeft, double yLeft, QList<QPoint> removedPoints,
-    double xRight, double yRight);
+  // Narrow the range of directions from the left point, from angleLow to angleHigh, to directions of lines that pass
+  // closer than MAX_DEVIATION to the removed point
+  void narrowWedge (double xLeft,
+                    double yLeft,
+                    double xRemoved,
+                    double yRemoved,
+                    double *angleLow,
+                    double *angleHigh) const;
 
   QGraphicsScene &m_scene;
 
@@ -124,11 +138,22 @@ private:
   // Total length of lines owned by this segment, as floating point to allow fractional increments
   double m_length;
 
-  // This segment is drawn as a series of line segments
-  QList<SegmentLine*> m_lines;
+  // Polyline of this segment. Line i goes from point i to point i+1, so there are no points until the first line is
+  // appended. Points are pixel coordinates, so integers are sufficient
+  std::vector<QPoint> m_points;
+
+  // Graphics item that draws the polyline, which is created once the segment is complete
+  SegmentLine *m_line;
 
   // True for gnuplot input files for debugging
   bool m_isGnuplot;
+
+  // Points from the last fillPoints call, and the settings they were created with. These are cleared whenever the
+  // lines change
+  bool m_fillPointsAreCached;
+  double m_fillPointsPointSeparation;
+  bool m_fillPointsFillCorners;
+  QList<QPoint> m_fillPoints;
 };
 
 #endif // SEGMENT_H
@@ -4,18 +4,30 @@
  * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
  ******************************************************************************************************/
 
-#include "ColorFilter.h"
+#include "BitPlane.h"
 #include "DocumentModelSegments.h"
 #include "EngaugeAssert.h"
 #include "Logger.h"
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QGraphicsScene>
 #include <QProgressDialog>
+#include <QtConcurrentMap>
 #include "Segment.h"
 #include "SegmentFactory.h"
 
 using namespace std;
 
+// Steps per strip when linking runs in parallel. Strips are small so the threads finish together, and so the progress
+// dialog advances smoothly
+const int COLUMNS_PER_STRIP = 64;
+
+// Minimum time between progress dialog updates. Updating after every column takes longer than the scan itself
+const qint64 PROGRESS_INTERVAL_MILLISECONDS = 100;
+
 SegmentFactory::SegmentFactory(QGraphicsScene &scene,
                                bool isGnuplot) :
   m_scene (scene),
@@ -24,68 +36,34 @@ SegmentFactory::SegmentFactory(QGraphicsScene &scene,
   LOG4CPP_INFO_S ((*mainCat)) << "SegmentFactory::SegmentFactory";
 }
 
-int SegmentFactory::adjacentRuns(bool *columnBool,
-                                 int yStart,
-                                 int yStop,
-                                 int height)
+int SegmentFactory::columnForStep (int x,
+                                   int width)
 {
-  int runs = 0;
-  bool inRun = false;
-  for (int y = yStart - 1; y <= yStop + 1; y++) {
-    if ((0 <= y) && (y < height)) {
-      if (!inRun && columnBool [y]) {
-        inRun = true;
-        ++runs;
-      } else if (inRun && !columnBool [y]) {
-        inRun = false;
-      }
-    }
-  }
+  // Steps 0 and 1 examine columns 0 and 1, and every later step x examines column x-1, with the last column of the image
+  // never being examined. This reproduces the column buffers of the original column scanner, which loaded the next
+  // column one step early, so the segments are the same as they always were
+  ENGAUGE_ASSERT (x <= width);
 
-  return runs;
+  return ((x <= 1) ? x : x - 1);
 }
 
-Segment *SegmentFactory::adjacentSegment(SegmentVector &lastSegment,
-                                         int yStart,
-                                         int yStop,
-                                         int height)
+int SegmentFactory::countAdjacentRuns (const SegmentRunVector &runs,
+                                       int *first,
+                                       int yStart,
+                                       int yStop)
 {
-  for (int y = yStart - 1; y <= yStop + 1; y++) {
-    if ((0 <= y) && (y < height)) {
-
-      ENGAUGE_ASSERT (y < height);
-      if (lastSegment [y]) {
-        return lastSegment [y];
-      }
-    }
+  // Runs entirely above yStart-1 cannot touch this run, or any run below it in the same column
+  while ((*first < runs.count ()) &&
+         (runs [*first].yStop < yStart - 1)) {
+    ++(*first);
   }
 
-  return 0;
-}
-
-int SegmentFactory::adjacentSegments(SegmentVector &lastSegment,
-                                     int yStart,
-                                     int yStop,
-                                     int height)
-{
-  int adjacentSegments = 0;
-
-  bool inSegment = false;
-  for (int y = yStart - 1; y <= yStop + 1; y++) {
-    if ((0 <= y) && (y < height)) {
-
-      ENGAUGE_ASSERT (y < height);
-      if (!inSegment && lastSegment [y]) {
-
-       inSegment = true;
-        ++adjacentSegments;
-      } else if (inSegment && !lastSegment [y]) {
-        inSegment = false;
-      }
-    }
+  int count = 0;
+  for (int i = *first; (i < runs.count ()) && (runs [i].yStart <= yStop + 1); i++) {
+    ++count;
   }
 
-  return adjacentSegments;
+  return count;
 }
 
 QList<QPoint> SegmentFactory::fillPoints(const DocumentModelSegments &modelSegments,
@@ -105,86 +83,80 @@ QList<QPoint> SegmentFactory::fillPoints(const DocumentModelSegments &modelSegme
   return list;
 }
 
-void SegmentFactory::finishRun(bool *lastBool,
-                               bool *nextBool,
-                               SegmentVector &lastSegment,
-                               SegmentVector &currSegment,
+void SegmentFactory::finishRun(SegmentRunVector &lastRuns,
+                               SegmentRun &run,
                                int x,
-                               int yStart,
-                               int yStop,
-                               int height,
-                               const DocumentModelSegments &modelSegments,
                                int* madeLines)
 {
   LOG4CPP_DEBUG_S ((*mainCat)) << "SegmentFactory::finishRun"
                                << " column=" << x
-                               << " rows=" << yStart << "-" << yStop
-                               << " runsOnLeft=" << adjacentRuns (nextBool, yStart, yStop, height)
-                               << " runsOnRight=" << adjacentSegments (lastSegment, yStart, yStop, height);
-
-  // When looking at adjacent columns, include pixels that touch diagonally since
-  // those may also diagonally touch nearby runs in the same column (which would indicate
-  // a branch)
-
-  // Count runs that touch on the left
-  if (adjacentRuns(lastBool, yStart, yStop, height) > 1) {
-    return;
-  }
-
-  // Count runs that touch on the right
-  if (adjacentRuns(nextBool, yStart, yStop, height) > 1) {
-    return;
+                               << " rows=" << run.yStart << "-" << run.yStop
+                               << " indexLeft=" << run.indexLeft;
+
+  // A run on the left at a branch point has no segment
+  SegmentRun *runLeft = 0;
+  if ((run.indexLeft >= 0) &&
+      (lastRuns [run.indexLeft].segment != 0)) {
+    runLeft = &lastRuns [run.indexLeft];
   }
 
   Segment *seg;
-  if (adjacentSegments(lastSegment, yStart, yStop, height) == 0) {
+  if (runLeft == 0) {
 
     // This is the start of a new segment
     seg = new Segment(m_scene,
-                      (int) (0.5 + (yStart + yStop) / 2.0),
+                      (int) (0.5 + (run.yStart + run.yStop) / 2.0),
                       m_isGnuplot);
     ENGAUGE_CHECK_PTR (seg);
 
   } else {
 
     // This is the continuation of an existing segment
-    seg = adjacentSegment(lastSegment, yStart, yStop, height);
+    seg = runLeft->segment;
+    runLeft->isContinued = true;
 
     ++(*madeLines);
     ENGAUGE_CHECK_PTR(seg);
-    seg->appendColumn(x, (int) (0.5 + (yStart + yStop) / 2.0), modelSegments);
+    seg->appendColumn(x, (int) (0.5 + (run.yStart + run.yStop) / 2.0));
   }
 
-  for (int y = yStart; y <= yStop; y++) {
-
-    ENGAUGE_ASSERT (y < height);
-    currSegment [y] = seg;
-  }
+  run.segment = seg;
 }
 
-void SegmentFactory::loadBool (const ColorFilter &filter,
-                               bool *columnBool,
-                               const QImage &image,
-                               int x)
+void SegmentFactory::linkRunsInStrip (SegmentRunStrip &strip)
 {
-  for (int y = 0; y < image.height(); y++) {
-    if (x < 0) {
-      columnBool [y] = false;
-    } else {
-      columnBool [y] = filter.pixelFilteredIsOn (image, x, y);
-    }
-  }
-}
+  const SegmentRunVector empty;
 
-void SegmentFactory::loadSegment (SegmentVector &columnSegment,
-                                  int height)
-{
-  for (int y = 0; y < height; y++) {
-    columnSegment [y] = 0;
+  for (int x = strip.xStart; x < strip.xStop; x++) {
+
+    // Column to the left of the first column, and to the right of a single column image, have no runs
+    int columnLast = columnForStep (x - 1, strip.width);
+    int columnNext = columnForStep (x + 1, strip.width);
+    const SegmentRunVector &lastRuns = ((columnLast >= 0) ? strip.columnRuns [columnLast] : empty);
+    const SegmentRunVector &nextRuns = ((columnNext < strip.width) ? strip.columnRuns [columnNext] : empty);
+
+    SegmentRunVector &currRuns = strip.stepRuns [x];
+    currRuns = strip.columnRuns [columnForStep (x, strip.width)];
+
+    // Runs are visited from top to bottom, so the searches of the adjacent columns only move downward
+    int lastFirst = 0, nextFirst = 0;
+    for (int i = 0; i < currRuns.count (); i++) {
+
+      SegmentRun &run = currRuns [i];
+
+      // When looking at adjacent columns, include pixels that touch diagonally since
+      // those may also diagonally touch nearby runs in the same column (which would indicate
+      // a branch)
+      int runsOnLeft = countAdjacentRuns (lastRuns, &lastFirst, run.yStart, run.yStop);
+      int runsOnRight = countAdjacentRuns (nextRuns, &nextFirst, run.yStart, run.yStop);
+
+      run.isBranch = (runsOnLeft > 1) || (runsOnRight > 1);
+      run.indexLeft = ((runsOnLeft == 1) ? lastFirst : -1);
+    }
   }
 }
 
-void SegmentFactory::makeSegments (const QImage &imageFiltered,
+void SegmentFactory::makeSegments (const BitPlane &bitsFiltered,
                                    const DocumentModelSegments &modelSegments,
                                    QList<Segment*> &segments,
                                    bool useDlg)
@@ -208,73 +180,86 @@ void SegmentFactory::makeSegments (const QImage &imageFiltered,
   //       "this run is the start of a new segment"
   //     else
   //       "this run is appended to the segment on the left
-  int width = imageFiltered.width();
-  int height = imageFiltered.height();
+  //
+  // Runs are found for all columns up front. The runs of each step are then linked to the nearby runs in the adjacent
+  // columns, in parallel vertical strips since each step depends only on the image. Finally the linked runs are
+  // connected to segments, one step at a time, which must be serial since that creates the graphics items
+  int width = bitsFiltered.width();
+  int stripCount = (width + COLUMNS_PER_STRIP - 1) / COLUMNS_PER_STRIP;
 
   QProgressDialog* dlg = 0;
   if (useDlg)
   {
 
-    dlg = new QProgressDialog("Scanning segments in image", "Cancel", 0, width);
+    // Linking and connecting each take one unit per strip, so the progress of the linking can go straight to the dialog
+    dlg = new QProgressDialog("Scanning segments in image", "Cancel", 0, 2 * stripCount);
     ENGAUGE_CHECK_PTR (dlg);
     dlg->show();
   }
+  QElapsedTimer progressTimer;
+  progressTimer.start ();
+  bool isCanceled = false;
+
+  QVector<SegmentRunVector> columnRuns = runsByColumn (bitsFiltered);
+  QVector<SegmentRunVector> stepRuns (width);
+
+  QList<SegmentRunStrip> strips;
+  for (int xStart = 0; xStart < width; xStart += COLUMNS_PER_STRIP) {
+    SegmentRunStrip strip;
+    strip.columnRuns = columnRuns.constData ();
+    strip.width = width;
+    strip.stepRuns = stepRuns.data (); // Obtained here so no thread triggers a detach
+    strip.xStart = xStart;
+    strip.xStop = qMin (width, xStart + COLUMNS_PER_STRIP);
+    strips << strip;
+  }
 
-  bool* lastBool = new bool [height];
-  ENGAUGE_CHECK_PTR(lastBool);
-  bool* currBool = new bool [height];
-  ENGAUGE_CHECK_PTR(currBool);
-  bool* nextBool = new bool [height];
-  ENGAUGE_CHECK_PTR(nextBool);
-  SegmentVector lastSegment (height);
-  SegmentVector currSegment (height);
-
-  ColorFilter filter;
-  loadBool(filter, lastBool, imageFiltered, -1);
-  loadBool(filter, currBool, imageFiltered, 0);
-  loadBool(filter, nextBool, imageFiltered, 1);
-  loadSegment(lastSegment, height);
-
-  for (int x = 0; x < width; x++) {
+  QFuture<void> future = QtConcurrent::map (strips, &SegmentFactory::linkRunsInStrip);
+  if (useDlg) {
 
-    if (useDlg) {
+    // Local event loop keeps the dialog responsive while the threads work, and ends when they finish or are cancelled.
+    // Signals must be connected before the future is set, so none are missed
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    QObject::connect (&watcher, SIGNAL (progressValueChanged (int)), dlg, SLOT (setValue (int)));
+    QObject::connect (&watcher, SIGNAL (finished ()), &loop, SLOT (quit ()));
+    QObject::connect (dlg, SIGNAL (canceled ()), &watcher, SLOT (cancel ()));
+    watcher.setFuture (future);
+    loop.exec ();
+
+    isCanceled = future.isCanceled ();
+  }
+  future.waitForFinished ();
 
-      // Update progress bar
-      dlg->setValue(x);
-      qApp->processEvents();
+  SegmentRunVector emptyRuns; // Column to the left of the first column has no runs
+  for (int x = 0; (x < width) && !isCanceled; x++) {
 
-      if (dlg->wasCanceled()) {
+    if (updateProgress (dlg,
+                        progressTimer,
+                        stripCount + x / COLUMNS_PER_STRIP)) {
 
-        // Quit scanning. only existing segments will be available
-        break;
-      }
+      // Quit scanning. only existing segments will be available
+      break;
     }
 
     matchRunsToSegments(x,
-                        height,
-                        lastBool,
-                        lastSegment,
-                        currBool,
-                        currSegment,
-                        nextBool,
+                        (x > 0) ? stepRuns [x - 1] : emptyRuns,
+                        stepRuns [x],
                         modelSegments,
                         &madeLines,
                         &foldedLines,
                         &shortLines,
                         segments);
 
-    // Get ready for next column
-    scrollBool(lastBool, currBool, height);
-    scrollBool(currBool, nextBool, height);
-    if (x + 1 < width) {
-      loadBool(filter, nextBool, imageFiltered, x + 1);
+    // Runs of the previous step are no longer needed
+    if (x > 0) {
+      stepRuns [x - 1] = SegmentRunVector ();
     }
-    scrollSegment(lastSegment, currSegment, height);
   }
 
   if (useDlg) {
 
-    dlg->setValue(width);
+    dlg->setValue (2 * stripCount);
     delete dlg;
   }
 
@@ -284,58 +269,28 @@ void SegmentFactory::makeSegments (const QImage &imageFiltered,
                                  << " linesCreated=" << madeLines
                                  << " linesTooShortSoRemoved=" << shortLines
                                  << " linesFoldedTogether=" << foldedLines;
-
-  delete[] lastBool;
-  delete[] currBool;
-  delete[] nextBool;
 }
 
 void SegmentFactory::matchRunsToSegments(int x,
-                                         int height,
-                                         bool *lastBool,
-                                         SegmentVector &lastSegment,
-                                         bool* currBool,
-                                         SegmentVector &currSegment,
-                                         bool *nextBool,
+                                         SegmentRunVector &lastRuns,
+                                         SegmentRunVector &currRuns,
                                          const DocumentModelSegments &modelSegments,
                                          int *madeLines,
                                          int *foldedLines,
                                          int *shortLines,
                                          QList<Segment*> &segments)
 {
-  loadSegment(currSegment,
-              height);
-
-  int yStart = 0;
-  bool inRun = false;
-  for (int y = 0; y < height; y++) {
-
-    ENGAUGE_ASSERT (y < height);
-    if (!inRun && currBool [y]) {
-      inRun = true;
-      yStart = y;
-    }
-
-    if ((y + 1 >= height) || !currBool [y + 1]) {
-      if (inRun) {
-        finishRun(lastBool,
-                  nextBool,
-                  lastSegment,
-                  currSegment,
-                  x, yStart,
-                  y,
-                  height,
-                  modelSegments,
-                  madeLines);
-      }
-
-      inRun = false;
+  // For each new column of pixels, loop through the runs, ignoring runs at branch points
+  for (int i = 0; i < currRuns.count (); i++) {
+    if (!currRuns [i].isBranch) {
+      finishRun(lastRuns,
+                currRuns [i],
+                x,
+                madeLines);
     }
   }
 
-  removeUnneededLines(lastSegment,
-                      currSegment,
-                      height,
+  removeUnneededLines(lastRuns,
                       foldedLines,
                       shortLines,
                       modelSegments,
@@ -362,9 +317,7 @@ void SegmentFactory::removeEmptySegments (QList<Segment*> &segments) const
   }
 }
 
-void SegmentFactory::removeUnneededLines(SegmentVector &lastSegment,
-                                         SegmentVector &currSegment,
-                                         int height,
+void SegmentFactory::removeUnneededLines(const SegmentRunVector &lastRuns,
                                          int *foldedLines,
                                          int *shortLines,
                                          const DocumentModelSegments &modelSegments,
@@ -372,67 +325,71 @@ void SegmentFactory::removeUnneededLines(SegmentVector &lastSegment,
 {
   LOG4CPP_DEBUG_S ((*mainCat)) << "SegmentFactory::removeUnneededLines";
 
-  Segment *segLast = 0;
-  for (int yLast = 0; yLast < height; yLast++) {
+  for (int i = 0; i < lastRuns.count (); i++) {
+
+    // If the segment continues in the current column then it is still in work so postpone processing
+    Segment *segLast = lastRuns [i].segment;
+    if ((segLast != 0) &&
+        !lastRuns [i].isContinued) {
+
+      if (segLast->length() < (modelSegments.minLength() - 1) * modelSegments.pointSeparation()) {
 
-    ENGAUGE_ASSERT (yLast < height);
-    if (lastSegment [yLast] && (lastSegment [yLast] != segLast)) {
+        // Remove whole segment since it is too short
+        *shortLines += segLast->lineCount();
+        delete segLast;
 
-      segLast = lastSegment [yLast];
+      } else {
 
-      // If the segment is found in the current column then it is still in work so postpone processing
-      bool found = false;
-      for (int yCur = 0; yCur < height; yCur++) {
+        // Keep segment, but try to fold lines. Only the folded lines are drawn
+        segLast->removeUnneededLines(foldedLines);
+        segLast->createGraphicsItem(modelSegments);
+
+        // Add to the output array since it is done and sufficiently long
+        segments.push_back (segLast);
 
-        ENGAUGE_ASSERT (yCur < height);
-        if (segLast == currSegment [yCur]) {
-          found = true;
-          break;
-        }
       }
+    }
+  }
+}
 
-      if (!found) {
+QVector<SegmentRunVector> SegmentFactory::runsByColumn (const BitPlane &bits) const
+{
+  QVector<SegmentRunVector> columnRuns (bits.width ());
 
-        ENGAUGE_CHECK_PTR(segLast);
-        if (segLast->length() < (modelSegments.minLength() - 1) * modelSegments.pointSeparation()) {
+  for (int y = 0; y < bits.height (); y++) {
+    for (int x = bits.nextPixelOn (0, y); x < bits.width (); x = bits.nextPixelOn (x + 1, y)) {
 
-          // Remove whole segment since it is too short. Do NOT set segLast to zero since that
-          // would cause this same segment to be deleted again in the next pixel if the segment
-          // covers more than one pixel
-          *shortLines += segLast->lineCount();
-          delete segLast;
-          lastSegment [yLast] = 0;
+      SegmentRunVector &runs = columnRuns [x];
+      if (bits.pixel (x, y - 1)) {
 
-        } else {
+        // Pixel above belongs to the last run in this column, which gets extended
+        runs.last ().yStop = y;
 
-          // Keep segment, but try to fold lines
-          segLast->removeUnneededLines(foldedLines);
+      } else {
 
-          // Add to the output array since it is done and sufficiently long
-          segments.push_back (segLast);
+        runs.append (SegmentRun (y, y));
 
-        }
       }
     }
   }
-}
 
-void SegmentFactory::scrollBool(bool *left,
-                                bool *right,
-                                int height)
-{
-  for (int y = 0; y < height; y++) {
-    left [y] = right [y];
-  }
+  return columnRuns;
 }
 
-void SegmentFactory::scrollSegment(SegmentVector &left,
-                                   SegmentVector &right,
-                                   int height)
+bool SegmentFactory::updateProgress (QProgressDialog *dlg,
+                                     QElapsedTimer &timer,
+                                     int value) const
 {
-  for (int y = 0; y < height; y++) {
-    left [y] = right [y];
+  if ((dlg == 0) ||
+      (timer.elapsed () < PROGRESS_INTERVAL_MILLISECONDS)) {
+    return false;
   }
+
+  timer.restart ();
+  dlg->setValue (value);
+  qApp->processEvents ();
+
+  return dlg->wasCanceled ();
 }
 
 void SegmentFactory::clearSegments (QList<Segment*> &segments)
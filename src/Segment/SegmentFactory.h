@@ -9,16 +9,16 @@
 
 #include <QList>
 #include <QPointF>
-#include <vector>
+#include <QVector>
+#include "SegmentRun.h"
 
-class ColorFilter;
+class BitPlane;
 class DocumentModelSegments;
+class QElapsedTimer;
 class QGraphicsScene;
-class QImage;
+class QProgressDialog;
 class Segment;
 
-typedef std::vector<Segment*> SegmentVector;
-
 /// Factory class for Segment objects. The input is the filtered image.
 ///
 /// The strategy is to fill out the segments output array as each segment finishes. This makes it easy to
@@ -39,7 +39,7 @@ public:
                            QList<Segment*> segments);
 
   /// Main entry point for creating all Segments for the filtered image.
-  void makeSegments (const QImage &imageFiltered,
+  void makeSegments (const BitPlane &bitsFiltered,
                      const DocumentModelSegments &modelSegments,
                      QList<Segment*> &segments,
                      bool useDlg = true);
@@ -47,56 +47,32 @@ public:
 private:
   SegmentFactory();
 
-  // Return the number of runs adjacent to the pixels from yStart to yStop (inclusive)
-  int adjacentRuns(bool *columnBool,
-                   int yStart,
-                   int yStop,
-                   int height);
-
-  // Find the single segment pointer among the adjacent pixels from yStart-1 to yStop+1
-  Segment *adjacentSegment(SegmentVector &lastSegment,
-                           int yStart,
-                           int yStop,
-                           int height);
-
-  // Return the number of segments adjacent to the pixels from yStart to yStop (inclusive)
-  int adjacentSegments(SegmentVector &lastSegment,
-                       int yStart,
-                       int yStop,
-                       int height);
-
-  // Process a run of pixels. If there are fewer than two adjacent pixel runs on
-  // either side, this run will be added to an existing segment, or the start of
-  // a new segment
-  void finishRun(bool *lastBool,
-                 bool *nextBool,
-                 SegmentVector &lastSegment,
-                 SegmentVector &currSegment,
+  // Column of the filtered image whose runs are examined in step x of makeSegments. See the implementation
+  static int columnForStep (int x,
+                            int width);
+
+  // Count the runs that are adjacent to the pixels from yStart to yStop (inclusive), including diagonally adjacent
+  // pixels. The search starts at index *first, which is advanced past runs that are above all later searches
+  static int countAdjacentRuns (const SegmentRunVector &runs,
+                                int *first,
+                                int yStart,
+                                int yStop);
+
+  // Process a run of pixels that is not at a branch point. This run will be added to an existing segment, or
+  // be the start of a new segment
+  void finishRun(SegmentRunVector &lastRuns,
+                 SegmentRun &run,
                  int x,
-                 int yStart,
-                 int yStop,
-                 int height,
-                 const DocumentModelSegments &modelSegments,
                  int* madeLines);
 
-  // Initialize one column of boolean flags using the pixels of the specified column
-  void loadBool (const ColorFilter &filter,
-                 bool *columnBool,
-                 const QImage &image,
-                 int x);
-
-  // Initialize one column of segment pointers
-  void loadSegment (SegmentVector &columnSegment,
-                    int height);
+  // Find the runs of each step in the strip, and link each run to the runs in the adjacent columns. This only reads the
+  // image runs, so strips can be processed in parallel
+  static void linkRunsInStrip (SegmentRunStrip &strip);
 
-  // Identify the runs in a column, and connect them to segments
+  // Connect the linked runs of a column to segments
   void matchRunsToSegments (int x,
-                            int height,
-                            bool *lastBool,
-                            SegmentVector &lastSegment,
-                            bool *currBool,
-                            SegmentVector &currSegment,
-                            bool *nextBool,
+                            SegmentRunVector &lastRuns,
+                            SegmentRunVector &currRuns,
                             const DocumentModelSegments &modelSegments,
                             int *madeLines,
                             int *foldedLines,
@@ -108,23 +84,20 @@ private:
 
   // Remove unneeded lines belonging to segments that just finished in the previous column.
   // The results of this function are displayed in the debug spew of makeSegments
-  void removeUnneededLines(SegmentVector &lastSegment,
-                           SegmentVector &currSegment,
-                           int height,
+  void removeUnneededLines(const SegmentRunVector &lastRuns,
                            int *foldedLines,
                            int *shortLines,
                            const DocumentModelSegments &modelSegments,
                            QList<Segment*> &segments);
 
-  // Scroll the boolean flags of the right column into the left column
-  void scrollBool(bool *left,
-                  bool *right,
-                  int height);
+  // Find the vertical runs of every column in one pass through the rows, which only visits the on pixels
+  QVector<SegmentRunVector> runsByColumn (const BitPlane &bits) const;
 
-  // Scroll the segment pointers of the right column into the left column
-  void scrollSegment(SegmentVector &left,
-                     SegmentVector &right,
-                     int height);
+  // Show progress, which is throttled so the dialog is updated only a few times per second. Returns true if the
+  // user canceled
+  bool updateProgress (QProgressDialog *dlg,
+                       QElapsedTimer &timer,
+                       int value) const;
 
   QGraphicsScene &m_scene;
 
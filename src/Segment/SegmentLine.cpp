@@ -9,6 +9,8 @@
 #include "GraphicsItemType.h"
 #include "Logger.h"
 #include <QGraphicsScene>
+#include <QPainterPath>
+#include <QPainterPathStroker>
 #include <QPen>
 #include "Segment.h"
 #include "SegmentLine.h"
@@ -83,6 +85,28 @@ void SegmentLine::setHover (bool hover)
     setPen (QPen (Qt::transparent));
 
   }
+
+  updateShape ();
+}
+
+void SegmentLine::setPolyline (const std::vector<QPoint> &points)
+{
+  QPainterPath path;
+  if (!points.empty ()) {
+
+    path.moveTo (points.front ());
+    for (unsigned int i = 1; i < points.size (); i++) {
+      path.lineTo (points [i]);
+    }
+  }
+
+  setPath (path);
+  updateShape ();
+}
+
+QPainterPath SegmentLine::shape() const
+{
+  return m_shape;
 }
 
 void SegmentLine::updateModelSegment(const DocumentModelSegments &modelSegments)
@@ -91,3 +115,12 @@ void SegmentLine::updateModelSegment(const DocumentModelSegments &modelSegments)
 
   m_modelSegments = modelSegments;
 }
+
+void SegmentLine::updateShape ()
+{
+  // Never thinner than the one pixel transparent pen of an unhighlighted line, so hovering still works
+  QPainterPathStroker stroker;
+  stroker.setWidth (qMax (pen ().widthF (), 1.0));
+
+  m_shape = stroker.createStroke (path ());
+}
@@ -8,13 +8,17 @@
 #define SEGMENT_LINE_H
 
 #include "DocumentModelSegments.h"
-#include <QGraphicsLineItem>
+#include <QGraphicsPathItem>
+#include <QPainterPath>
+#include <QPoint>
+#include <vector>
 
 class QGraphicsScene;
 class Segment;
 
-/// This class is a special case of the standard QGraphicsLineItem for segments.
-class SegmentLine : public QObject, public QGraphicsLineItem
+/// This class is a special case of the standard QGraphicsPathItem for segments. One SegmentLine draws all the lines
+/// of its Segment, as a single open path
+class SegmentLine : public QObject, public QGraphicsPathItem
 {
   Q_OBJECT;
 
@@ -25,7 +29,7 @@ public:
               Segment *segment);
   ~SegmentLine();
 
-  /// Highlight this and all other SegmentLines belonging to the same Segment upon hover enter
+  /// Highlight the owning Segment upon hover enter
   virtual void hoverEnterEvent(QGraphicsSceneHoverEvent *event);
 
   /// Unset highlighting triggered by hover enter
@@ -40,6 +44,14 @@ public:
   /// Apply/remove highlighting triggered by hover enter/leave
   void setHover (bool hover);
 
+  /// Set the path to the polyline through the specified points
+  void setPolyline (const std::vector<QPoint> &points);
+
+  /// Hover and mouse press area is just the stroked polyline. The default shape of QGraphicsPathItem includes the area
+  /// enclosed by the path, which for an open polyline would catch events far away from the Segment. The stroke is
+  /// cached, since the scene asks for the shape of every Segment under the cursor on each mouse move
+  virtual QPainterPath shape() const;
+
   /// Update this segment line with new settings
   void updateModelSegment(const DocumentModelSegments &modelSegments);
 
@@ -50,8 +62,12 @@ signals:
 private:
   SegmentLine();
 
+  // Recompute m_shape after the path or pen changes
+  void updateShape ();
+
   DocumentModelSegments m_modelSegments;
   Segment *m_segment;
+  QPainterPath m_shape;
 };
 
 #endif // SEGMENT_LINE_H
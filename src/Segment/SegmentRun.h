@@ -0,0 +1,72 @@
+/******************************************************************************************************
+ * (C) 2014 markummitchell@github.com. This file is part of Engauge Digitizer, which is released      *
+ * under GNU General Public License version 2 (GPLv2) or (at your option) any later version. See file *
+ * LICENSE or go to gnu.org/licenses for details. Distribution requires prior written permission.     *
+ ******************************************************************************************************/
+
+#ifndef SEGMENT_RUN_H
+#define SEGMENT_RUN_H
+
+#include <QVector>
+
+class Segment;
+
+/// Vertical run of on pixels in one column of the filtered image, which is the unit of work for SegmentFactory. Each run
+/// is linked to the run on its left, if there is exactly one, so a Segment is a chain of runs
+struct SegmentRun
+{
+  /// Constructor for a run that is not linked to a Segment yet
+  SegmentRun(int yStartIn = 0,
+             int yStopIn = 0) :
+    yStart (yStartIn),
+    yStop (yStopIn),
+    isBranch (false),
+    indexLeft (-1),
+    segment (0),
+    isContinued (false)
+  {
+  }
+
+  /// First row of the run
+  int yStart;
+
+  /// Last row of the run, inclusive
+  int yStop;
+
+  /// True if the run touches more than one run on its left or on its right, in which case it belongs to no Segment
+  bool isBranch;
+
+  /// Index of the single run that touches this run on its left, or -1 if there is not exactly one
+  int indexLeft;
+
+  /// Segment that this run belongs to, or zero if the run is at a branch point
+  Segment *segment;
+
+  /// True if the Segment of this run continues in the next column
+  bool isContinued;
+};
+
+/// Runs of one column, from top to bottom
+typedef QVector<SegmentRun> SegmentRunVector;
+
+/// Range of steps of SegmentFactory::makeSegments whose runs are linked together by one thread. The runs of each step
+/// depend only on the image, and not on the other steps, so strips need no merging afterwards
+struct SegmentRunStrip
+{
+  /// Runs of every column of the image, which are only read
+  const SegmentRunVector *columnRuns;
+
+  /// Width of the image
+  int width;
+
+  /// Runs of every step, which are written for the steps in this strip
+  SegmentRunVector *stepRuns;
+
+  /// First step of this strip
+  int xStart;
+
+  /// One past the last step of this strip
+  int xStop;
+};
+
+#endif // SEGMENT_RUN_H
@@ -20,6 +20,7 @@ const QString SETTINGS_CHECKLIST_GUIDE_DOCK_AREA ("checklistGuideDockArea");
 const QString SETTINGS_CHECKLIST_GUIDE_DOCK_GEOMETRY ("checklistGuideDockGeometry");
 const QString SETTINGS_CHECKLIST_GUIDE_WIZARD ("checklistGuideWizard");
 const QString SETTINGS_DRAG_DROP_EXPORT ("dragDropExport");
+const QString SETTINGS_FILTERED_IMAGE_CACHE_MEGABYTES ("filteredImageCacheMegabytes");
 const QString SETTINGS_FITTING_WINDOW_DOCK_AREA ("fittingWindowDockArea");
 const QString SETTINGS_FITTING_WINDOW_DOCK_GEOMETRY ("fittingWindowDockGeometry");
 const QString SETTINGS_GEOMETRY_WINDOW_DOCK_AREA ("geometryWIndowDockArea");
@@ -38,6 +38,7 @@ extern const QString SETTINGS_EXPORT_POINTS_INTERVAL_UNITS_RELATIONS;
 extern const QString SETTINGS_EXPORT_POINTS_SELECTION_FUNCTIONS;
 extern const QString SETTINGS_EXPORT_POINTS_SELECTION_RELATIONS;
 extern const QString SETTINGS_EXPORT_X_LABEL;
+extern const QString SETTINGS_FILTERED_IMAGE_CACHE_MEGABYTES;
 extern const QString SETTINGS_FITTING_WINDOW_DOCK_AREA;
 extern const QString SETTINGS_FITTING_WINDOW_DOCK_GEOMETRY;
 extern const QString SETTINGS_GENERAL_CURSOR_SIZE;
@@ -0,0 +1,253 @@
+#include "BitPlane.h"
+#include "ColorFilter.h"
+#include "Logger.h"
+#include "MainWindow.h"
+#include <QImage>
+#include <QStringList>
+#include <QtTest/QtTest>
+#include "Test/TestBitPlane.h"
+
+QTEST_MAIN (TestBitPlane)
+
+TestBitPlane::TestBitPlane(QObject *parent) :
+  QObject(parent)
+{
+}
+
+void TestBitPlane::cleanupTestCase ()
+{
+}
+
+void TestBitPlane::initTestCase ()
+{
+  const QString NO_ERROR_REPORT_LOG_FILE;
+  const QString NO_REGRESSION_OPEN_FILE;
+  const bool NO_GNUPLOT_LOG_FILES = false;
+  const bool NO_REGRESSION_IMPORT = false;
+  const bool NO_RESET = false;
+  const bool DEBUG_FLAG = false;
+  const QStringList NO_LOAD_STARTUP_FILES;
+
+  initializeLogging ("engauge_test",
+                     "engauge_test.log",
+                     DEBUG_FLAG);
+
+  MainWindow w (NO_ERROR_REPORT_LOG_FILE,
+                NO_REGRESSION_OPEN_FILE,
+                NO_GNUPLOT_LOG_FILES,
+                NO_REGRESSION_IMPORT,
+                NO_RESET,
+                NO_LOAD_STARTUP_FILES);
+  w.show ();
+}
+
+QImage TestBitPlane::loadSample (const QString &filename) const
+{
+  // The relative paths in this class will fail unless the directory is correct
+  QDir::setCurrent (QApplication::applicationDirPath());
+
+  QImage image (filename);
+  return image;
+}
+
+void TestBitPlane::testMatchesPixelFilteredIsOn ()
+{
+  // Unfiltered samples cover rgb, rgb with alpha and indexed (4 bit palette) png files, and a filtered image is added
+  QStringList samples;
+  samples << "../samples/corners.png"
+          << "../samples/normdist.png"
+          << "../samples/two_bumps.png"
+          << "../samples/gnuplot_x_y_lines_grid.png";
+
+  QList<QImage> images;
+  QStringList::const_iterator itr;
+  for (itr = samples.begin(); itr != samples.end(); itr++) {
+    QImage image = loadSample (*itr);
+    QVERIFY (!image.isNull ());
+    images << image;
+  }
+
+  ColorFilter filter;
+  QImage imageFiltered (images.first ().width (),
+                        images.first ().height (),
+                        QImage::Format_RGB32);
+  filter.filterImage (images.first (),
+                      imageFiltered,
+                      COLOR_FILTER_MODE_INTENSITY,
+                      0.0,
+                      0.5,
+                      filter.marginColor (&images.first ()));
+  images << imageFiltered;
+
+  bool success = true;
+
+  QList<QImage>::const_iterator itrImage;
+  for (itrImage = images.begin(); itrImage != images.end(); itrImage++) {
+
+    const QImage &image = *itrImage;
+    BitPlane bits (image);
+
+    // Include a border of pixels outside the image, which are off
+    for (int y = -1; y <= image.height (); y++) {
+      for (int x = -1; x <= image.width (); x++) {
+        if (bits.pixel (x, y) != filter.pixelFilteredIsOn (image, x, y)) {
+          success = false;
+        }
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
+
+void TestBitPlane::testNextPixelOn ()
+{
+  // Widths on either side of the word boundaries
+  const int WIDTHS [] = {1, 63, 64, 65, 127, 128, 200};
+  const int NUM_WIDTHS = 7;
+  const int HEIGHT = 5;
+
+  bool success = true;
+
+  qsrand (1);
+  for (int i = 0; i < NUM_WIDTHS; i++) {
+
+    int width = WIDTHS [i];
+    BitPlane bits (width,
+                   HEIGHT);
+
+    // Rows go from empty to dense
+    for (int y = 0; y < HEIGHT; y++) {
+      for (int x = 0; x < width; x++) {
+        if (qrand () % HEIGHT < y) {
+          bits.setPixel (x, y, true);
+        }
+      }
+    }
+
+    for (int y = 0; y < HEIGHT; y++) {
+      for (int xStart = 0; xStart <= width; xStart++) {
+
+        int xExpected = xStart;
+        while ((xExpected < width) && !bits.pixel (xExpected, y)) {
+          ++xExpected;
+        }
+
+        if (bits.nextPixelOn (xStart, y) != xExpected) {
+          qDebug () << "Mismatch for width" << width << "row" << y << "start" << xStart;
+          success = false;
+        }
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
+
+void TestBitPlane::testPixels64 ()
+{
+  // Widths on either side of the word boundaries
+  const int WIDTHS [] = {1, 63, 64, 65, 127, 128, 200};
+  const int NUM_WIDTHS = 7;
+  const int HEIGHT = 3;
+
+  bool success = true;
+
+  qsrand (1);
+  for (int i = 0; i < NUM_WIDTHS; i++) {
+
+    int width = WIDTHS [i];
+    BitPlane bits (width,
+                   HEIGHT);
+
+    for (int y = 0; y < HEIGHT; y++) {
+      for (int x = 0; x < width; x++) {
+        if (qrand () % 2 == 0) {
+          bits.setPixel (x, y, true);
+        }
+      }
+    }
+
+    // Rows and starting columns outside the bit plane are included, since those pixels must be off
+    for (int y = -1; y <= HEIGHT; y++) {
+      for (int xStart = -70; xStart <= width + 1; xStart++) {
+
+        quint64 wordExpected = 0;
+        for (int bit = 0; bit < 64; bit++) {
+          if (bits.pixel (xStart + bit, y)) {
+            wordExpected |= ((quint64) 1 << bit);
+          }
+        }
+
+        if (bits.pixels64 (xStart, y) != wordExpected) {
+          qDebug () << "Mismatch for width" << width << "row" << y << "start" << xStart;
+          success = false;
+        }
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
+
+void TestBitPlane::testToImageRoundTrip ()
+{
+  const int WIDTH = 100;
+  const int HEIGHT = 30;
+
+  BitPlane bits (WIDTH,
+                 HEIGHT);
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      if ((x * y) % 7 == 0) {
+        bits.setPixel (x, y, true);
+      }
+    }
+  }
+
+  BitPlane bitsRoundTrip (bits.toImage ());
+
+  bool success = (bitsRoundTrip.width () == WIDTH) &&
+                 (bitsRoundTrip.height () == HEIGHT);
+  for (int y = 0; success && (y < HEIGHT); y++) {
+    for (int i = 0; i < bits.wordsPerLine (); i++) {
+      if (bits.constScanLine (y) [i] != bitsRoundTrip.constScanLine (y) [i]) {
+        success = false;
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
+
+void TestBitPlane::testToPixmapMatchesToImage ()
+{
+  // Width that is not a multiple of the word size, so the last word of each row is partial
+  const int WIDTH = 100;
+  const int HEIGHT = 30;
+
+  BitPlane bits (WIDTH,
+                 HEIGHT);
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      if ((x * y) % 7 == 0) {
+        bits.setPixel (x, y, true);
+      }
+    }
+  }
+
+  QImage image = bits.toImage ();
+  QImage imageFromPixmap = bits.toPixmap ().toImage ();
+
+  bool success = (imageFromPixmap.width () == WIDTH) &&
+                 (imageFromPixmap.height () == HEIGHT);
+  for (int y = 0; success && (y < HEIGHT); y++) {
+    for (int x = 0; x < WIDTH; x++) {
+      if (image.pixel (x, y) != imageFromPixmap.pixel (x, y)) {
+        success = false;
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
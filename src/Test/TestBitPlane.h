@@ -0,0 +1,32 @@
+#ifndef TEST_BIT_PLANE_H
+#define TEST_BIT_PLANE_H
+
+#include <QObject>
+
+class QImage;
+
+/// Unit tests of BitPlane class
+class TestBitPlane : public QObject
+{
+  Q_OBJECT
+public:
+  /// Single constructor.
+  explicit TestBitPlane(QObject *parent = 0);
+
+signals:
+
+private slots:
+  void cleanupTestCase ();
+  void initTestCase ();
+
+  void testMatchesPixelFilteredIsOn ();
+  void testNextPixelOn ();
+  void testPixels64 ();
+  void testToImageRoundTrip ();
+  void testToPixmapMatchesToImage ();
+
+private:
+  QImage loadSample (const QString &filename) const;
+};
+
+#endif // TEST_BIT_PLANE_H
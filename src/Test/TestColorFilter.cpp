@@ -0,0 +1,450 @@
+#include "BitPlane.h"
+#include "ColorFilter.h"
+#include "ColorFilterHistogram.h"
+#include "ColorFilterLevels.h"
+#include "Logger.h"
+#include "MainWindow.h"
+#include <QColor>
+#include <QImage>
+#include <QList>
+#include <QPixmap>
+#include <QStringList>
+#include <QVector>
+#include <QtTest/QtTest>
+#include "Test/TestColorFilter.h"
+
+QTEST_MAIN (TestColorFilter)
+
+using namespace std;
+
+// Large sample so the benchmark is dominated by the per-pixel work
+const QString BENCHMARK_SAMPLE ("../samples/huge.png");
+
+TestColorFilter::TestColorFilter(QObject *parent) :
+  QObject(parent)
+{
+}
+
+void TestColorFilter::benchmarkFilterImagePixelByPixel ()
+{
+  ColorFilter filter;
+  QImage imageOriginal = loadSample (BENCHMARK_SAMPLE);
+  QImage imageFiltered (imageOriginal.width (),
+                        imageOriginal.height (),
+                        QImage::Format_RGB32);
+  QRgb rgbBackground = filter.marginColor (&imageOriginal);
+
+  QBENCHMARK {
+    filterImagePixelByPixel (filter,
+                             imageOriginal,
+                             imageFiltered,
+                             COLOR_FILTER_MODE_HUE,
+                             0.5,
+                             1.0,
+                             rgbBackground);
+  }
+}
+
+void TestColorFilter::benchmarkFilterImageScanLines ()
+{
+  ColorFilter filter;
+  QImage imageOriginal = loadSample (BENCHMARK_SAMPLE);
+  QImage imageFiltered (imageOriginal.width (),
+                        imageOriginal.height (),
+                        QImage::Format_RGB32);
+  QRgb rgbBackground = filter.marginColor (&imageOriginal);
+
+  QBENCHMARK {
+    filter.filterImage (imageOriginal,
+                        imageFiltered,
+                        COLOR_FILTER_MODE_HUE,
+                        0.5,
+                        1.0,
+                        rgbBackground);
+  }
+}
+
+void TestColorFilter::cleanupTestCase ()
+{
+}
+
+void TestColorFilter::filterImagePixelByPixel (const ColorFilter &filter,
+                                               const QImage &imageOriginal,
+                                               QImage &imageFiltered,
+                                               ColorFilterMode colorFilterMode,
+                                               double low,
+                                               double high,
+                                               QRgb rgbBackground) const
+{
+  for (int x = 0; x < imageOriginal.width(); x++) {
+    for (int y = 0; y < imageOriginal.height (); y++) {
+
+      QColor pixel = imageOriginal.pixel (x, y);
+      bool isOn = false;
+      if (pixel.rgb() != rgbBackground) {
+
+        isOn = filter.pixelUnfilteredIsOn (colorFilterMode,
+                                           pixel,
+                                           rgbBackground,
+                                           low,
+                                           high);
+      }
+
+      imageFiltered.setPixel (x, y, (isOn ?
+                                     QColor (Qt::black).rgb () :
+                                     QColor (Qt::white).rgb ()));
+    }
+  }
+}
+
+void TestColorFilter::initTestCase ()
+{
+  const QString NO_ERROR_REPORT_LOG_FILE;
+  const QString NO_REGRESSION_OPEN_FILE;
+  const bool NO_GNUPLOT_LOG_FILES = false;
+  const bool NO_REGRESSION_IMPORT = false;
+  const bool NO_RESET = false;
+  const bool DEBUG_FLAG = false;
+  const QStringList NO_LOAD_STARTUP_FILES;
+
+  initializeLogging ("engauge_test",
+                     "engauge_test.log",
+                     DEBUG_FLAG);
+
+  MainWindow w (NO_ERROR_REPORT_LOG_FILE,
+                NO_REGRESSION_OPEN_FILE,
+                NO_GNUPLOT_LOG_FILES,
+                NO_REGRESSION_IMPORT,
+                NO_RESET,
+                NO_LOAD_STARTUP_FILES);
+  w.show ();
+}
+
+QImage TestColorFilter::loadSample (const QString &filename) const
+{
+  // The relative paths in this class will fail unless the directory is correct
+  QDir::setCurrent (QApplication::applicationDirPath());
+
+  QImage image (filename);
+  return image;
+}
+
+QRgb TestColorFilter::marginColorLinearSearch (const ColorFilter &filter,
+                                               const QImage &image) const
+{
+  QList<QColor> colors;
+  QList<int> counts;
+
+  // Borders are visited in the original order, since that order decides ties
+  QList<QRgb> pixels;
+  for (int x = 0; x < image.width (); x++) {
+    pixels << image.pixel (x, 0);
+    pixels << image.pixel (x, image.height () - 1);
+  }
+  for (int y = 0; y < image.height (); y++) {
+    pixels << image.pixel (0, y);
+    pixels << image.pixel (image.width () - 1, y);
+  }
+
+  QList<QRgb>::const_iterator itrPixel;
+  for (itrPixel = pixels.begin (); itrPixel != pixels.end (); itrPixel++) {
+
+    QColor color (*itrPixel);
+    bool found = false;
+    for (int i = 0; i < colors.count (); i++) {
+      if (filter.colorCompare (color.rgb (),
+                               colors [i].rgb ())) {
+        found = true;
+        ++counts [i];
+        break;
+      }
+    }
+
+    if (!found) {
+      colors << color;
+      counts << 0;
+    }
+  }
+
+  QColor colorMax;
+  int countMax = 0;
+  for (int i = 0; i < colors.count (); i++) {
+    if (counts [i] > countMax) {
+      colorMax = colors [i];
+      countMax = counts [i];
+    }
+  }
+
+  return colorMax.rgb ();
+}
+
+void TestColorFilter::testFilterImageMatchesPixelByPixel ()
+{
+  // Samples cover rgb, rgb with alpha and indexed (4 bit palette) png files, and a premultiplied image
+  QStringList samples;
+  samples << "../samples/corners.png"
+          << "../samples/normdist.png"
+          << "../samples/two_bumps.png"
+          << "../samples/gnuplot_x_y_lines_grid.png";
+
+  // Second range wraps around, with low greater than high
+  const double LOWS [] = {0.0, 0.7};
+  const double HIGHS [] = {0.5, 0.2};
+  const int NUM_RANGES = 2;
+
+  ColorFilter filter;
+  bool success = true;
+
+  QList<QImage> images;
+  QStringList::const_iterator itr;
+  for (itr = samples.begin(); itr != samples.end(); itr++) {
+    images << loadSample (*itr);
+    QVERIFY (!images.last ().isNull ());
+  }
+
+  // Premultiplied copy with semi-transparent pixels, which is what QPixmap::toImage usually gives for a png with
+  // alpha. None of the samples has semi-transparent pixels
+  QImage imageTranslucent = loadSample (samples.at (2)).convertToFormat (QImage::Format_ARGB32);
+  for (int y = 0; y < imageTranslucent.height (); y++) {
+    QRgb *line = (QRgb *) imageTranslucent.scanLine (y);
+    for (int x = 0; x < imageTranslucent.width (); x++) {
+      line [x] = qRgba (qRed (line [x]),
+                        qGreen (line [x]),
+                        qBlue (line [x]),
+                        64 + (x + y) % 192);
+    }
+  }
+  images << imageTranslucent.convertToFormat (QImage::Format_ARGB32_Premultiplied);
+  samples << "translucent premultiplied copy of " + samples.at (2);
+
+  for (int index = 0; index < images.count (); index++) {
+
+    const QImage &imageOriginal = images.at (index);
+    QRgb rgbBackground = filter.marginColor (&imageOriginal);
+
+    for (int mode = 0; mode < NUM_COLOR_FILTER_MODES; mode++) {
+      for (int range = 0; range < NUM_RANGES; range++) {
+
+        QImage imageExpected (imageOriginal.width (),
+                              imageOriginal.height (),
+                              QImage::Format_RGB32);
+        QImage imageActual (imageOriginal.width (),
+                            imageOriginal.height (),
+                            QImage::Format_RGB32);
+
+        filterImagePixelByPixel (filter,
+                                 imageOriginal,
+                                 imageExpected,
+                                 (ColorFilterMode) mode,
+                                 LOWS [range],
+                                 HIGHS [range],
+                                 rgbBackground);
+        filter.filterImage (imageOriginal,
+                            imageActual,
+                            (ColorFilterMode) mode,
+                            LOWS [range],
+                            HIGHS [range],
+                            rgbBackground);
+
+        if (imageActual != imageExpected) {
+          qDebug () << "Mismatch for" << samples.at (index) << "mode" << colorFilterModeToString ((ColorFilterMode) mode);
+          success = false;
+        }
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
+
+void TestColorFilter::testHistogramMatchesPixelByPixel ()
+{
+  QStringList samples;
+  samples << "../samples/corners.png"
+          << "../samples/normdist.png"
+          << "../samples/two_bumps.png"
+          << "../samples/gnuplot_x_y_lines_grid.png";
+
+  ColorFilter filter;
+  ColorFilterHistogram filterHistogram;
+  QVector<double> histogramBins (ColorFilterHistogram::HISTOGRAM_BINS ());
+  bool success = true;
+
+  QStringList::const_iterator itr;
+  for (itr = samples.begin(); itr != samples.end(); itr++) {
+
+    QImage image = loadSample (*itr);
+    QVERIFY (!image.isNull ());
+
+    QPixmap pixmap = QPixmap::fromImage (image);
+    QRgb rgbBackground = filter.marginColor (&image);
+
+    for (int mode = 0; mode < NUM_COLOR_FILTER_MODES; mode++) {
+
+      // Original implementation, with one QColor per pixel
+      QVector<double> histogramBinsExpected (ColorFilterHistogram::HISTOGRAM_BINS (), 0.0);
+      int maxBinCountExpected = 0;
+      for (int y = 0; y < image.height (); y++) {
+        for (int x = 0; x < image.width (); x++) {
+
+          int bin = filterHistogram.binFromPixel (filter,
+                                                  (ColorFilterMode) mode,
+                                                  QColor (image.pixel (x, y)),
+                                                  rgbBackground);
+          if (bin >= 0) {
+            ++(histogramBinsExpected [bin]);
+            maxBinCountExpected = qMax (maxBinCountExpected, (int) histogramBinsExpected [bin]);
+          }
+        }
+      }
+
+      // Modes after the first come from the cached histograms of all modes
+      int maxBinCount;
+      filterHistogram.generate (filter,
+                                histogramBins.data (),
+                                (ColorFilterMode) mode,
+                                pixmap,
+                                maxBinCount);
+
+      if ((histogramBins != histogramBinsExpected) ||
+          (maxBinCount != maxBinCountExpected)) {
+        qDebug () << "Mismatch for" << *itr << "mode" << colorFilterModeToString ((ColorFilterMode) mode);
+        success = false;
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
+
+void TestColorFilter::testHsvMatchesQColor ()
+{
+  // Hue, saturation and value are computed from raw QRgb values without QColor, and must agree exactly with QColor
+  const int STEP = 3;
+  const QRgb NO_BACKGROUND = 0;
+
+  ColorFilter filter;
+  bool success = true;
+
+  for (int r = 0; r < 256; r += STEP) {
+    for (int g = 0; g < 256; g += STEP) {
+      for (int b = 0; b < 256; b += STEP) {
+
+        QColor pixel (r, g, b);
+
+        if ((filter.pixelToZeroToOneOrMinusOne (COLOR_FILTER_MODE_HUE, pixel, NO_BACKGROUND) != pixel.hueF ()) ||
+            (filter.pixelToZeroToOneOrMinusOne (COLOR_FILTER_MODE_SATURATION, pixel, NO_BACKGROUND) != pixel.saturationF ()) ||
+            (filter.pixelToZeroToOneOrMinusOne (COLOR_FILTER_MODE_VALUE, pixel, NO_BACKGROUND) != pixel.valueF ())) {
+          qDebug () << "Mismatch for" << r << g << b;
+          success = false;
+        }
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
+
+void TestColorFilter::testLevelsMatchFilterImage ()
+{
+  QStringList samples;
+  samples << "../samples/corners.png"
+          << "../samples/normdist.png"
+          << "../samples/two_bumps.png"
+          << "../samples/gnuplot_x_y_lines_grid.png";
+
+  // Ranges include thresholds from settings values (like 120 degrees of hue, or 30 percent), thresholds that are
+  // quantization level boundaries, an empty range and a range that wraps around
+  const double LOWS [] = {0.0, 0.7, 120.0 / 360.0, 0.3, 2.0 / 255.0, 0.5};
+  const double HIGHS [] = {0.5, 0.2, 240.0 / 360.0, 1.0, 200.0 / 255.0, 0.5};
+  const int NUM_RANGES = 6;
+
+  ColorFilter filter;
+  bool success = true;
+
+  QStringList::const_iterator itr;
+  for (itr = samples.begin(); itr != samples.end(); itr++) {
+
+    QImage imageOriginal = loadSample (*itr);
+    QVERIFY (!imageOriginal.isNull ());
+
+    QRgb rgbBackground = filter.marginColor (&imageOriginal);
+
+    for (int mode = 0; mode < NUM_COLOR_FILTER_MODES; mode++) {
+
+      ColorFilterLevels levels (imageOriginal,
+                                (ColorFilterMode) mode,
+                                rgbBackground);
+
+      for (int range = 0; range < NUM_RANGES; range++) {
+
+        QImage imageExpected (imageOriginal.width (),
+                              imageOriginal.height (),
+                              QImage::Format_RGB32);
+        BitPlane bitsActual (imageOriginal.width (),
+                             imageOriginal.height ());
+
+        filter.filterImage (imageOriginal,
+                            imageExpected,
+                            (ColorFilterMode) mode,
+                            LOWS [range],
+                            HIGHS [range],
+                            rgbBackground);
+        levels.threshold (LOWS [range],
+                          HIGHS [range],
+                          bitsActual);
+
+        // Filtered images are compared as bit planes, which is what the preview is sent as
+        BitPlane bitsExpected (imageExpected);
+        bool isSame = true;
+        for (int y = 0; y < bitsExpected.height (); y++) {
+          for (int i = 0; i < bitsExpected.wordsPerLine (); i++) {
+            if (bitsActual.constScanLine (y) [i] != bitsExpected.constScanLine (y) [i]) {
+              isSame = false;
+            }
+          }
+        }
+
+        if (!isSame) {
+          qDebug () << "Mismatch for" << *itr << "mode" << colorFilterModeToString ((ColorFilterMode) mode)
+                    << "range" << range;
+          success = false;
+        }
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
+
+void TestColorFilter::testMarginColorMatchesLinearSearch ()
+{
+  QStringList samples;
+  samples << "../samples/corners.png"
+          << "../samples/normdist.png"
+          << "../samples/two_bumps.png"
+          << "../samples/gnuplot_x_y_lines_grid.png";
+
+  ColorFilter filter;
+  bool success = true;
+
+  QStringList::const_iterator itr;
+  for (itr = samples.begin(); itr != samples.end(); itr++) {
+
+    QImage image = loadSample (*itr);
+    QVERIFY (!image.isNull ());
+
+    QRgb rgbExpected = marginColorLinearSearch (filter,
+                                                image);
+
+    // Second call exercises the cached result, and the pixmap version has its own cache
+    if ((filter.marginColor (&image) != rgbExpected) ||
+        (filter.marginColor (&image) != rgbExpected) ||
+        (filter.marginColor (QPixmap::fromImage (image)) != rgbExpected)) {
+      qDebug () << "Mismatch for" << *itr;
+      success = false;
+    }
+  }
+
+  QVERIFY (success);
+}
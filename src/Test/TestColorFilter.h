@@ -0,0 +1,50 @@
+#ifndef TEST_COLOR_FILTER_H
+#define TEST_COLOR_FILTER_H
+
+#include "ColorFilterMode.h"
+#include <QObject>
+#include <QRgb>
+
+class ColorFilter;
+class QImage;
+
+/// Unit test and benchmark of ColorFilter class
+class TestColorFilter : public QObject
+{
+  Q_OBJECT
+public:
+  /// Single constructor.
+  explicit TestColorFilter(QObject *parent = 0);
+
+signals:
+
+private slots:
+  void cleanupTestCase ();
+  void initTestCase ();
+
+  void benchmarkFilterImagePixelByPixel ();
+  void benchmarkFilterImageScanLines ();
+  void testFilterImageMatchesPixelByPixel ();
+  void testHistogramMatchesPixelByPixel ();
+  void testHsvMatchesQColor ();
+  void testLevelsMatchFilterImage ();
+  void testMarginColorMatchesLinearSearch ();
+
+private:
+  // Original column-major implementation of ColorFilter::filterImage, with QImage::pixel and one QColor per pixel, which
+  // serves as the reference for correctness and speed
+  void filterImagePixelByPixel (const ColorFilter &filter,
+                                const QImage &imageOriginal,
+                                QImage &imageFiltered,
+                                ColorFilterMode colorFilterMode,
+                                double low,
+                                double high,
+                                QRgb rgbBackground) const;
+  QImage loadSample (const QString &filename) const;
+
+  // Original implementation of ColorFilter::marginColor, with a linear search through the list of colors seen so far
+  QRgb marginColorLinearSearch (const ColorFilter &filter,
+                                const QImage &image) const;
+};
+
+#endif // TEST_COLOR_FILTER_H
@@ -0,0 +1,169 @@
+#include "ColorFilter.h"
+#include "ColorFilterSimd.h"
+#include "Logger.h"
+#include "MainWindow.h"
+#include <QColor>
+#include <QStringList>
+#include <QtTest/QtTest>
+#include <QVector>
+#include "Test/TestColorFilterSimd.h"
+
+QTEST_MAIN (TestColorFilterSimd)
+
+using namespace std;
+
+// Colors are processed in chunks that are not a multiple of the vector sizes, so the scalar tail code is exercised too
+const int CHUNK_SIZE = 4099;
+
+// Arbitrary background color for the foreground mode
+const QRgb RGB_BACKGROUND = 0xffe0d0c0;
+
+TestColorFilterSimd::TestColorFilterSimd(QObject *parent) :
+  QObject(parent)
+{
+}
+
+void TestColorFilterSimd::cleanupTestCase ()
+{
+}
+
+bool TestColorFilterSimd::compareAllColors (ColorFilterSimd::InstructionSet instructionSet,
+                                            ColorFilterMode colorFilterMode) const
+{
+  if (instructionSet > ColorFilterSimd::instructionSetSupported ()) {
+    qDebug () << "Skipping instruction set" << instructionSet << "since it is not supported by this cpu";
+    return true;
+  }
+
+  const int NUM_COLORS = 256 * 256 * 256;
+
+  ColorFilter filter;
+  ColorFilterSimd simd (instructionSet);
+  QVector<QRgb> pixels (CHUNK_SIZE);
+  QVector<double> valuesVectorized (CHUNK_SIZE);
+
+  for (int chunkStart = 0; chunkStart < NUM_COLORS; chunkStart += CHUNK_SIZE) {
+
+    int count = qMin (CHUNK_SIZE, NUM_COLORS - chunkStart);
+    for (int i = 0; i < count; i++) {
+      pixels [i] = 0xff000000 | (chunkStart + i);
+    }
+
+    int processed = 0;
+    switch (colorFilterMode) {
+      case COLOR_FILTER_MODE_FOREGROUND:
+        processed = simd.distance (pixels.constData (), count, RGB_BACKGROUND, valuesVectorized.data ());
+        break;
+
+      case COLOR_FILTER_MODE_HUE:
+        processed = simd.hue (pixels.constData (), count, valuesVectorized.data ());
+        break;
+
+      case COLOR_FILTER_MODE_INTENSITY:
+        processed = simd.distance (pixels.constData (), count, qRgb (0, 0, 0), valuesVectorized.data ());
+        break;
+
+      case COLOR_FILTER_MODE_SATURATION:
+        processed = simd.saturation (pixels.constData (), count, valuesVectorized.data ());
+        break;
+
+      case COLOR_FILTER_MODE_VALUE:
+        processed = simd.value (pixels.constData (), count, valuesVectorized.data ());
+        break;
+
+      default:
+        return false;
+    }
+
+    if (processed == 0) {
+      return false;
+    }
+
+    for (int i = 0; i < processed; i++) {
+      double valueScalar = filter.pixelToZeroToOneOrMinusOne (colorFilterMode,
+                                                              QColor (pixels [i]),
+                                                              RGB_BACKGROUND);
+      if (valueScalar != valuesVectorized [i]) {
+        qDebug () << "Mismatch for" << QString::number (pixels [i], 16)
+                  << "scalar" << QString::number (valueScalar, 'g', 17)
+                  << "vectorized" << QString::number (valuesVectorized [i], 'g', 17);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void TestColorFilterSimd::initTestCase ()
+{
+  const QString NO_ERROR_REPORT_LOG_FILE;
+  const QString NO_REGRESSION_OPEN_FILE;
+  const bool NO_GNUPLOT_LOG_FILES = false;
+  const bool NO_REGRESSION_IMPORT = false;
+  const bool NO_RESET = false;
+  const bool DEBUG_FLAG = false;
+  const QStringList NO_LOAD_STARTUP_FILES;
+
+  initializeLogging ("engauge_test",
+                     "engauge_test.log",
+                     DEBUG_FLAG);
+
+  MainWindow w (NO_ERROR_REPORT_LOG_FILE,
+                NO_REGRESSION_OPEN_FILE,
+                NO_GNUPLOT_LOG_FILES,
+                NO_REGRESSION_IMPORT,
+                NO_RESET,
+                NO_LOAD_STARTUP_FILES);
+  w.show ();
+}
+
+void TestColorFilterSimd::testForegroundAvx2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_AVX2, COLOR_FILTER_MODE_FOREGROUND));
+}
+
+void TestColorFilterSimd::testForegroundSse2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_SSE2, COLOR_FILTER_MODE_FOREGROUND));
+}
+
+void TestColorFilterSimd::testHueAvx2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_AVX2, COLOR_FILTER_MODE_HUE));
+}
+
+void TestColorFilterSimd::testHueSse2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_SSE2, COLOR_FILTER_MODE_HUE));
+}
+
+void TestColorFilterSimd::testIntensityAvx2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_AVX2, COLOR_FILTER_MODE_INTENSITY));
+}
+
+void TestColorFilterSimd::testIntensitySse2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_SSE2, COLOR_FILTER_MODE_INTENSITY));
+}
+
+void TestColorFilterSimd::testSaturationAvx2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_AVX2, COLOR_FILTER_MODE_SATURATION));
+}
+
+void TestColorFilterSimd::testSaturationSse2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_SSE2, COLOR_FILTER_MODE_SATURATION));
+}
+
+void TestColorFilterSimd::testValueAvx2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_AVX2, COLOR_FILTER_MODE_VALUE));
+}
+
+void TestColorFilterSimd::testValueSse2 ()
+{
+  QVERIFY (compareAllColors (ColorFilterSimd::INSTRUCTION_SET_SSE2, COLOR_FILTER_MODE_VALUE));
+}
@@ -0,0 +1,39 @@
+#ifndef TEST_COLOR_FILTER_SIMD_H
+#define TEST_COLOR_FILTER_SIMD_H
+
+#include "ColorFilterMode.h"
+#include "ColorFilterSimd.h"
+#include <QObject>
+
+/// Unit test of vectorized color filter computations, which must match the scalar strategies bit for bit
+class TestColorFilterSimd : public QObject
+{
+  Q_OBJECT
+public:
+  /// Single constructor.
+  explicit TestColorFilterSimd(QObject *parent = 0);
+
+signals:
+
+private slots:
+  void cleanupTestCase ();
+  void initTestCase ();
+
+  void testForegroundAvx2 ();
+  void testForegroundSse2 ();
+  void testHueAvx2 ();
+  void testHueSse2 ();
+  void testIntensityAvx2 ();
+  void testIntensitySse2 ();
+  void testSaturationAvx2 ();
+  void testSaturationSse2 ();
+  void testValueAvx2 ();
+  void testValueSse2 ();
+
+private:
+  // Compare vectorized and scalar results for every 24 bit color. Returns true if instruction set is not supported
+  bool compareAllColors (ColorFilterSimd::InstructionSet instructionSet,
+                         ColorFilterMode colorFilterMode) const;
+};
+
+#endif // TEST_COLOR_FILTER_SIMD_H
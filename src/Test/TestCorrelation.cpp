@@ -191,3 +191,44 @@ void TestCorrelation::testShiftThreeTrianglesPowerOf2 ()
 
   QVERIFY ((binStartMax = INDEX_SHIFT));
 }
+
+void TestCorrelation::testSpectrumMatchesShift ()
+{
+  const int N = 1000; // Non power of  2
+  const int INDEX_MAX = 200, INDEX_SHIFT = 50, SHIFTS = 3;
+  const double EPSILON = 1e-12;
+
+  int binStartMaxShift, binStartMaxSpectrum;
+  double function1 [N], function2 [N], correlationsShift [N], correlationsSpectrum [N];
+  double corrMaxShift, corrMaxSpectrum;
+
+  Correlation correlation (N);
+
+  // Same function1 for every function2, like the grid line step search
+  loadThreeTriangles (function1, N, INDEX_MAX);
+  correlation.loadSpectrum (N,
+                            function1);
+
+  for (int shift = 1; shift <= SHIFTS; shift++) {
+
+    loadThreeTriangles (function2, N, INDEX_MAX + shift * INDEX_SHIFT);
+
+    correlation.correlateWithShift (N,
+                                    function1,
+                                    function2,
+                                    binStartMaxShift,
+                                    corrMaxShift,
+                                    correlationsShift);
+    correlation.correlateWithSpectrum (N,
+                                       function2,
+                                       binStartMaxSpectrum,
+                                       corrMaxSpectrum,
+                                       correlationsSpectrum);
+
+    QCOMPARE (binStartMaxSpectrum, binStartMaxShift);
+    QVERIFY (qAbs (corrMaxSpectrum - corrMaxShift) < EPSILON);
+    for (int i = 0; i < N; i++) {
+      QVERIFY (qAbs (correlationsSpectrum [i] - correlationsShift [i]) < EPSILON);
+    }
+  }
+}
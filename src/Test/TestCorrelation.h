@@ -27,6 +27,7 @@ private slots:
   void testShiftSinusoidPowerOf2 ();
   void testShiftThreeTrianglesNonPowerOf2 ();
   void testShiftThreeTrianglesPowerOf2 ();
+  void testSpectrumMatchesShift ();
 
 private:
 
@@ -0,0 +1,495 @@
+#include "BitPlane.h"
+#include "DocumentModelPointMatch.h"
+#include "Logger.h"
+#include "MainWindow.h"
+#include "PointMatchAlgorithm.h"
+#include "PointMatchSession.h"
+#include "Points.h"
+#include <qmath.h>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QtTest/QtTest>
+#include "Test/TestPointMatch.h"
+
+QTEST_MAIN (TestPointMatch)
+
+using namespace std;
+
+// Image size is deliberately not a power of two, so the padding in the transforms is exercised
+const int IMAGE_WIDTH = 203;
+const int IMAGE_HEIGHT = 151;
+
+// Points are big enough that coarse to fine matching downsamples them
+const int MARKER_RADIUS = 8; // Arms of each cross
+const double MAX_POINT_SIZE = 21;
+
+const bool NO_GNUPLOT = false;
+
+TestPointMatch::TestPointMatch(QObject *parent) :
+  QObject(parent)
+{
+  m_markers << QPoint (40, 30)
+            << QPoint (120, 50)
+            << QPoint (70, 110)
+            << QPoint (165, 125);
+}
+
+BitPlane TestPointMatch::bitPlaneWithMarkers () const
+{
+  BitPlane bits (IMAGE_WIDTH,
+                 IMAGE_HEIGHT);
+
+  for (int i = 0; i < m_markers.count (); i++) {
+
+    const QPoint &marker = m_markers.at (i);
+    for (int delta = -MARKER_RADIUS; delta <= MARKER_RADIUS; delta++) {
+      bits.setPixel (marker.x () + delta, marker.y (), true);
+      bits.setPixel (marker.x (), marker.y () + delta, true);
+    }
+  }
+
+  return bits;
+}
+
+void TestPointMatch::cleanupTestCase ()
+{
+}
+
+bool TestPointMatch::firstMatchesAreEqual (const QList<QPoint> &points1,
+                                           const QList<QPoint> &points2) const
+{
+  if ((points1.count () < m_markers.count ()) ||
+      (points2.count () < m_markers.count ())) {
+    return false;
+  }
+
+  QSet<QPair<int, int> > set1, set2;
+  for (int i = 0; i < m_markers.count (); i++) {
+    set1.insert (QPair<int, int> (points1.at (i).x (), points1.at (i).y ()));
+    set2.insert (QPair<int, int> (points2.at (i).x (), points2.at (i).y ()));
+  }
+
+  return (set1 == set2);
+}
+
+QList<QPoint> TestPointMatch::findPoints (PointMatchAlgorithm::Precision precision,
+                                          bool coarseToFine,
+                                          bool templateBank) const
+{
+  BitPlane bits = bitPlaneWithMarkers ();
+
+  DocumentModelPointMatch modelPointMatch;
+  modelPointMatch.setMaxPointSize (MAX_POINT_SIZE);
+  modelPointMatch.setCoarseToFine (coarseToFine);
+  modelPointMatch.setTemplateBank (templateBank);
+
+  PointMatchSession session;
+  PointMatchAlgorithm algorithm (NO_GNUPLOT,
+                                 precision);
+
+  return algorithm.findPoints (samplePointPixels (bits,
+                                                  m_markers.first ()),
+                               bits,
+                               modelPointMatch,
+                               Points (),
+                               session);
+}
+
+void TestPointMatch::initTestCase ()
+{
+  const QString NO_ERROR_REPORT_LOG_FILE;
+  const QString NO_REGRESSION_OPEN_FILE;
+  const bool NO_GNUPLOT_LOG_FILES = false;
+  const bool NO_REGRESSION_IMPORT = false;
+  const bool NO_RESET = false;
+  const bool DEBUG_FLAG = false;
+  const QStringList NO_LOAD_STARTUP_FILES;
+
+  initializeLogging ("engauge_test",
+                     "engauge_test.log",
+                     DEBUG_FLAG);
+
+  MainWindow w (NO_ERROR_REPORT_LOG_FILE,
+                NO_REGRESSION_OPEN_FILE,
+                NO_GNUPLOT_LOG_FILES,
+                NO_REGRESSION_IMPORT,
+                NO_RESET,
+                NO_LOAD_STARTUP_FILES);
+  w.show ();
+}
+
+bool TestPointMatch::markersAreFirstMatches (const QList<QPoint> &points) const
+{
+  if (points.count () < m_markers.count ()) {
+    qDebug () << "Only" << points.count () << "matches were found";
+    return false;
+  }
+
+  for (int i = 0; i < m_markers.count (); i++) {
+
+    bool found = false;
+    for (int j = 0; j < m_markers.count (); j++) {
+      QPoint delta = points.at (j) - m_markers.at (i);
+      if ((qAbs (delta.x ()) <= 1) && (qAbs (delta.y ()) <= 1)) {
+        found = true;
+      }
+    }
+
+    if (!found) {
+      qDebug () << "Marker" << m_markers.at (i) << "is not among the first matches";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+QList<PointMatchPixel> TestPointMatch::samplePointPixels (const BitPlane &bits,
+                                                          const QPoint &posSample) const
+{
+  QList<PointMatchPixel> pixels;
+
+  int radiusMax = MAX_POINT_SIZE / 2;
+
+  for (int xOffset = -radiusMax; xOffset <= radiusMax; xOffset++) {
+    for (int yOffset = -radiusMax; yOffset <= radiusMax; yOffset++) {
+
+      int radius = qSqrt (xOffset * xOffset + yOffset * yOffset);
+      if (radius <= radiusMax) {
+
+        pixels.push_back (PointMatchPixel (xOffset,
+                                           yOffset,
+                                           bits.pixel (posSample.x () + xOffset,
+                                                       posSample.y () + yOffset)));
+      }
+    }
+  }
+
+  return pixels;
+}
+
+void TestPointMatch::testBatchMatchesSingle ()
+{
+  BitPlane bits = bitPlaneWithMarkers ();
+
+  DocumentModelPointMatch modelPointMatch;
+  modelPointMatch.setMaxPointSize (MAX_POINT_SIZE);
+
+  PointMatchAlgorithm algorithm (NO_GNUPLOT);
+
+  QList<QList<PointMatchPixel> > samples;
+  samples << samplePointPixels (bits,
+                                m_markers.first ())
+          << samplePointPixels (bits,
+                                m_markers.last ());
+
+  PointMatchSession sessionBatch;
+  QList<QList<QPoint> > pointsBatch = algorithm.findPointsBatch (samples,
+                                                                 bits,
+                                                                 modelPointMatch,
+                                                                 Points (),
+                                                                 sessionBatch);
+  QCOMPARE (pointsBatch.count (), samples.count ());
+
+  // Shared buffers are overwritten by each sample, so the results must be exactly the same as separate requests
+  for (int i = 0; i < samples.count (); i++) {
+
+    PointMatchSession sessionSingle;
+    QList<QPoint> pointsSingle = algorithm.findPoints (samples.at (i),
+                                                       bits,
+                                                       modelPointMatch,
+                                                       Points (),
+                                                       sessionSingle);
+
+    QVERIFY (markersAreFirstMatches (pointsBatch.at (i)));
+    QCOMPARE (pointsBatch.at (i), pointsSingle);
+  }
+}
+
+void TestPointMatch::testCoarseToFineMatchesExhaustive ()
+{
+  QList<QPoint> pointsExhaustive = findPoints (PointMatchAlgorithm::precisionDefault (),
+                                               false,
+                                               false);
+  QList<QPoint> pointsCoarseToFine = findPoints (PointMatchAlgorithm::precisionDefault (),
+                                                 true,
+                                                 false);
+
+  QVERIFY (markersAreFirstMatches (pointsExhaustive));
+  QVERIFY (markersAreFirstMatches (pointsCoarseToFine));
+
+  // Refined candidates must be on exactly the same pixels as the exhaustive candidates
+  QVERIFY (firstMatchesAreEqual (pointsExhaustive,
+                                 pointsCoarseToFine));
+}
+
+void TestPointMatch::testFindPointsDouble ()
+{
+  QVERIFY (markersAreFirstMatches (findPoints (PointMatchAlgorithm::PRECISION_DOUBLE,
+                                               false,
+                                               false)));
+}
+
+void TestPointMatch::testFirstCandidateIsFirstPoint ()
+{
+  BitPlane bits = bitPlaneWithMarkers ();
+
+  PointMatchAlgorithm algorithm (NO_GNUPLOT);
+
+  for (int coarseToFine = 0; coarseToFine < 2; coarseToFine++) {
+
+    DocumentModelPointMatch modelPointMatch;
+    modelPointMatch.setMaxPointSize (MAX_POINT_SIZE);
+    modelPointMatch.setCoarseToFine (coarseToFine != 0);
+
+    // Best match is sent before the others are sorted, and must be the one that findPoints returns first
+    QSignalSpy spy (&algorithm, SIGNAL (signalFirstCandidate (QPoint)));
+    PointMatchSession session;
+    QList<QPoint> points = algorithm.findPoints (samplePointPixels (bits,
+                                                                   m_markers.first ()),
+                                                 bits,
+                                                 modelPointMatch,
+                                                 Points (),
+                                                 session);
+
+    QVERIFY (points.count () > 0);
+    QCOMPARE (spy.count (), 1);
+    QCOMPARE (spy.at (0).at (0).value<QPoint> (), points.first ());
+  }
+}
+
+void TestPointMatch::testFloatMatchesDouble ()
+{
+  if (PointMatchAlgorithm::precisionDefault () != PointMatchAlgorithm::PRECISION_FLOAT) {
+    QSKIP ("Single precision is not built in. Build with CONFIG+=fftwf to include it");
+  }
+
+  QList<QPoint> pointsDouble = findPoints (PointMatchAlgorithm::PRECISION_DOUBLE,
+                                           false,
+                                           false);
+  QList<QPoint> pointsFloat = findPoints (PointMatchAlgorithm::PRECISION_FLOAT,
+                                          false,
+                                          false);
+
+  QVERIFY (markersAreFirstMatches (pointsFloat));
+
+  // Later matches are weak partial overlaps whose order can be changed by rounding, but the best ones must agree
+  QVERIFY (firstMatchesAreEqual (pointsDouble,
+                                 pointsFloat));
+}
+
+void TestPointMatch::testRemovedPixelsMatchClearedImage ()
+{
+  BitPlane bits = bitPlaneWithMarkers ();
+
+  // One existing point is on the second marker, which is removed completely. The other is beside the last marker, and
+  // only removes the end of its horizontal arm so that marker becomes a weaker, but still distinct, match
+  const QString CURVE_NAME ("Curve1");
+  const double ORDINAL = 0;
+  const QPoint CLIPPED_OFFSET (MARKER_RADIUS + (int) MAX_POINT_SIZE - 3, 0);
+  Points pointsExisting;
+  pointsExisting << Point (CURVE_NAME,
+                           QPointF (m_markers.at (1)),
+                           ORDINAL)
+                 << Point (CURVE_NAME,
+                           QPointF (m_markers.last () + CLIPPED_OFFSET),
+                           ORDINAL + 1);
+
+  PointMatchAlgorithm algorithm (NO_GNUPLOT);
+  QList<PointMatchPixel> sample = samplePointPixels (bits,
+                                                     m_markers.first ());
+
+  for (int coarseToFine = 0; coarseToFine < 2; coarseToFine++) {
+
+    DocumentModelPointMatch modelPointMatch;
+    modelPointMatch.setMaxPointSize (MAX_POINT_SIZE);
+    modelPointMatch.setCoarseToFine (coarseToFine != 0);
+
+    // Session is reused, so the pixels near the existing points are removed from the convolutions of the transforms
+    // that were computed for the first request, and the counts are corrected by convolutionOffset
+    PointMatchSession sessionReused;
+    algorithm.findPoints (sample,
+                          bits,
+                          modelPointMatch,
+                          Points (),
+                          sessionReused);
+    QList<QPoint> pointsRemoved = algorithm.findPoints (sample,
+                                                        bits,
+                                                        modelPointMatch,
+                                                        pointsExisting,
+                                                        sessionReused);
+
+    // Fresh session on an image whose pixels near the existing points were turned off beforehand. Same removal
+    // radius as PointMatchAlgorithm
+    const int SEPARATION = (int) MAX_POINT_SIZE;
+    BitPlane bitsCleared = bits;
+    for (int i = 0; i < pointsExisting.count (); i++) {
+      QPoint posPoint = pointsExisting.at (i).posScreen ().toPoint ();
+      for (int y = posPoint.y () - SEPARATION; y < posPoint.y () + SEPARATION; y++) {
+        int radical = SEPARATION * SEPARATION - (y - posPoint.y ()) * (y - posPoint.y ());
+        if (0 < radical) {
+          int xMin = (int) (posPoint.x () - qSqrt ((double) radical));
+          for (int x = xMin; x < 2 * posPoint.x () - xMin; x++) {
+            if (bitsCleared.pixel (x, y)) {
+              bitsCleared.setPixel (x, y, false);
+            }
+          }
+        }
+      }
+    }
+
+    PointMatchSession sessionCleared;
+    QList<QPoint> pointsCleared = algorithm.findPoints (sample,
+                                                        bitsCleared,
+                                                        modelPointMatch,
+                                                        Points (),
+                                                        sessionCleared);
+
+    // Candidates are the two intact markers, which match equally well so their order is decided by rounding, and
+    // then the clipped marker. The weaker candidates after those are on flat parts of the correlation, where the
+    // local maxima are decided by rounding, and are not compared
+    QVERIFY (pointsRemoved.count () >= 3);
+    QVERIFY (pointsCleared.count () >= 3);
+
+    QSet<QPair<int, int> > setRemoved, setCleared, setExpected;
+    for (int i = 0; i < 2; i++) {
+      setRemoved.insert (QPair<int, int> (pointsRemoved.at (i).x (), pointsRemoved.at (i).y ()));
+      setCleared.insert (QPair<int, int> (pointsCleared.at (i).x (), pointsCleared.at (i).y ()));
+    }
+    setExpected.insert (QPair<int, int> (m_markers.at (0).x (), m_markers.at (0).y ()));
+    setExpected.insert (QPair<int, int> (m_markers.at (2).x (), m_markers.at (2).y ()));
+
+    QCOMPARE (setRemoved, setExpected);
+    QCOMPARE (setCleared, setExpected);
+    QCOMPARE (pointsRemoved.at (2), m_markers.last ());
+    QCOMPARE (pointsCleared.at (2), m_markers.last ());
+
+    // The completely removed marker is not a candidate in either list
+    QVERIFY (!pointsRemoved.contains (m_markers.at (1)));
+    QVERIFY (!pointsCleared.contains (m_markers.at (1)));
+  }
+}
+
+void TestPointMatch::testSessionReuse ()
+{
+  BitPlane bits = bitPlaneWithMarkers ();
+
+  DocumentModelPointMatch modelPointMatch;
+  modelPointMatch.setMaxPointSize (MAX_POINT_SIZE);
+
+  // Same session for both requests, so the second one reuses the image transform from the first one
+  PointMatchSession session;
+  PointMatchAlgorithm algorithm (NO_GNUPLOT);
+
+  QList<QPoint> pointsFirst = algorithm.findPoints (samplePointPixels (bits,
+                                                                       m_markers.first ()),
+                                                    bits,
+                                                    modelPointMatch,
+                                                    Points (),
+                                                    session);
+  QList<QPoint> pointsSecond = algorithm.findPoints (samplePointPixels (bits,
+                                                                        m_markers.last ()),
+                                                     bits,
+                                                     modelPointMatch,
+                                                     Points (),
+                                                     session);
+
+  QVERIFY (markersAreFirstMatches (pointsFirst));
+  QVERIFY (markersAreFirstMatches (pointsSecond));
+}
+
+void TestPointMatch::testTemplateBankMatchesMarkers ()
+{
+  QList<QPoint> pointsSingle = findPoints (PointMatchAlgorithm::precisionDefault (),
+                                           false,
+                                           false);
+  QList<QPoint> pointsExhaustive = findPoints (PointMatchAlgorithm::precisionDefault (),
+                                               false,
+                                               true);
+  QList<QPoint> pointsCoarseToFine = findPoints (PointMatchAlgorithm::precisionDefault (),
+                                                 true,
+                                                 true);
+
+  QVERIFY (markersAreFirstMatches (pointsExhaustive));
+  QVERIFY (markersAreFirstMatches (pointsCoarseToFine));
+
+  // Markers are exact copies of the sample, which none of the rotated or scaled copies can match as well
+  QVERIFY (firstMatchesAreEqual (pointsSingle,
+                                 pointsExhaustive));
+  QVERIFY (firstMatchesAreEqual (pointsExhaustive,
+                                 pointsCoarseToFine));
+}
+
+void TestPointMatch::testTemplateBankMatchesRotatedMarker ()
+{
+  const double ROTATION = 5.0; // Degrees, same as one of the copies in the bank
+  const int DISTRACTOR_RADIUS = 6;
+
+  QPoint posSample (40, 40);
+  QPoint posRotated (100, 40);
+  QList<QPoint> distractors;
+  distractors << QPoint (160, 40)
+              << QPoint (40, 110)
+              << QPoint (100, 110)
+              << QPoint (160, 110);
+
+  BitPlane bits (IMAGE_WIDTH,
+                 IMAGE_HEIGHT);
+
+  // Upright cross for the sample, and smaller upright crosses that match the sample better than the rotated cross does
+  for (int delta = -MARKER_RADIUS; delta <= MARKER_RADIUS; delta++) {
+    bits.setPixel (posSample.x () + delta, posSample.y (), true);
+    bits.setPixel (posSample.x (), posSample.y () + delta, true);
+  }
+  for (int i = 0; i < distractors.count (); i++) {
+    for (int delta = -DISTRACTOR_RADIUS; delta <= DISTRACTOR_RADIUS; delta++) {
+      bits.setPixel (distractors.at (i).x () + delta, distractors.at (i).y (), true);
+      bits.setPixel (distractors.at (i).x (), distractors.at (i).y () + delta, true);
+    }
+  }
+
+  // Rotated cross, where each pixel takes the value of the nearest pixel of an upright cross after undoing the rotation
+  double cosAngle = qCos (qDegreesToRadians (ROTATION));
+  double sinAngle = qSin (qDegreesToRadians (ROTATION));
+  int radiusMax = MAX_POINT_SIZE / 2;
+  for (int yDelta = -radiusMax; yDelta <= radiusMax; yDelta++) {
+    for (int xDelta = -radiusMax; xDelta <= radiusMax; xDelta++) {
+
+      int xFrom = qFloor (0.5 + cosAngle * xDelta + sinAngle * yDelta);
+      int yFrom = qFloor (0.5 - sinAngle * xDelta + cosAngle * yDelta);
+      if (((xFrom == 0) && (qAbs (yFrom) <= MARKER_RADIUS)) ||
+          ((yFrom == 0) && (qAbs (xFrom) <= MARKER_RADIUS))) {
+        bits.setPixel (posRotated.x () + xDelta, posRotated.y () + yDelta, true);
+      }
+    }
+  }
+
+  QList<PointMatchPixel> sample = samplePointPixels (bits,
+                                                     posSample);
+
+  QList<QPoint> pointsByTemplateBank [2];
+  for (int templateBank = 0; templateBank < 2; templateBank++) {
+
+    DocumentModelPointMatch modelPointMatch;
+    modelPointMatch.setMaxPointSize (MAX_POINT_SIZE);
+    modelPointMatch.setTemplateBank (templateBank != 0);
+
+    PointMatchSession session;
+    PointMatchAlgorithm algorithm (NO_GNUPLOT);
+    pointsByTemplateBank [templateBank] = algorithm.findPoints (sample,
+                                                                bits,
+                                                                modelPointMatch,
+                                                                Points (),
+                                                                session);
+  }
+
+  // The sample itself comes first either way. The rotated cross is behind every distractor without the bank, and ties
+  // with the sample with the bank, in which case the order of the two is decided by rounding
+  const int TOP_N = 2;
+  QVERIFY (pointsByTemplateBank [0].count () >= TOP_N);
+  QVERIFY (pointsByTemplateBank [1].count () >= TOP_N);
+  QVERIFY (!pointsByTemplateBank [0].mid (0, TOP_N).contains (posRotated));
+  QVERIFY (pointsByTemplateBank [1].mid (0, TOP_N).contains (posRotated));
+  QVERIFY (pointsByTemplateBank [1].mid (0, TOP_N).contains (posSample));
+}
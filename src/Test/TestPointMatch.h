@@ -0,0 +1,60 @@
+#ifndef TEST_POINT_MATCH_H
+#define TEST_POINT_MATCH_H
+
+#include "PointMatchAlgorithm.h"
+#include "PointMatchPixel.h"
+#include <QList>
+#include <QObject>
+#include <QPoint>
+
+class BitPlane;
+
+/// Unit test of point matching, in every precision that is built in
+class TestPointMatch : public QObject
+{
+  Q_OBJECT
+public:
+  /// Single constructor.
+  explicit TestPointMatch(QObject *parent = 0);
+
+signals:
+
+private slots:
+  void cleanupTestCase ();
+  void initTestCase ();
+
+  void testBatchMatchesSingle ();
+  void testCoarseToFineMatchesExhaustive ();
+  void testFindPointsDouble ();
+  void testFirstCandidateIsFirstPoint ();
+  void testFloatMatchesDouble ();
+  void testRemovedPixelsMatchClearedImage ();
+  void testSessionReuse ();
+  void testTemplateBankMatchesMarkers ();
+  void testTemplateBankMatchesRotatedMarker ();
+
+private:
+  // Bit plane with a small cross centered on each of the marker positions
+  BitPlane bitPlaneWithMarkers () const;
+
+  // True if the first matches, one per marker, are the same pixels in both lists. The markers match equally well,
+  // so their order is decided by rounding and is not compared
+  bool firstMatchesAreEqual (const QList<QPoint> &points1,
+                             const QList<QPoint> &points2) const;
+
+  // Run the point match algorithm on the markers, with the first marker as the sample point
+  QList<QPoint> findPoints (PointMatchAlgorithm::Precision precision,
+                            bool coarseToFine,
+                            bool templateBank) const;
+
+  // True if each marker has a match within one pixel among the first matches
+  bool markersAreFirstMatches (const QList<QPoint> &points) const;
+
+  // Pixels around the specified sample point, in the same way that DigitizeStatePointMatch collects them
+  QList<PointMatchPixel> samplePointPixels (const BitPlane &bits,
+                                            const QPoint &posSample) const;
+
+  QList<QPoint> m_markers;
+};
+
+#endif // TEST_POINT_MATCH_H
@@ -1,12 +1,15 @@
+#include "BitPlane.h"
 #include <iostream>
 #include "Logger.h"
 #include "MainWindow.h"
+#include "mmsubs.h"
 #include <QCryptographicHash>
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QList>
 #include <qmath.h>
 #include <QTextStream>
+#include <QtGlobal>
 #include <QtTest/QtTest>
 #include "Segment.h"
 #include "SegmentFactory.h"
@@ -74,7 +77,7 @@ void TestSegmentFill::testFindSegments()
   segmentFactory.clearSegments (segments);
 
   // This will crash if dialog box appears since QApplication is not executing and therefore cannot process events
-  segmentFactory.makeSegments (img,
+  segmentFactory.makeSegments (BitPlane (img),
                                modelSegments,
                                segments,
                                NO_DLG);
@@ -128,3 +131,79 @@ void TestSegmentFill::testFindSegments()
 
   QVERIFY (success);
 }
+
+void TestSegmentFill::testFoldedLinesDeviation ()
+{
+  const bool NO_GNUPLOT = false;
+  const int NUM_COLUMNS = 2000;
+  const double MAX_DEVIATION = 0.5;
+
+  QGraphicsScene scene;
+  qsrand (0);
+
+  bool success = true;
+
+  // Curves are the pathological y=0.001*x*x case, a smooth curve with steep sections, and a random walk
+  for (int curve = 0; curve < 3; curve++) {
+
+    QVector<int> ys (NUM_COLUMNS);
+    for (int x = 0; x < NUM_COLUMNS; x++) {
+      if (curve == 0) {
+        ys [x] = (int) (0.001 * x * x);
+      } else if (curve == 1) {
+        ys [x] = (int) (0.5 + 300.0 * qSin (x / 40.0));
+      } else {
+        ys [x] = ((x == 0) ? 0 : ys [x - 1] + qrand () % 7 - 3);
+      }
+    }
+
+    Segment segment (scene,
+                     ys [0],
+                     NO_GNUPLOT);
+    for (int x = 1; x < NUM_COLUMNS; x++) {
+      segment.appendColumn (x, ys [x]);
+    }
+
+    int foldedLines = 0;
+    segment.removeUnneededLines (&foldedLines);
+
+    const std::vector<QPoint> &points = segment.polyline ();
+
+    // Endpoints are always kept, and the pathological case must not collapse into a single line
+    if ((points.front () != QPoint (0, ys [0])) ||
+        (points.back () != QPoint (NUM_COLUMNS - 1, ys [NUM_COLUMNS - 1])) ||
+        (points.size () < 3)) {
+      qDebug () << "Curve" << curve << "has" << points.size () << "points after folding";
+      success = false;
+    }
+
+    // Every column sample must be strictly within the deviation bound of the folded line covering its column
+    unsigned int index = 0;
+    for (int x = 0; x < NUM_COLUMNS; x++) {
+
+      while ((index + 2 < points.size ()) &&
+             (points [index + 1].x () < x)) {
+        ++index;
+      }
+
+      double xProjection, yProjection, projectedDistanceOutsideLine, distanceToLine;
+      projectPointOntoLine (x,
+                            ys [x],
+                            points [index].x (),
+                            points [index].y (),
+                            points [index + 1].x (),
+                            points [index + 1].y (),
+                            &xProjection,
+                            &yProjection,
+                            &projectedDistanceOutsideLine,
+                            &distanceToLine);
+
+      if (distanceToLine >= MAX_DEVIATION) {
+        qDebug () << "Curve" << curve << "column" << x << "is" << distanceToLine << "from its folded line";
+        success = false;
+      }
+    }
+  }
+
+  QVERIFY (success);
+}
@@ -18,6 +18,7 @@ private slots:
   void initTestCase ();
 
   void testFindSegments ();
+  void testFoldedLinesDeviation ();
 
 };
 
@@ -80,11 +80,13 @@ void TransformationStateDefined::initializeModelGridRemoval (CmdMediator &cmdMed
 
   // Generate filtered image
   FilterImage filterImage;
-  QPixmap pixmapFiltered = filterImage.filter (cmdMediator.document().pixmap().toImage(),
-                                               transformation,
-                                               selectedGraphCurve,
-                                               cmdMediator.document().modelColorFilter(),
-                                               cmdMediator.document().modelGridRemoval());
+  QPixmap pixmapFiltered;
+  filterImage.filter (cmdMediator.document().pixmap(),
+                      transformation,
+                      selectedGraphCurve,
+                      cmdMediator.document().modelColorFilter(),
+                      cmdMediator.document().modelGridRemoval(),
+                      pixmapFiltered);
 
   // Initialize grid removal settings so user does not have to
   int countX, countY;
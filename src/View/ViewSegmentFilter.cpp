@@ -191,8 +191,7 @@ void ViewSegmentFilter::setColorFilterSettings (const ColorFilterSettings &color
 
   // Compute background color
   ColorFilter filter;
-  QImage img = pixmap.toImage();
-  m_rgbBackground = filter.marginColor(&img);
+  m_rgbBackground = filter.marginColor(pixmap);
 
   // Force a redraw
   update();
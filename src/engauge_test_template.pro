@@ -19,7 +19,12 @@ TEMPLATE    = app
 #    Sample command lines
 #       qmake CONFIG+=pdf
 #       qmake "CONFIG+=debug pdf"
-# 3) Gratuitous warning about import_qpa_plugin in Fedora is due to 'CONFIG=qt' but that option takes care of 
+# 3) Add 'fftwf' to the qmake command line so point matching uses single precision fftw with all cores. Requires
+#       1) previous installation of the single precision fftw development package, including libfftw3f_threads
+#    Sample command lines
+#       qmake CONFIG+=fftwf
+#       qmake "CONFIG+=debug fftwf"
+# 4) Gratuitous warning about import_qpa_plugin in Fedora is due to 'CONFIG=qt' but that option takes care of 
 #    include/library files in an automated and platform-independent manner, so it will not be removed
 CONFIG      += qt warn_on thread testcase 
 
@@ -93,8 +98,9 @@ HEADERS  += \
     Cmd/CmdUndoForTest.h \
     Color/ColorConstants.h \
     Color/ColorFilter.h \
-    Color/ColorFilterEntry.h \
     Color/ColorFilterHistogram.h \
+    Color/ColorFilterLevels.h \
+    Color/ColorFilterLookupTable.h \
     Color/ColorFilterMode.h \
     Color/ColorFilterSettings.h \
     Color/ColorFilterSettingsStrategyAbstractBase.h \
@@ -103,12 +109,14 @@ HEADERS  += \
     Color/ColorFilterSettingsStrategyIntensity.h \
     Color/ColorFilterSettingsStrategySaturation.h \
     Color/ColorFilterSettingsStrategyValue.h \
+    Color/ColorFilterSimd.h \
     Color/ColorFilterStrategyAbstractBase.h \
     Color/ColorFilterStrategyForeground.h \
     Color/ColorFilterStrategyHue.h \
     Color/ColorFilterStrategyIntensity.h \
     Color/ColorFilterStrategySaturation.h \
     Color/ColorFilterStrategyValue.h \
+    Color/ColorFilterStripe.h \
     Color/ColorPalette.h \
     Coord/CoordScale.h \
     Coord/CoordsType.h \
@@ -122,6 +130,7 @@ HEADERS  += \
     Coord/CoordUnitsPolarTheta.h \
     Coord/CoordUnitsTime.h \
     Correlation/Correlation.h \
+    Correlation/FftPlanCache.h \
     Cursor/CursorFactory.h \
     Cursor/CursorSize.h \
     Curve/Curve.h \
@@ -222,6 +231,7 @@ HEADERS  += \
     FileCmd/FileCmdOpen.h \
     FileCmd/FileCmdSerialize.h \
     FileCmd/FileCmdScript.h \
+    Filter/BitPlane.h \
     Filter/FilterImage.h \
     Fitting/FittingCurve.h \
     Fitting/FittingCurveCoefficients.h \            
@@ -304,6 +314,8 @@ HEADERS  += \
     Point/PointIdentifiers.h \
     Point/PointMatchAlgorithm.h \
     Point/PointMatchPixel.h \
+    Point/PointMatchSession.h \
+    Point/PointMatchThread.h \
     Point/PointMatchTriplet.h \
     Point/Points.h \
     Point/PointShape.h \
@@ -313,6 +325,7 @@ HEADERS  += \
     Segment/Segment.h \
     Segment/SegmentFactory.h \
     Segment/SegmentLine.h \
+    Segment/SegmentRun.h \
     Settings/Settings.h \
     Settings/SettingsForGraph.h \
     Spline/Spline.h \
@@ -428,6 +441,8 @@ SOURCES += \
     Cmd/CmdUndoForTest.cpp \
     Color/ColorFilter.cpp \
     Color/ColorFilterHistogram.cpp \
+    Color/ColorFilterLevels.cpp \
+    Color/ColorFilterLookupTable.cpp \
     Color/ColorFilterMode.cpp \
     Color/ColorFilterSettings.cpp \
     Color/ColorFilterSettingsStrategyAbstractBase.cpp \
@@ -436,12 +451,14 @@ SOURCES += \
     Color/ColorFilterSettingsStrategyIntensity.cpp \
     Color/ColorFilterSettingsStrategySaturation.cpp \
     Color/ColorFilterSettingsStrategyValue.cpp \
+    Color/ColorFilterSimd.cpp \
     Color/ColorFilterStrategyAbstractBase.cpp \
     Color/ColorFilterStrategyForeground.cpp \
     Color/ColorFilterStrategyHue.cpp \
     Color/ColorFilterStrategyIntensity.cpp \
     Color/ColorFilterStrategySaturation.cpp \
     Color/ColorFilterStrategyValue.cpp \
+    Color/ColorFilterStripe.cpp \
     Color/ColorPalette.cpp \
     Coord/CoordScale.cpp \
     Coord/CoordsType.cpp \
@@ -454,6 +471,7 @@ SOURCES += \
     Coord/CoordUnitsPolarTheta.cpp \
     Coord/CoordUnitsTime.cpp \
     Correlation/Correlation.cpp \
+    Correlation/FftPlanCache.cpp \
     Cursor/CursorFactory.cpp \
     Cursor/CursorSize.cpp \
     Curve/Curve.cpp \
@@ -548,6 +566,7 @@ SOURCES += \
     FileCmd/FileCmdOpen.cpp \
     FileCmd/FileCmdSerialize.cpp \
     FileCmd/FileCmdScript.cpp \
+    Filter/BitPlane.cpp \
     Filter/FilterImage.cpp \
     Fitting/FittingCurve.cpp \    
     Fitting/FittingModel.cpp \
@@ -621,6 +640,8 @@ SOURCES += \
     Point/PointIdentifiers.cpp \
     Point/PointMatchAlgorithm.cpp \
     Point/PointMatchPixel.cpp \
+    Point/PointMatchSession.cpp \
+    Point/PointMatchThread.cpp \
     Point/PointMatchTriplet.cpp \
     Point/PointShape.cpp \
     Point/PointStyle.cpp \
@@ -676,7 +697,7 @@ SOURCES += \
 
 TARGET = ../bin/TEST
 
-QT += core gui network printsupport testlib widgets xml help
+QT += concurrent core gui network printsupport testlib widgets xml help
 
 LIBS += -L$$(LOG4CPP_HOME)/lib -L$$(FFTW_HOME)/lib
 
@@ -809,3 +830,12 @@ pdf {
 } else {
     message("PDF support:      no")
 }
+
+fftwf {
+    message("FFTWF support:    yes")
+    DEFINES += "ENGAUGE_FFTWF"
+    LIBS += -lfftw3f_threads -lfftw3f
+
+} else {
+    message("FFTWF support:    no")
+}
@@ -56,6 +56,7 @@
 #include "ExportImageForRegression.h"
 #include "ExportToFile.h"
 #include "FileCmdScript.h"
+#include "FilterImage.h"
 #include "FittingCurve.h"
 #include "FittingWindow.h"
 #include "GeometryWindow.h"
@@ -290,6 +291,11 @@ void MainWindow::applyZoomFactorAfterLoad()
   slotViewZoom (zoomFactor);
 }
 
+BitPlane MainWindow::bitsFiltered () const
+{
+  return m_backgroundStateContext->bitsForCurveState();
+}
+
 void MainWindow::closeEvent(QCloseEvent *event)
 {
   if (maybeSave()) {
@@ -1935,11 +1941,6 @@ void MainWindow::ghostsDestroy ()
   m_ghosts = 0;
 }
 
-QImage MainWindow::imageFiltered () const
-{
-  return m_backgroundStateContext->imageForCurveState();
-}
-
 bool MainWindow::isGnuplot() const
 {
   return m_isGnuplot;
@@ -2767,6 +2768,8 @@ void MainWindow::settingsReadMainWindow (QSettings &settings)
                                                      QVariant (DEFAULT_SMALL_DIALOGS)).toBool ());
   m_modelMainWindow.setDragDropExport (settings.value (SETTINGS_DRAG_DROP_EXPORT,
                                                        QVariant (DEFAULT_DRAG_DROP_EXPORT)).toBool ());
+  m_modelMainWindow.setFilteredImageCacheMegabytes (settings.value (SETTINGS_FILTERED_IMAGE_CACHE_MEGABYTES,
+                                                                    QVariant (DEFAULT_FILTERED_IMAGE_CACHE_MEGABYTES)).toInt ());
 
   updateSettingsMainWindow();
   updateSmallDialogs();
@@ -2820,6 +2823,7 @@ void MainWindow::settingsWrite ()
   settings.setValue (SETTINGS_BACKGROUND_IMAGE, m_cmbBackground->currentData().toInt());
   settings.setValue (SETTINGS_CHECKLIST_GUIDE_WIZARD, m_actionHelpChecklistGuideWizard->isChecked ());
   settings.setValue (SETTINGS_DRAG_DROP_EXPORT, m_modelMainWindow.dragDropExport ());
+  settings.setValue (SETTINGS_FILTERED_IMAGE_CACHE_MEGABYTES, m_modelMainWindow.filteredImageCacheMegabytes());
   settings.setValue (SETTINGS_HIGHLIGHT_OPACITY, m_modelMainWindow.highlightOpacity());
   settings.setValue (SETTINGS_IMPORT_CROPPING, m_modelMainWindow.importCropping());
   settings.setValue (SETTINGS_IMPORT_PDF_RESOLUTION, m_modelMainWindow.pdfResolution ());
@@ -4700,6 +4704,8 @@ void MainWindow::updateSettingsMainWindow()
     m_scene->updateCurveStyles(m_cmdMediator->document().modelCurveStyles());
   }
 
+  FilterImage::setCacheMegabytes (m_modelMainWindow.filteredImageCacheMegabytes());
+
   updateHighlightOpacity();
   updateWindowTitle();
   updateFittingWindow(); // Forward the drag and drop choice
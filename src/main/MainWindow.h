@@ -8,6 +8,7 @@
 #define MAIN_WINDOW_H
 
 #include "BackgroundImage.h"
+#include "BitPlane.h"
 #include "CoordSystemIndex.h"
 #include "DigitizeStateAbstractBase.h"
 #include "DocumentAxesPointsRequired.h"
@@ -108,6 +109,9 @@ public:
              QWidget *parent = 0);
   ~MainWindow();
 
+  /// Background image that has been filtered for the current curve, with one bit per pixel
+  BitPlane bitsFiltered () const;
+
   /// Close file. This is called from a file script command
   void cmdFileClose();
 
@@ -126,9 +130,6 @@ public:
   /// Catch secret keypresses
   virtual bool eventFilter(QObject *, QEvent *);
 
-  /// Background image that has been filtered for the current curve. This asserts if a curve-specific image is not being shown
-  QImage imageFiltered () const;
-
   /// Get method for gnuplot flag
   bool isGnuplot() const;
 
@@ -6,6 +6,7 @@
 
 #include "CmdMediator.h"
 #include "DocumentSerialize.h"
+#include "FilterImage.h"
 #include "GraphicsPoint.h"
 #include "GridLineLimiter.h"
 #include "ImportCroppingUtilBase.h"
@@ -35,7 +36,8 @@ MainWindowModel::MainWindowModel() :
   m_maximumGridLines (DEFAULT_MAXIMUM_GRID_LINES),
   m_highlightOpacity (DEFAULT_HIGHLIGHT_OPACITY),
   m_smallDialogs (DEFAULT_SMALL_DIALOGS),
-  m_dragDropExport (DEFAULT_DRAG_DROP_EXPORT)
+  m_dragDropExport (DEFAULT_DRAG_DROP_EXPORT),
+  m_filteredImageCacheMegabytes (DEFAULT_FILTERED_IMAGE_CACHE_MEGABYTES)
 {
   // Locale member variable m_locale is initialized to default locale when default constructor is called
 }
@@ -50,7 +52,8 @@ MainWindowModel::MainWindowModel(const MainWindowModel &other) :
   m_maximumGridLines (other.maximumGridLines()),
   m_highlightOpacity (other.highlightOpacity()),
   m_smallDialogs (other.smallDialogs()),
-  m_dragDropExport (other.dragDropExport())
+  m_dragDropExport (other.dragDropExport()),
+  m_filteredImageCacheMegabytes (other.filteredImageCacheMegabytes())
 {
 }
 
@@ -66,6 +69,7 @@ MainWindowModel &MainWindowModel::operator=(const MainWindowModel &other)
   m_highlightOpacity = other.highlightOpacity();
   m_smallDialogs = other.smallDialogs();
   m_dragDropExport = other.dragDropExport();
+  m_filteredImageCacheMegabytes = other.filteredImageCacheMegabytes();
 
   return *this;
 }
@@ -75,6 +79,11 @@ bool MainWindowModel::dragDropExport() const
   return m_dragDropExport;
 }
 
+int MainWindowModel::filteredImageCacheMegabytes() const
+{
+  return m_filteredImageCacheMegabytes;
+}
+
 double MainWindowModel::highlightOpacity() const
 {
   return m_highlightOpacity;
@@ -145,6 +154,7 @@ void MainWindowModel::printStream(QString indentation,
   str << indentation << "highlightOpacity=" << m_highlightOpacity << "\n";
   str << indentation << "smallDialogs=" << (m_smallDialogs ? "yes" : "no") << "\n";
   str << indentation << "dragDropExport=" << (m_dragDropExport ? "yes" : "no") << "\n";
+  str << indentation << "filteredImageCacheMegabytes=" << m_filteredImageCacheMegabytes << "\n";
 }
 
 void MainWindowModel::saveXml(QXmlStreamWriter &writer) const
@@ -160,6 +170,11 @@ void MainWindowModel::setDragDropExport(bool dragDropExport)
   m_dragDropExport = dragDropExport;
 }
 
+void MainWindowModel::setFilteredImageCacheMegabytes(int filteredImageCacheMegabytes)
+{
+  m_filteredImageCacheMegabytes = filteredImageCacheMegabytes;
+}
+
 void MainWindowModel::setHighlightOpacity(double highlightOpacity)
 {
   m_highlightOpacity = highlightOpacity;
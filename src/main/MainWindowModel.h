@@ -41,6 +41,9 @@ public:
 
   virtual void loadXml(QXmlStreamReader &reader);
 
+  /// Get method for memory budget of the filtered image cache, in megabytes
+  int filteredImageCacheMegabytes () const;
+
   /// Get method for highlight opacity
   double highlightOpacity() const;
 
@@ -68,6 +71,9 @@ public:
   /// Set method for drag and drop export
   void setDragDropExport (bool dragDropExport);
 
+  /// Set method for memory budget of the filtered image cache, in megabytes
+  void setFilteredImageCacheMegabytes (int filteredImageCacheMegabytes);
+
   /// Set method for highlight opacity
   void setHighlightOpacity (double highlightOpacity);
 
@@ -120,6 +126,7 @@ private:
   double m_highlightOpacity;
   bool m_smallDialogs;
   bool m_dragDropExport;
+  int m_filteredImageCacheMegabytes;
 
 };
 
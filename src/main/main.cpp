@@ -5,6 +5,7 @@
  ******************************************************************************************************/
 
 #include "ColorFilterMode.h"
+#include "FftPlanCache.h"
 #include "FittingCurveCoefficients.h"
 #include <iostream>
 #include "Logger.h"
@@ -135,6 +136,9 @@ int main(int argc, char *argv[])
                      isDebug);
   LOG4CPP_INFO_S ((*mainCat)) << "main args=" << QApplication::arguments().join (" ").toLatin1().data();
 
+  // Fft plans measured in earlier sessions
+  FftPlanCache::loadWisdom ();
+
   // Create and show main window
   MainWindow w (errorReportFile,
                 fileCmdScriptFile,